@@ -0,0 +1,544 @@
+/*
+ * Dashboard data worker
+ * Fetches and decodes readings off the UI thread, keeps the long history
+ * (24 h of 1 s readings) in a typed-array ring, and computes the trends and
+ * the decimated series for the historical ranges. Series are posted back as
+ * transferable typed arrays, so the page only renders.
+ *
+ * Readings are also cached in IndexedDB in 10-minute chunks. On load the
+ * cache is restored first, then each response's history page fills in what
+ * the device recorded since, so the ranges have data straight away. The
+ * history page is the only source of stored readings; the current values
+ * are shown but not stored, as the page already holds the newest reading.
+ *
+ * Device timestamps count from its first boot, not from 1970: a reading's
+ * wall time is its epoch_ms, or for firmware without it, its timestamp
+ * moved by the device clock's offset from this one.
+ *
+ * Messages from the page:
+ *   configure  { settings }                 Device, store size, trend window, points per range
+ *   fetch      { url, timeout }             Fetch, decode and ingest one response
+ *   ingest     { data, simulated }          Ingest a response built by the page
+ *   range      { range, minutes }           Follow a historical range (range null: stop)
+ *   flush      {}                           Write the open cache chunk now (page hidden or closing)
+ *
+ * Messages to the page:
+ *   history    { time, temperature, humidity }   Restored or backfilled readings, oldest first
+ *   reading    { current, trend, simulated }
+ *   invalid    {}                           Response without a current reading
+ *   error      { message }                  Fetch or decode failed
+ *   range      { range, time, temperature, humidity, points }
+ */
+
+importScripts('series-ring.js');
+
+// Settings from the page; these defaults match its CONFIG
+let settings = {
+    deviceId: '',
+    retentionPoints: 86400,                 // 24 hours at one reading per second
+    trendPoints: 10,                        // Readings in the trend window
+    rangePoints: 600,                       // Points drawn per historical range
+    pagePoints: 1000,                       // Readings the page keeps for its live charts
+    cacheRetentionMs: 24 * 60 * 60 * 1000   // Cached chunks older than this are deleted
+};
+
+// Long history of readings
+let store = new SeriesRing(settings.retentionPoints);
+
+// Historical range followed by the page, and the newest reading it has been sent
+let activeRange = null;
+let rangeSentTime = 0;
+
+// IndexedDB cache: one record per device and 10-minute bucket
+const CACHE_DB_NAME = 'environment-monitor';
+const CACHE_STORE_NAME = 'chunks';
+const CACHE_CHUNK_MS = 10 * 60 * 1000;
+const CACHE_FLUSH_MS = 30 * 1000;           // The open chunk is rewritten at most this often
+
+let cacheDb = null;                         // Stays null when IndexedDB is unavailable
+let openChunk = null;                       // Chunk receiving new readings
+let chunkFlushedAt = 0;
+
+// Settles once the cache has been restored; readings are ingested after it
+let restoring = Promise.resolve();
+
+// Wall clock minus device clock (ms) for readings without epoch_ms; kept
+// once known so a reading maps to the same time on every poll
+let deviceClockOffset = null;
+
+// Readings closer than this to the newest stored one are the same reading
+// (the device samples at most once a second; epoch_ms can move by a few ms
+// between responses as NTP slews its clock)
+const SAME_READING_MS = 500;
+const CLOCK_RESYNC_MS = 60 * 1000;          // Larger jumps mean the device clock restarted
+
+/*
+ * Dispatch messages from the page
+ */
+self.onmessage = (event) => {
+    const message = event.data;
+
+    switch (message.type) {
+        case 'configure':
+            settings = Object.assign(settings, message.settings);
+            if (store.capacity !== settings.retentionPoints) {
+                store = new SeriesRing(settings.retentionPoints);
+            }
+            restoring = restoreHistory().catch(error => {
+                console.warn('History cache restore failed:', error);
+            });
+            break;
+        case 'fetch':
+            fetchReading(message.url, message.timeout);
+            break;
+        case 'ingest':
+            restoring.then(() => ingest(message.data, message.simulated === true));
+            break;
+        case 'range':
+            activeRange = message.range ? { range: message.range, minutes: message.minutes } : null;
+            restoring.then(() => {
+                if (activeRange) postRange();
+            });
+            break;
+        case 'flush':
+            flushChunk();
+            break;
+    }
+};
+
+// ========================================
+// DECODING
+// ========================================
+
+/*
+ * Fetch one response from the backend and ingest it
+ */
+async function fetchReading(url, timeout) {
+    let data;
+    try {
+        const response = await fetch(url, {
+            method: 'GET',
+            headers: {
+                'Content-Type': 'application/json',
+            },
+            signal: AbortSignal.timeout(timeout)
+        });
+
+        if (!response.ok) {
+            throw new Error(`HTTP error! status: ${response.status}`);
+        }
+
+        data = await response.json();
+    } catch (error) {
+        self.postMessage({ type: 'error', message: String(error && error.message ? error.message : error) });
+        return;
+    }
+
+    await restoring;
+    ingest(data, false);
+}
+
+/*
+ * Store the new readings of the history page, and report the current
+ * values with the updated trends
+ * Simulated readings are shown but not cached
+ */
+function ingest(data, simulated) {
+    if (!data || !data.current) {
+        self.postMessage({ type: 'invalid' });
+        return;
+    }
+
+    // The device's newest readings fill whatever the cache does not have
+    // (after a reload or an outage); ones already stored are skipped
+    updateDeviceClockOffset(data.current);
+    let stored = 0;
+    if (Array.isArray(data.history)) {
+        data.history.forEach(reading => {
+            if (storeReading(readingTime(reading), reading.temperature, reading.humidity, !simulated)) {
+                stored++;
+            }
+        });
+    }
+    if (stored > 0) {
+        postHistory(stored);
+    }
+
+    self.postMessage({
+        type: 'reading',
+        current: data.current,
+        trend: calculateTrends(),
+        simulated
+    });
+
+    postRangeIfDue();
+}
+
+/*
+ * Offset of the device clock from this one, from a response's current
+ * reading (taken as the response arrives); found again if the device
+ * clock restarted
+ */
+function updateDeviceClockOffset(current) {
+    if (typeof current.timestamp !== 'number') return;
+
+    const offset = Date.now() - current.timestamp;
+    if (deviceClockOffset === null || Math.abs(offset - deviceClockOffset) > CLOCK_RESYNC_MS) {
+        deviceClockOffset = offset;
+    }
+}
+
+/*
+ * Wall time of a history reading in milliseconds
+ */
+function readingTime(reading) {
+    if (typeof reading.epoch_ms === 'number') {
+        return reading.epoch_ms;
+    }
+    return reading.timestamp + deviceClockOffset;
+}
+
+/*
+ * Append a reading newer than everything stored, and cache it
+ * Returns false for one that is not newer (already stored)
+ */
+function storeReading(time, temperature, humidity, cache) {
+    if (!Number.isFinite(time)) {
+        return false;
+    }
+    if (store.count > 0 && time < store.at('time', store.count - 1) + SAME_READING_MS) {
+        return false;
+    }
+
+    store.push(time, temperature, humidity);
+    if (cache) {
+        cacheReading(time, temperature, humidity);
+    }
+    return true;
+}
+
+/*
+ * Send the newest stored readings to the page for its live charts
+ */
+function postHistory(points) {
+    const length = Math.min(points, settings.pagePoints, store.count);
+    if (length === 0) return;
+
+    const first = store.firstSlot() + store.count - length;
+    const time = store.fields.time.slice(first, first + length);
+    const temperature = store.fields.temperature.slice(first, first + length);
+    const humidity = store.fields.humidity.slice(first, first + length);
+    self.postMessage({ type: 'history', time, temperature, humidity }, [time.buffer, temperature.buffer, humidity.buffer]);
+}
+
+// ========================================
+// HISTORY CACHE (INDEXEDDB)
+// ========================================
+
+/*
+ * Open the cache database; resolves to null when IndexedDB is unavailable
+ */
+function openCache() {
+    return new Promise((resolve) => {
+        if (!self.indexedDB) {
+            resolve(null);
+            return;
+        }
+
+        const request = indexedDB.open(CACHE_DB_NAME, 1);
+        request.onupgradeneeded = () => {
+            request.result.createObjectStore(CACHE_STORE_NAME, { keyPath: ['deviceId', 'bucket'] });
+        };
+        request.onsuccess = () => resolve(request.result);
+        request.onerror = () => {
+            console.warn('History cache unavailable:', request.error);
+            resolve(null);
+        };
+    });
+}
+
+/*
+ * Delete expired chunks, load the rest into the store in time order and
+ * send the newest readings to the page
+ */
+async function restoreHistory() {
+    cacheDb = await openCache();
+    if (!cacheDb) return;
+
+    const firstBucket = Math.floor((Date.now() - settings.cacheRetentionMs) / CACHE_CHUNK_MS);
+    const chunks = await new Promise((resolve) => {
+        const transaction = cacheDb.transaction(CACHE_STORE_NAME, 'readwrite');
+        const chunkStore = transaction.objectStore(CACHE_STORE_NAME);
+        chunkStore.delete(IDBKeyRange.bound([settings.deviceId, -Infinity], [settings.deviceId, firstBucket], false, true));
+
+        const request = chunkStore.getAll(IDBKeyRange.bound([settings.deviceId, firstBucket], [settings.deviceId, Infinity]));
+        request.onsuccess = () => resolve(request.result);
+        request.onerror = () => resolve([]);
+    });
+
+    let restored = 0;
+    chunks.forEach(chunk => {
+        for (let i = 0; i < chunk.count; i++) {
+            if (storeReading(chunk.time[i], chunk.temperature[i], chunk.humidity[i], false)) {
+                restored++;
+            }
+        }
+    });
+
+    // New readings in the newest bucket are added to its chunk, not a fresh one
+    if (chunks.length > 0) {
+        const newest = chunks[chunks.length - 1];
+        openChunk = createChunk(newest.bucket, newest.count);
+        openChunk.time.set(newest.time);
+        openChunk.temperature.set(newest.temperature);
+        openChunk.humidity.set(newest.humidity);
+        openChunk.count = newest.count;
+        chunkFlushedAt = Date.now();
+    }
+
+    console.log(`History cache restored ${restored} readings from ${chunks.length} chunks`);
+    postHistory(settings.pagePoints);
+}
+
+/*
+ * Empty chunk with room for at least the given number of readings
+ * (one per second for the bucket to begin with)
+ */
+function createChunk(bucket, minimum) {
+    const capacity = Math.max(CACHE_CHUNK_MS / 1000, minimum);
+    return {
+        bucket,
+        count: 0,
+        time: new Float64Array(capacity),
+        temperature: new Float32Array(capacity),
+        humidity: new Float32Array(capacity)
+    };
+}
+
+/*
+ * Add a reading to the open chunk, starting a new one when its bucket changes
+ */
+function cacheReading(time, temperature, humidity) {
+    if (!cacheDb) return;
+
+    const bucket = Math.floor(time / CACHE_CHUNK_MS);
+    if (openChunk && openChunk.bucket !== bucket) {
+        flushChunk();
+        openChunk = null;
+    }
+    if (!openChunk) {
+        openChunk = createChunk(bucket, 0);
+    }
+
+    // More readings than expected in this bucket: double the chunk
+    if (openChunk.count === openChunk.time.length) {
+        const grown = createChunk(bucket, openChunk.count * 2);
+        grown.time.set(openChunk.time);
+        grown.temperature.set(openChunk.temperature);
+        grown.humidity.set(openChunk.humidity);
+        grown.count = openChunk.count;
+        openChunk = grown;
+    }
+
+    openChunk.time[openChunk.count] = time;
+    openChunk.temperature[openChunk.count] = temperature;
+    openChunk.humidity[openChunk.count] = humidity;
+    openChunk.count++;
+
+    if (Date.now() - chunkFlushedAt >= CACHE_FLUSH_MS) {
+        flushChunk();
+    }
+}
+
+/*
+ * Write the open chunk (replacing its earlier version)
+ */
+function flushChunk() {
+    chunkFlushedAt = Date.now();
+    if (!cacheDb || !openChunk || openChunk.count === 0) return;
+
+    // Copies trimmed to the readings held; a view would store the whole buffer
+    const count = openChunk.count;
+    const transaction = cacheDb.transaction(CACHE_STORE_NAME, 'readwrite');
+    transaction.objectStore(CACHE_STORE_NAME).put({
+        deviceId: settings.deviceId,
+        bucket: openChunk.bucket,
+        count,
+        time: openChunk.time.slice(0, count),
+        temperature: openChunk.temperature.slice(0, count),
+        humidity: openChunk.humidity.slice(0, count)
+    });
+    transaction.onerror = () => {
+        console.warn('History cache write failed:', transaction.error);
+    };
+}
+
+// ========================================
+// WINDOWED AGGREGATION
+// ========================================
+
+/*
+ * Trend of both series over the last trendPoints readings
+ * Returns null until enough readings are stored
+ */
+function calculateTrends() {
+    if (store.count < settings.trendPoints) {
+        return null;
+    }
+
+    return {
+        temperature: calculateTrend('temperature', settings.trendPoints),
+        humidity: calculateTrend('humidity', settings.trendPoints)
+    };
+}
+
+/*
+ * Calculate trend direction over the last points of a stored field
+ * Returns: 'up', 'down', or 'stable'
+ */
+function calculateTrend(field, points) {
+    const length = Math.min(points, store.count);
+    if (length < 2) return 'stable';
+
+    const firstValue = store.at(field, store.count - length);
+    const lastValue = store.at(field, store.count - 1);
+    const threshold = 0.1; // Minimum change to consider as trend
+
+    const change = lastValue - firstValue;
+
+    if (change > threshold) return 'up';
+    if (change < -threshold) return 'down';
+    return 'stable';
+}
+
+// ========================================
+// RANGE DECIMATION
+// ========================================
+
+/*
+ * Resend the followed range once a drawn point's worth of time has passed
+ * (6 s for 1H at 600 points, 144 s for 24H)
+ */
+function postRangeIfDue() {
+    if (!activeRange || store.count === 0) return;
+
+    const bucketMs = activeRange.minutes * 60 * 1000 / settings.rangePoints;
+    if (store.at('time', store.count - 1) - rangeSentTime >= bucketMs) {
+        postRange();
+    }
+}
+
+/*
+ * Decimate the readings in the followed range and transfer them to the page
+ */
+function postRange() {
+    const cutoffTime = Date.now() - activeRange.minutes * 60 * 1000;
+    const first = store.lowerBound(cutoffTime);
+    const series = decimate(first, store.count - first, settings.rangePoints);
+
+    rangeSentTime = store.count > 0 ? store.at('time', store.count - 1) : 0;
+    self.postMessage({
+        type: 'range',
+        range: activeRange.range,
+        time: series.time,
+        temperature: series.temperature,
+        humidity: series.humidity,
+        points: series.time.length
+    }, [series.time.buffer, series.temperature.buffer, series.humidity.buffer]);
+}
+
+/*
+ * Largest-Triangle-Three-Buckets downsampling of stored readings
+ * first..first + length - 1 to at most threshold points
+ * Both series share the chart's x axis, so one set of readings is kept for
+ * both: a candidate's triangle areas in the two series are added, each
+ * normalised by that series' value range in the window
+ * Returns new typed arrays, ready to transfer
+ */
+function decimate(first, length, threshold) {
+    const base = store.firstSlot() + first;
+    const times = store.fields.time;
+    const temperatures = store.fields.temperature;
+    const humidities = store.fields.humidity;
+
+    const count = (threshold >= 3 && length > threshold) ? threshold : length;
+    const result = {
+        time: new Float64Array(count),
+        temperature: new Float32Array(count),
+        humidity: new Float32Array(count)
+    };
+
+    // Few enough readings: send them as they are
+    if (count === length) {
+        result.time.set(times.subarray(base, base + length));
+        result.temperature.set(temperatures.subarray(base, base + length));
+        result.humidity.set(humidities.subarray(base, base + length));
+        return result;
+    }
+
+    let temperatureMin = Infinity, temperatureMax = -Infinity;
+    let humidityMin = Infinity, humidityMax = -Infinity;
+    for (let i = base; i < base + length; i++) {
+        if (temperatures[i] < temperatureMin) temperatureMin = temperatures[i];
+        if (temperatures[i] > temperatureMax) temperatureMax = temperatures[i];
+        if (humidities[i] < humidityMin) humidityMin = humidities[i];
+        if (humidities[i] > humidityMax) humidityMax = humidities[i];
+    }
+    const temperatureScale = temperatureMax > temperatureMin ? 1 / (temperatureMax - temperatureMin) : 0;
+    const humidityScale = humidityMax > humidityMin ? 1 / (humidityMax - humidityMin) : 0;
+
+    // Times relative to the first reading keep the products well inside double precision
+    const origin = times[base];
+    const keep = (out, index) => {
+        result.time[out] = times[base + index];
+        result.temperature[out] = temperatures[base + index];
+        result.humidity[out] = humidities[base + index];
+    };
+
+    const every = (length - 2) / (count - 2);
+    let selected = 0;
+    keep(0, 0);
+
+    for (let bucket = 0; bucket < count - 2; bucket++) {
+        // Average of the next bucket is the third corner of the triangle
+        const averageStart = Math.floor((bucket + 1) * every) + 1;
+        const averageEnd = Math.min(Math.floor((bucket + 2) * every) + 1, length);
+        let averageX = 0, averageTemperature = 0, averageHumidity = 0;
+        for (let i = averageStart; i < averageEnd; i++) {
+            averageX += times[base + i] - origin;
+            averageTemperature += temperatures[base + i];
+            averageHumidity += humidities[base + i];
+        }
+        const averageLength = averageEnd - averageStart;
+        averageX /= averageLength;
+        averageTemperature /= averageLength;
+        averageHumidity /= averageLength;
+
+        // Keep the reading of this bucket with the largest triangle
+        const pointX = times[base + selected] - origin;
+        const pointTemperature = temperatures[base + selected];
+        const pointHumidity = humidities[base + selected];
+        const rangeStart = Math.floor(bucket * every) + 1;
+        const rangeEnd = Math.floor((bucket + 1) * every) + 1;
+
+        let maxArea = -1;
+        let next = rangeStart;
+        for (let i = rangeStart; i < rangeEnd; i++) {
+            const x = times[base + i] - origin;
+            const area = Math.abs((pointX - averageX) * (temperatures[base + i] - pointTemperature) -
+                                  (pointX - x) * (averageTemperature - pointTemperature)) * temperatureScale +
+                         Math.abs((pointX - averageX) * (humidities[base + i] - pointHumidity) -
+                                  (pointX - x) * (averageHumidity - pointHumidity)) * humidityScale;
+            if (area > maxArea) {
+                maxArea = area;
+                next = i;
+            }
+        }
+
+        keep(bucket + 1, next);
+        selected = next;
+    }
+
+    keep(count - 1, length - 1);
+    return result;
+}
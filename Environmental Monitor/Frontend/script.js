@@ -3,14 +3,28 @@ let temperatureChart = null;
 let humidityChart = null;
 let historicalChart = null;
 
-// Data storage arrays for time-series data
-let temperatureData = [];
-let humidityData = [];
-let historicalData = [];
+// Time-series storage (typed-array ring buffers, created with the charts)
+let realtimeSeries = null;
+let historicalSeries = null;
 
-// Update intervals and timers
-let updateInterval = null;
-let connectionCheckInterval = null;
+// Selected historical range ('1H', '6H', '24H'); null shows the latest readings
+let historicalRange = null;
+
+// Decimated series for the selected range, from the data worker
+let historicalRangeData = null;
+
+// Worker that fetches, decodes and aggregates readings (data-worker.js)
+let dataWorker = null;
+
+// Render scheduling: dirty and on-screen state per chart, one animation frame for all
+const renderTargets = new Map();
+let renderFrameRequested = false;
+let chartVisibilityObserver = null;
+
+// Polling scheduler: one timer, at most one request in flight
+let pollTimer = null;
+let pollInFlight = false;
+let pollStartedAt = 0;
 
 // Configuration settings for Vercel backend communication
 const CONFIG = {
@@ -18,11 +32,14 @@ const CONFIG = {
     backendEndpoint: 'https://environment-monitor-project.vercel.app',  // Your Vercel backend URL
     deviceId: 'ESP32-S3-001',
     updateInterval: 1000,                   // Update data every 1 second
-    connectionCheckInterval: 5000,          // Check connection every 5 seconds
+    hiddenUpdateInterval: 30000,            // Update interval while the tab is hidden
+    maxRetryInterval: 30000,                // Longest backoff delay after failed requests
     maxDataPoints: 60,                      // Keep last 60 points for real-time charts
     historicalDataPoints: 1000,             // Maximum historical data points to store
+    historyRetentionPoints: 86400,          // Readings kept by the data worker (24 hours at 1 second)
+    rangeChartPoints: 600,                  // Points drawn for a historical range (LTTB decimation)
+    historyCacheHours: 24,                  // Readings kept in the browser's IndexedDB cache
     requestTimeout: 5000,                   // HTTP request timeout in milliseconds
-    reconnectAttempts: 3,                   // Number of reconnection attempts
     trendCalculationPoints: 10              // Number of points for trend calculation
 };
 
@@ -30,8 +47,8 @@ const CONFIG = {
 let connectionState = {
     isConnected: false,
     lastSuccessfulUpdate: 0,
-    reconnectAttempts: 0,
-    connectionQuality: 'excellent', // excellent, good, poor, disconnected
+    reconnectAttempts: 0,           // Consecutive failed requests
+    connectionQuality: 'excellent', // excellent, good, poor, disconnected (from data response times)
     backendUrl: CONFIG.backendEndpoint
 };
 
@@ -49,9 +66,10 @@ document.addEventListener('DOMContentLoaded', function() {
     
     // Initialize all components
     initializeCharts();
+    startRenderScheduler();
     setupEventListeners();
+    startDataWorker();
     startDataUpdates();
-    startConnectionMonitoring();
     updateLastUpdatedTime();
     
     console.log('=== Dashboard Initialized Successfully ===');
@@ -64,6 +82,10 @@ document.addEventListener('DOMContentLoaded', function() {
 function initializeCharts() {
     console.log('Initializing charts...');
     
+    // Chart datasets are views into these rings, so they are allocated once here
+    realtimeSeries = new SeriesRing(CONFIG.maxDataPoints);
+    historicalSeries = new SeriesRing(CONFIG.historicalDataPoints);
+    
     // Temperature real-time chart (mini sparkline)
     const tempCtx = document.getElementById('temperature-chart').getContext('2d');
     temperatureChart = new Chart(tempCtx, {
@@ -175,6 +197,11 @@ function initializeCharts() {
                 tooltip: {
                     mode: 'index',
                     intersect: false,
+                    callbacks: {
+                        // Labels are timestamps and values are float32
+                        title: (items) => items.length ? formatTimeLabel(items[0].label) : '',
+                        label: (item) => `${item.dataset.label}: ${formatNumber(item.parsed.y)}`
+                    }
                 }
             },
             scales: {
@@ -186,6 +213,13 @@ function initializeCharts() {
                     },
                     grid: {
                         display: false
+                    },
+                    ticks: {
+                        // Only the ticks actually drawn are formatted, each reading once
+                        callback: function(value) {
+                            const time = this.getLabelForValue(value);
+                            return historicalRange ? formatTimeLabel(time) : historicalSeries.timeLabel(value, time);
+                        }
                     }
                 },
                 y: {
@@ -214,6 +248,10 @@ function initializeCharts() {
                 mode: 'nearest',
                 axis: 'x',
                 intersect: false
+            },
+            normalized: true,                   // Indices are unique and sorted
+            animation: {
+                duration: 0 // Live appends are drawn in place, not animated
             }
         }
     });
@@ -301,92 +339,180 @@ function setupEventListeners() {
 
 /*
  * Start the main data update cycle
- * Fetches sensor data from Vercel backend at regular intervals
+ * Each request schedules the next one when it completes, so requests never
+ * overlap; the data responses double as the connection check
  */
 function startDataUpdates() {
     console.log('Starting data updates from Vercel backend...');
     
     // Initial data fetch
-    fetchSensorData();
+    pollSensorData();
     
-    // Set up periodic data updates
-    updateInterval = setInterval(() => {
-        fetchSensorData();
-    }, CONFIG.updateInterval);
+    // Slow down in background tabs; refresh at once when the tab is shown again
+    document.addEventListener('visibilitychange', () => {
+        if (!document.hidden && !pollInFlight) {
+            pollSensorData();
+        }
+    });
 }
 
 /*
- * Fetch sensor data from Vercel backend API
- * Handles both successful responses and error scenarios
+ * Issue one data request unless one is still in flight
  */
-async function fetchSensorData() {
-    try {
-        console.log('Fetching sensor data from Vercel backend...');
-        
-        const apiUrl = `${CONFIG.backendEndpoint}/api/readings/${CONFIG.deviceId}`;
-        
-        const response = await fetch(apiUrl, {
-            method: 'GET',
-            headers: {
-                'Content-Type': 'application/json',
-            },
-            signal: AbortSignal.timeout(CONFIG.requestTimeout)
-        });
+function pollSensorData() {
+    clearTimeout(pollTimer);
+    pollTimer = null;
+    if (pollInFlight) return;
+    
+    pollInFlight = true;
+    pollStartedAt = performance.now();
+    fetchSensorData();
+}
 
-        if (!response.ok) {
-            throw new Error(`HTTP error! status: ${response.status}`);
-        }
+/*
+ * Finish the request in flight and schedule the next one
+ * Failures back off exponentially (1 s, 2 s, 4 s ... up to maxRetryInterval)
+ * with jitter, so several open dashboards do not retry in step
+ */
+function completePoll(success) {
+    if (!pollInFlight) return;
+    pollInFlight = false;
+    
+    // Keep the cadence: the time the request took counts towards the interval
+    let delay = document.hidden ? CONFIG.hiddenUpdateInterval : CONFIG.updateInterval;
+    delay = Math.max(0, delay - (performance.now() - pollStartedAt));
+    if (!success) {
+        const backoff = Math.min(CONFIG.maxRetryInterval, CONFIG.updateInterval * Math.pow(2, connectionState.reconnectAttempts - 1));
+        delay = Math.max(delay, backoff / 2 + Math.random() * backoff / 2);
+        console.log(`Retrying in ${Math.round(delay / 1000)}s (attempt ${connectionState.reconnectAttempts})`);
+    }
+    
+    pollTimer = setTimeout(pollSensorData, delay);
+}
 
-        const data = await response.json();
-        
-        // Process the received data
-        processSensorData(data);
-        
-        // Update connection status
-        updateConnectionStatus(true);
-        
-        console.log('Sensor data fetched successfully from backend:', data.current);
-        
-    } catch (error) {
-        console.error('Error fetching sensor data:', error);
-        updateConnectionStatus(false);
-        
-        // Generate simulated data for demonstration when backend is not available
-        if (connectionState.reconnectAttempts === 0) {
-            console.log('Using simulated data for demonstration');
-            const simulatedData = generateSimulatedData();
-            processSensorData(simulatedData);
+/*
+ * Start the data worker and pass it the settings it needs
+ * Fetching, decoding, trends and range decimation all run there
+ */
+function startDataWorker() {
+    dataWorker = new Worker('data-worker.js');
+    dataWorker.onmessage = handleWorkerMessage;
+    dataWorker.onerror = (event) => {
+        console.error('Data worker error:', event.message);
+    };
+    
+    dataWorker.postMessage({
+        type: 'configure',
+        settings: {
+            deviceId: CONFIG.deviceId,
+            retentionPoints: CONFIG.historyRetentionPoints,
+            trendPoints: CONFIG.trendCalculationPoints,
+            rangePoints: CONFIG.rangeChartPoints,
+            pagePoints: CONFIG.historicalDataPoints,
+            cacheRetentionMs: CONFIG.historyCacheHours * 60 * 60 * 1000
         }
+    });
+    
+    // Save readings not yet written to the cache while the page can still run
+    document.addEventListener('visibilitychange', () => {
+        if (document.hidden) dataWorker.postMessage({ type: 'flush' });
+    });
+}
+
+/*
+ * Fetch sensor data from Vercel backend API
+ * The data worker fetches and decodes it; the result comes back to handleWorkerMessage()
+ */
+function fetchSensorData() {
+    console.log('Fetching sensor data from Vercel backend...');
+    
+    const apiUrl = `${CONFIG.backendEndpoint}/api/readings/${CONFIG.deviceId}`;
+    dataWorker.postMessage({ type: 'fetch', url: apiUrl, timeout: CONFIG.requestTimeout });
+}
+
+/*
+ * Handle results from the data worker
+ * Handles both successful responses and error scenarios
+ */
+function handleWorkerMessage(event) {
+    const message = event.data;
+    
+    switch (message.type) {
+        case 'reading':
+            // Process the received data
+            processSensorData(message);
+            
+            if (!message.simulated) {
+                updateConnectionStatus(true);
+                completePoll(true);
+                console.log('Sensor data fetched successfully from backend:', message.current);
+            }
+            break;
+            
+        case 'invalid':
+            console.error('Invalid sensor data format');
+            updateConnectionStatus(true);
+            completePoll(true);
+            break;
+            
+        case 'error':
+            console.error('Error fetching sensor data:', message.message);
+            updateConnectionStatus(false);
+            completePoll(false);
+            
+            // Generate simulated data for demonstration when backend is not available
+            if (connectionState.reconnectAttempts === 0) {
+                console.log('Using simulated data for demonstration');
+                dataWorker.postMessage({ type: 'ingest', data: generateSimulatedData(), simulated: true });
+            }
+            break;
+            
+        case 'history':
+            receiveHistory(message);
+            break;
+            
+        case 'range':
+            receiveHistoricalRange(message);
+            break;
     }
 }
 
 /*
- * Process sensor data and update dashboard
- * Updates UI elements, charts, and calculations
+ * Add readings restored from the cache or new in the device's history
+ * page to the live charts (oldest first; ones already shown are skipped)
  */
-function processSensorData(data) {
-    if (!data.current) {
-        console.error('Invalid sensor data format');
-        return;
+function receiveHistory(message) {
+    const newestTime = historicalSeries.count > 0 ? historicalSeries.at('time', historicalSeries.count - 1) : -Infinity;
+    
+    for (let i = 0; i < message.time.length; i++) {
+        if (message.time[i] <= newestTime) continue;
+        
+        realtimeSeries.push(message.time[i], message.temperature[i], message.humidity[i]);
+        historicalSeries.push(message.time[i], message.temperature[i], message.humidity[i]);
     }
+    
+    markChartDirty(temperatureChart);
+    markChartDirty(humidityChart);
+    markChartDirty(historicalChart);
+}
 
-    const { temperature, humidity, timestamp } = data.current;
-    const currentTime = timestamp ? new Date(timestamp) : new Date();
+/*
+ * Process a reading decoded by the data worker and update dashboard
+ * Updates UI elements and charts; trends arrive precomputed
+ */
+function processSensorData(reading) {
+    const { temperature, humidity } = reading.current;
 
     // Update main value displays
     updateValueDisplays(temperature, humidity);
     
-    // Update trend indicators and calculations
-    updateTrendAnalysis(temperature, humidity);
-    
-    // Update real-time charts
-    updateRealTimeCharts(temperature, humidity, currentTime);
+    // Update trend indicators
+    updateTrendAnalysis(reading.trend);
     
-    // Store and update historical data
-    updateHistoricalData(temperature, humidity, currentTime);
+    // The charts get the reading from the device's history page (receiveHistory)
     
-    // Update environmental insights
-    updateEnvironmentalInsights(temperature, humidity);
+    // Update environmental insights (derived values come precomputed from the device)
+    updateEnvironmentalInsights(temperature, humidity, reading.current);
     
     // Update last updated timestamp
     updateLastUpdatedTime();
@@ -422,14 +548,17 @@ function generateSimulatedData() {
     const humidityVariation = (Math.random() - 0.5) * 5; // Random variation
     const humidity = Math.max(20, Math.min(80, baseHumidity + humidityVariation));
     
+    const reading = {
+        temperature: +temperature.toFixed(1),
+        humidity: +humidity.toFixed(1),
+        timestamp: now,
+        epoch_ms: now,
+        timestamp_iso: new Date(now).toISOString()
+    };
+    
     return {
-        current: {
-            temperature: +temperature.toFixed(1),
-            humidity: +humidity.toFixed(1),
-            timestamp: now,
-            timestamp_iso: new Date(now).toISOString()
-        },
-        history: [], // Will be populated with simulated historical data if needed
+        current: reading,
+        history: [reading], // The charts are fed from the history page
         metadata: {
             total_readings: Math.floor(now / 1000),
             buffer_size: 1000,
@@ -441,114 +570,161 @@ function generateSimulatedData() {
 }
 
 // ========================================
-// CHART UPDATES AND VISUALIZATION
+// RENDER SCHEDULING
 // ========================================
 
 /*
- * Update real-time mini charts with new sensor readings
- * Maintains rolling window of recent data for trend visualization
+ * Register the charts with the scheduler and track which are on screen
+ * New readings only mark charts dirty; drawing happens once per animation
+ * frame, for the charts that are visible, with whatever arrived meanwhile
  */
-function updateRealTimeCharts(temperature, humidity, timestamp) {
-    const timeLabel = timestamp.toLocaleTimeString();
+function startRenderScheduler() {
+    renderTargets.set(temperatureChart, { apply: () => applyRealTimeView(temperatureChart, 'temperature'), dirty: false, visible: true });
+    renderTargets.set(humidityChart, { apply: () => applyRealTimeView(humidityChart, 'humidity'), dirty: false, visible: true });
+    renderTargets.set(historicalChart, { apply: updateHistoricalChartDisplay, dirty: false, visible: true });
     
-    // Update temperature chart
-    temperatureData.push(temperature);
-    if (temperatureData.length > CONFIG.maxDataPoints) {
-        temperatureData.shift();
+    // Charts scrolled out of view stay dirty until they come back
+    if ('IntersectionObserver' in window) {
+        chartVisibilityObserver = new IntersectionObserver((entries) => {
+            entries.forEach(entry => {
+                renderTargets.forEach((target, chart) => {
+                    if (chart.canvas === entry.target) target.visible = entry.isIntersecting;
+                });
+            });
+            scheduleRender();
+        });
+        renderTargets.forEach((target, chart) => chartVisibilityObserver.observe(chart.canvas));
     }
     
-    temperatureChart.data.labels = temperatureData.map(() => '');
-    temperatureChart.data.datasets[0].data = temperatureData;
-    temperatureChart.update('none'); // Update without animation for smooth real-time updates
+    // Animation frames stop in background tabs; catch up once on return
+    document.addEventListener('visibilitychange', () => {
+        if (!document.hidden) scheduleRender();
+    });
+}
 
-    // Update humidity chart
-    humidityData.push(humidity);
-    if (humidityData.length > CONFIG.maxDataPoints) {
-        humidityData.shift();
-    }
+/*
+ * Mark a chart as needing a redraw on the next frame
+ */
+function markChartDirty(chart) {
+    const target = renderTargets.get(chart);
+    if (!target) return;
     
-    humidityChart.data.labels = humidityData.map(() => '');
-    humidityChart.data.datasets[0].data = humidityData;
-    humidityChart.update('none'); // Update without animation for smooth real-time updates
+    target.dirty = true;
+    scheduleRender();
 }
 
 /*
- * Update historical data storage and visualization
- * Maintains time-series data for trend analysis
+ * Request one animation frame for all dirty charts
  */
-function updateHistoricalData(temperature, humidity, timestamp) {
-    const dataPoint = {
-        temperature,
-        humidity,
-        timestamp: timestamp.getTime()
-    };
+function scheduleRender() {
+    if (renderFrameRequested || document.hidden) return;
     
-    historicalData.push(dataPoint);
+    renderFrameRequested = true;
+    requestAnimationFrame(renderDirtyCharts);
+}
+
+/*
+ * Redraw the dirty charts that are on screen, without animation
+ */
+function renderDirtyCharts() {
+    renderFrameRequested = false;
+    if (document.hidden) return;
     
-    // Limit historical data to prevent memory issues
-    if (historicalData.length > CONFIG.historicalDataPoints) {
-        historicalData.shift();
-    }
+    renderTargets.forEach(renderTarget);
+}
+
+/*
+ * Redraw one chart if it is dirty and on screen
+ */
+function renderTarget(target, chart) {
+    if (!target.dirty || !target.visible) return;
     
-    // Update historical chart (show last 50 points for readability)
-    updateHistoricalChartDisplay();
+    target.apply();
+    chart.update('none');
+    target.dirty = false;
+}
+
+// ========================================
+// CHART UPDATES AND VISUALIZATION
+// ========================================
+
+/*
+ * Point a sparkline at the current window of the real-time ring
+ * Timestamps serve as the (hidden) labels
+ */
+function applyRealTimeView(chart, field) {
+    chart.data.labels = realtimeSeries.view('time');
+    chart.data.datasets[0].data = realtimeSeries.view(field);
 }
 
 /*
- * Update the historical chart display with current data
+ * Point the historical chart at its data
+ * A selected range shows the decimated series from the data worker. Otherwise
+ * the chart holds every reading stored here and the x axis minimum selects
+ * the last 50 points for readability
  */
 function updateHistoricalChartDisplay() {
-    if (historicalData.length === 0) return;
+    if (historicalRange) {
+        if (!historicalRangeData) return; // Still being computed
+        
+        historicalChart.options.scales.x.min = undefined;
+        historicalChart.data.labels = historicalRangeData.time;
+        historicalChart.data.datasets[0].data = historicalRangeData.temperature;
+        historicalChart.data.datasets[1].data = historicalRangeData.humidity;
+        return;
+    }
     
     const maxPoints = 50; // Limit points for better visualization
-    const startIndex = Math.max(0, historicalData.length - maxPoints);
-    const displayData = historicalData.slice(startIndex);
-    
-    const labels = displayData.map(d => new Date(d.timestamp).toLocaleTimeString());
-    const temperatures = displayData.map(d => d.temperature);
-    const humidities = displayData.map(d => d.humidity);
-    
-    historicalChart.data.labels = labels;
-    historicalChart.data.datasets[0].data = temperatures;
-    historicalChart.data.datasets[1].data = humidities;
-    historicalChart.update();
+    historicalChart.options.scales.x.min = Math.max(0, historicalSeries.count - maxPoints);
+    historicalChart.data.labels = historicalSeries.view('time');
+    historicalChart.data.datasets[0].data = historicalSeries.view('temperature');
+    historicalChart.data.datasets[1].data = historicalSeries.view('humidity');
 }
 
 /*
  * Update historical chart based on selected time range
- * Filters historical data to show specified time period
+ * The data worker decimates the range and keeps it current as readings arrive
  */
 function updateHistoricalChart(range) {
     console.log(`Updating historical chart for range: ${range}`);
     
-    let timePoints;
+    historicalRange = range;
+    historicalRangeData = null;
+    dataWorker.postMessage({ type: 'range', range, minutes: historicalRangeMinutes(range) });
+}
+
+/*
+ * Take a decimated range from the data worker (the arrays were transferred)
+ */
+function receiveHistoricalRange(message) {
+    if (message.range !== historicalRange) return; // Superseded by another selection
+    
+    if (!historicalRangeData) {
+        console.log(`Historical chart updated with ${message.points} data points`);
+    }
+    
+    // Non-extensible so Chart.js does not patch array methods onto them
+    historicalRangeData = {
+        time: Object.preventExtensions(message.time),
+        temperature: Object.preventExtensions(message.temperature),
+        humidity: Object.preventExtensions(message.humidity)
+    };
+    markChartDirty(historicalChart);
+}
+
+/*
+ * Length of a historical range in minutes
+ */
+function historicalRangeMinutes(range) {
     switch(range) {
-        case '1H':
-            timePoints = 60;
-            break;
         case '6H':
-            timePoints = 360;
-            break;
+            return 360;
         case '24H':
-            timePoints = 1440;
-            break;
+            return 1440;
+        case '1H':
         default:
-            timePoints = 60;
+            return 60;
     }
-    
-    const cutoffTime = Date.now() - (timePoints * 60 * 1000);
-    const filteredData = historicalData.filter(d => d.timestamp >= cutoffTime);
-    
-    const labels = filteredData.map(d => new Date(d.timestamp).toLocaleTimeString());
-    const temperatures = filteredData.map(d => d.temperature);
-    const humidities = filteredData.map(d => d.humidity);
-    
-    historicalChart.data.labels = labels;
-    historicalChart.data.datasets[0].data = temperatures;
-    historicalChart.data.datasets[1].data = humidities;
-    historicalChart.update();
-    
-    console.log(`Historical chart updated with ${filteredData.length} data points`);
 }
 
 // ========================================
@@ -556,41 +732,16 @@ function updateHistoricalChart(range) {
 // ========================================
 
 /*
- * Calculate and display trend indicators
- * Compares current readings with recent data to determine direction
+ * Display the trend indicators computed by the data worker
+ * The trend is null until it holds enough readings
  */
-function updateTrendAnalysis(temperature, humidity) {
-    if (temperatureData.length < CONFIG.trendCalculationPoints) {
+function updateTrendAnalysis(trend) {
+    if (!trend) {
         return; // Not enough data for trend calculation
     }
     
-    // Calculate temperature trend
-    const recentTemp = temperatureData.slice(-CONFIG.trendCalculationPoints);
-    const tempTrend = calculateTrend(recentTemp);
-    updateTrendIcon('temp-trend', tempTrend);
-    
-    // Calculate humidity trend
-    const recentHumidity = humidityData.slice(-CONFIG.trendCalculationPoints);
-    const humidityTrend = calculateTrend(recentHumidity);
-    updateTrendIcon('humidity-trend', humidityTrend);
-}
-
-/*
- * Calculate trend direction from data array
- * Returns: 'up', 'down', or 'stable'
- */
-function calculateTrend(data) {
-    if (data.length < 2) return 'stable';
-    
-    const firstValue = data[0];
-    const lastValue = data[data.length - 1];
-    const threshold = 0.1; // Minimum change to consider as trend
-    
-    const change = lastValue - firstValue;
-    
-    if (change > threshold) return 'up';
-    if (change < -threshold) return 'down';
-    return 'stable';
+    updateTrendIcon('temp-trend', trend.temperature);
+    updateTrendIcon('humidity-trend', trend.humidity);
 }
 
 /*
@@ -620,7 +771,7 @@ function updateTrendIcon(elementId, trend) {
  * Update environmental insights based on current readings
  * Provides comfort level indicators and recommendations
  */
-function updateEnvironmentalInsights(temperature, humidity) {
+function updateEnvironmentalInsights(temperature, humidity, derived = {}) {
     // Temperature comfort assessment
     updateTemperatureComfort(temperature);
     
@@ -628,7 +779,7 @@ function updateEnvironmentalInsights(temperature, humidity) {
     updateAirQuality(temperature, humidity);
     
     // Heat index calculation and assessment
-    updateHeatIndex(temperature, humidity);
+    updateHeatIndex(temperature, humidity, derived.heat_index);
     
     // Humidity level assessment
     updateHumidityLevel(humidity);
@@ -689,15 +840,19 @@ function updateAirQuality(temperature, humidity) {
 }
 
 /*
- * Calculate and assess heat index
+ * Assess heat index
+ * Uses the NWS heat index computed by the firmware at sample time
  */
-function updateHeatIndex(temperature, humidity) {
+function updateHeatIndex(temperature, humidity, deviceHeatIndex) {
     const element = document.getElementById('heat-index');
     
-    // Simplified heat index calculation (for temperatures above 27°C)
-    let heatIndex = temperature;
-    if (temperature > 27) {
-        heatIndex = temperature + (humidity * 0.5);
+    // Older firmware and simulated data do not include it - fall back to a rough estimate
+    let heatIndex = deviceHeatIndex;
+    if (typeof heatIndex !== 'number') {
+        heatIndex = temperature;
+        if (temperature > 27) {
+            heatIndex = temperature + (humidity * 0.5);
+        }
     }
     
     let level;
@@ -738,79 +893,52 @@ function updateHumidityLevel(humidity) {
 // CONNECTION MANAGEMENT
 // ========================================
 
-/*
- * Start connection monitoring to Vercel backend
- * Checks connection status periodically
- */
-function startConnectionMonitoring() {
-    connectionCheckInterval = setInterval(() => {
-        checkConnectionStatus();
-    }, CONFIG.connectionCheckInterval);
-}
-
-/*
- * Check connection status to Vercel backend
- */
-async function checkConnectionStatus() {
-    try {
-        const healthUrl = `${CONFIG.backendEndpoint}/api/health`;
-        const response = await fetch(healthUrl, {
-            method: 'GET',
-            signal: AbortSignal.timeout(3000)
-        });
-        
-        if (response.ok) {
-            const healthData = await response.json();
-            updateConnectionStatus(true, healthData);
-        } else {
-            updateConnectionStatus(false);
-        }
-    } catch (error) {
-        updateConnectionStatus(false);
-    }
-}
-
 /*
  * Update connection status indicators
+ * Health comes from the data requests themselves: their outcome and how long
+ * the request in flight took
  */
-function updateConnectionStatus(isConnected, healthData = null) {
+function updateConnectionStatus(isConnected) {
     connectionState.isConnected = isConnected;
     
+    // Update connection indicator
+    const statusElement = document.getElementById('connection-status');
+    const textElement = document.getElementById('connection-text');
+    const qualityElement = document.getElementById('backend-status');
+    
     if (isConnected) {
         connectionState.lastSuccessfulUpdate = Date.now();
         connectionState.reconnectAttempts = 0;
         
-        // Update connection indicator
-        const statusElement = document.getElementById('connection-status');
-        const textElement = document.getElementById('connection-text');
-        const qualityElement = document.getElementById('backend-status');
+        const responseTime = performance.now() - pollStartedAt;
+        if (responseTime < 500) {
+            connectionState.connectionQuality = 'excellent';
+        } else if (responseTime < 2000) {
+            connectionState.connectionQuality = 'good';
+        } else {
+            connectionState.connectionQuality = 'poor';
+        }
         
         statusElement.className = 'w-3 h-3 bg-green-500 rounded-full connection-indicator';
         textElement.textContent = 'Vercel Backend Connected';
         textElement.className = 'ml-2 text-sm text-green-600';
-        qualityElement.textContent = 'Connected';
-        qualityElement.className = 'text-sm font-medium text-green-600';
+        
+        if (connectionState.connectionQuality === 'poor') {
+            qualityElement.textContent = 'Slow';
+            qualityElement.className = 'text-sm font-medium text-yellow-600';
+        } else {
+            qualityElement.textContent = 'Connected';
+            qualityElement.className = 'text-sm font-medium text-green-600';
+        }
     } else {
         connectionState.reconnectAttempts++;
-        
-        // Update connection indicator
-        const statusElement = document.getElementById('connection-status');
-        const textElement = document.getElementById('connection-text');
-        const qualityElement = document.getElementById('backend-status');
+        connectionState.connectionQuality = 'disconnected';
         
         statusElement.className = 'w-3 h-3 bg-red-500 rounded-full';
         textElement.textContent = 'Backend Disconnected';
         textElement.className = 'ml-2 text-sm text-red-600';
         qualityElement.textContent = 'Disconnected';
         qualityElement.className = 'text-sm font-medium text-red-600';
-        
-        // Attempt reconnection
-        if (connectionState.reconnectAttempts < CONFIG.reconnectAttempts) {
-            console.log(`Attempting reconnection (${connectionState.reconnectAttempts}/${CONFIG.reconnectAttempts})`);
-            setTimeout(() => {
-                fetchSensorData();
-            }, 2000 * connectionState.reconnectAttempts);
-        }
     }
 }
 
@@ -843,6 +971,13 @@ function debounce(func, wait) {
     };
 }
 
+/*
+ * Format a timestamp (milliseconds, or its string form from Chart.js) as a time label
+ */
+function formatTimeLabel(timestamp) {
+    return new Date(Number(timestamp)).toLocaleTimeString();
+}
+
 /*
  * Format number to specified decimal places
  */
@@ -856,17 +991,22 @@ function formatNumber(number, decimals = 1) {
 
 /*
  * Cleanup function called when page is unloaded
- * Clears intervals and cleans up resources
+ * Clears the polling timer and cleans up resources
  */
 window.addEventListener('beforeunload', () => {
     console.log('Cleaning up dashboard resources...');
     
-    if (updateInterval) {
-        clearInterval(updateInterval);
+    if (pollTimer) {
+        clearTimeout(pollTimer);
+    }
+    
+    if (chartVisibilityObserver) {
+        chartVisibilityObserver.disconnect();
     }
     
-    if (connectionCheckInterval) {
-        clearInterval(connectionCheckInterval);
+    // The worker ends with the page; ask it to write its open cache chunk first
+    if (dataWorker) {
+        dataWorker.postMessage({ type: 'flush' });
     }
     
     // Destroy charts to free memory
@@ -0,0 +1,123 @@
+/*
+ * Time-series ring buffer shared by the dashboard and its data worker
+ * (loaded with a script tag by index.html and with importScripts by
+ * data-worker.js)
+ */
+
+// ========================================
+// TIME-SERIES STORAGE
+// ========================================
+
+/*
+ * Fixed-capacity series of readings, one typed array per field
+ * (timestamps as Float64Array, values as Float32Array)
+ * Every sample is written twice, at its slot and at slot + capacity, so the
+ * stored samples are always contiguous in time order and a chart can be given
+ * a subarray view instead of a copy. Once the ring has wrapped, the view for
+ * each start offset is created once and reused: appending allocates nothing.
+ */
+class SeriesRing {
+    constructor(capacity) {
+        this.capacity = capacity;
+        this.count = 0;
+        this.total = 0;                     // Samples appended since creation
+        this.fields = {
+            time: new Float64Array(capacity * 2),
+            temperature: new Float32Array(capacity * 2),
+            humidity: new Float32Array(capacity * 2)
+        };
+        
+        // Created on first use: the data worker's long store never needs them
+        this.views = null;
+        this.labels = null;
+        this.labelTimes = null;
+    }
+    
+    /*
+     * Append one reading, overwriting the oldest when full
+     */
+    push(time, temperature, humidity) {
+        const slot = this.total % this.capacity;
+        const mirror = slot + this.capacity;
+        
+        this.fields.time[slot] = this.fields.time[mirror] = time;
+        this.fields.temperature[slot] = this.fields.temperature[mirror] = temperature;
+        this.fields.humidity[slot] = this.fields.humidity[mirror] = humidity;
+        
+        this.total++;
+        if (this.count < this.capacity) this.count++;
+    }
+    
+    /*
+     * Index of the oldest stored sample in the field arrays; the stored
+     * samples follow it contiguously
+     */
+    firstSlot() {
+        return (this.total - this.count) % this.capacity;
+    }
+    
+    /*
+     * Value of a field by position, 0 being the oldest stored sample
+     */
+    at(field, index) {
+        return this.fields[field][this.firstSlot() + index];
+    }
+    
+    /*
+     * All stored samples of a field, oldest first, as a view (not a copy)
+     * Views are non-extensible so Chart.js does not patch array methods onto them
+     */
+    view(field) {
+        const start = this.firstSlot();
+        
+        // Still filling: the view grows with every sample until the first wrap
+        if (this.count < this.capacity) {
+            return Object.preventExtensions(this.fields[field].subarray(0, this.count));
+        }
+        
+        if (!this.views) {
+            this.views = { time: [], temperature: [], humidity: [] };
+        }
+        const cache = this.views[field];
+        if (!cache[start]) {
+            cache[start] = Object.preventExtensions(this.fields[field].subarray(start, start + this.capacity));
+        }
+        return cache[start];
+    }
+    
+    /*
+     * Time label of a sample by position, formatted once per reading
+     * The timestamp is the one the chart holds; a chart drawn before the
+     * latest append still gets the right text
+     */
+    timeLabel(index, time) {
+        if (!this.labels) {
+            this.labels = new Array(this.capacity).fill('');
+            this.labelTimes = new Float64Array(this.capacity).fill(NaN);
+        }
+        
+        const slot = (this.firstSlot() + index) % this.capacity;
+        if (this.labelTimes[slot] !== Number(time)) {
+            this.labels[slot] = new Date(Number(time)).toLocaleTimeString();
+            this.labelTimes[slot] = Number(time);
+        }
+        return this.labels[slot];
+    }
+    
+    /*
+     * Position of the first sample at or after a time (count when there is none)
+     */
+    lowerBound(time) {
+        let low = 0;
+        let high = this.count;
+        while (low < high) {
+            const middle = (low + high) >>> 1;
+            if (this.at('time', middle) < time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+}
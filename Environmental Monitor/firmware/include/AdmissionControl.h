@@ -0,0 +1,116 @@
+/*
+ * Request Admission Control
+ *
+ * Decides, before a handler runs, whether the device can afford it. Each
+ * route has a priority class and a cost in budget units (1 unit ~ 1 ms of
+ * loop time). Three checks, in order:
+ *
+ *   Sampler deadline  a request whose cost does not fit before the next
+ *                     sample is deferred (left in the receive buffer) until
+ *                     the sample has been taken - for every class
+ *   Global budget     one token bucket for the whole server; lower classes
+ *                     may only spend while the level stays above a reserve
+ *                     kept for the classes above them
+ *   Client budget     a token bucket per client address, so one poller
+ *                     cannot use up the global budget
+ *
+ * Over budget the request is shed with 503 and a Retry-After computed from
+ * the refill rate. After the handler runs its measured time replaces the
+ * estimate, so the budget tracks real loop time.
+ *
+ * Both budgets are charged the route cost plus ADMISSION_PASS_COST: loop()
+ * serves one request per pass, so a cheap request still holds the loop for
+ * the pass delay. Without it a 15 ms /data costs 25 ms of loop time while
+ * charging 15, and enough dashboards fill the accept backlog with admitted
+ * requests that /health then waits behind.
+ *
+ * Portable; tools/admission_sim.cpp drives it with a synthetic overload.
+ */
+
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <stdint.h>
+
+// Priority classes, highest first
+enum RoutePriority : uint8_t {
+    PRIORITY_HEALTH = 0,                       // Liveness and status, only ever deferred
+    PRIORITY_CURRENT = 1,                      // Current values and configuration
+    PRIORITY_HISTORY = 2,                      // History, queries and exports
+    PRIORITY_COUNT
+};
+
+#define ADMISSION_RATE          500            // Global refill, units per second (half the loop)
+#define ADMISSION_BURST         1000           // Global bucket size
+#define ADMISSION_CLIENT_RATE   150            // Per-client refill, units per second
+#define ADMISSION_CLIENT_BURST  300
+#define ADMISSION_MAX_CLIENTS   8              // Tracked client addresses (least recently seen replaced)
+#define ADMISSION_PASS_COST     10             // Loop pass each admitted request takes (loop()'s delay(10))
+#define ADMISSION_DEBT_LIMIT    ADMISSION_BURST    // How far a slow handler can overdraw the bucket
+
+enum AdmissionVerdict : uint8_t {
+    ADMISSION_ADMIT = 0,
+    ADMISSION_DEFER,                           // Retry on the next pass, after the sampler
+    ADMISSION_SHED                             // Reply 503 with retryAfterSeconds
+};
+
+enum ShedReason : uint8_t {
+    SHED_GLOBAL_BUDGET = 0,
+    SHED_CLIENT_BUDGET,
+    SHED_REASON_COUNT
+};
+
+struct AdmissionDecision {
+    AdmissionVerdict verdict;
+    ShedReason reason;
+    uint16_t retryAfterSeconds;
+};
+
+struct AdmissionStats {
+    uint32_t admitted[PRIORITY_COUNT];
+    uint32_t shed[PRIORITY_COUNT][SHED_REASON_COUNT];
+    uint32_t deferred[PRIORITY_COUNT];         // Held back for the sampler
+    uint32_t overruns;                         // Handlers that took longer than their cost
+};
+
+class AdmissionController {
+public:
+    AdmissionController();
+
+    void reset(uint32_t now);
+
+    /*
+     * now and sampleSlackMs (time until the next sample is due) in ms;
+     * client is the peer IPv4 address
+     */
+    AdmissionDecision admit(RoutePriority priority, uint16_t cost, uint32_t client,
+                            uint32_t now, uint32_t sampleSlackMs);
+
+    // Settle an admitted request against its measured duration
+    void complete(uint16_t cost, uint32_t elapsedMicros);
+
+    // Global bucket level in units (negative while paying off an overrun)
+    int32_t level() const { return globalLevel / 1000; }
+    const AdmissionStats& stats() const { return counters; }
+    uint32_t shedTotal() const;
+
+private:
+    struct ClientBucket {
+        uint32_t address;
+        int32_t level;                         // Milli-units
+        uint32_t lastSeen;
+    };
+
+    void refill(uint32_t now);
+    ClientBucket& clientBucket(uint32_t address, uint32_t now);
+    static uint16_t secondsToRefill(int32_t missing, uint32_t rate);
+
+    // Levels are kept in milli-units so a 1 ms refill step stays exact
+    int32_t globalLevel;
+    uint32_t lastRefill;
+    ClientBucket clients[ADMISSION_MAX_CLIENTS];
+
+    AdmissionStats counters;
+};
+
+#endif // ADMISSION_CONTROL_H
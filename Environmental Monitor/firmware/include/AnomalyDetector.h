@@ -0,0 +1,120 @@
+/*
+ * Streaming Anomaly Detection
+ *
+ * Constant-memory detectors that are updated once per sample:
+ * - Outliers via an EWMA mean/variance z-score
+ * - Level shifts via a two-sided CUSUM on the standardized residual,
+ *   clipped at the outlier threshold so a lone spike cannot trip it
+ * - Stuck (flat-lined) sensors via how long the value has not moved by
+ *   half a resolution step
+ * - Rate-of-change violations between consecutive samples
+ *
+ * The detectors do not depend on the Arduino core, so they can be
+ * compiled and benchmarked on the host.
+ */
+
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "TimeSeriesRing.h"
+
+// Anomaly flags stored with every reading (one byte per series)
+#define ANOMALY_NONE         0x00
+#define ANOMALY_OUTLIER      0x01              // |z| above threshold
+#define ANOMALY_LEVEL_SHIFT  0x02              // CUSUM alarm
+#define ANOMALY_STUCK        0x04              // Value unchanged for too long
+#define ANOMALY_RATE         0x08              // Change per second above limit
+
+// Tuning parameters for one series
+struct AnomalyConfig {
+    float ewmaAlpha;                           // Smoothing factor for mean/variance (0..1)
+    float zThreshold;                          // Outlier threshold in standard deviations
+    float cusumSlack;                          // CUSUM allowance k (in standard deviations)
+    float cusumThreshold;                      // CUSUM decision interval h (in standard deviations)
+    float minStdDev;                           // Floor for the standard deviation (sensor resolution)
+    float resolution;                          // Sensor step; changes under half of it count as "unchanged"
+    uint16_t stuckSeconds;                     // Unchanged for this long before flagging stuck
+    float maxRatePerSecond;                    // Maximum plausible change per second
+    uint16_t warmupSamples;                    // Samples before z-score/CUSUM are trusted
+};
+
+/*
+ * Per-series detector state - a few floats, no history
+ */
+class SeriesAnomalyDetector {
+public:
+    explicit SeriesAnomalyDetector(const AnomalyConfig& config);
+
+    // Feed one sample, returns the ANOMALY_* flags raised by it
+    uint8_t update(float value, unsigned long timestampMs);
+
+    // Forget all learned state
+    void reset();
+
+    float mean() const { return ewmaMean; }
+    float stdDev() const;
+    float lastZScore() const { return zScore; }
+    float cusumHigh() const { return cusumPos; }
+    float cusumLow() const { return cusumNeg; }
+    uint32_t samples() const { return sampleCount; }
+
+private:
+    AnomalyConfig config;
+    float ewmaMean;
+    float ewmaVariance;
+    float cusumPos;
+    float cusumNeg;
+    float zScore;
+    float lastValue;
+    unsigned long lastTimestamp;
+    unsigned long unchangedSince;              // Time of the last change of at least half a step
+    uint32_t sampleCount;
+};
+
+// Series identifiers used in the event log
+enum AnomalySeries : uint8_t {
+    ANOMALY_SERIES_TEMPERATURE = 0,
+    ANOMALY_SERIES_HUMIDITY = 1
+};
+
+// One entry of the anomaly event log
+struct AnomalyEvent {
+    uint64_t timestamp;                        // History clock (ms)
+    float value;
+    float zScore;
+    uint8_t series;
+    uint8_t flags;
+};
+
+#define ANOMALY_EVENT_LOG_SIZE 32              // Most recent events kept in RAM (power of two)
+
+/*
+ * Compact circular log of anomaly events
+ * Only flag transitions are logged, so a stuck sensor produces one entry
+ * instead of one per sample.
+ */
+class AnomalyEventLog {
+public:
+    AnomalyEventLog();
+
+    // Record flags for a series, logging only when they change to a non-zero set
+    void record(uint8_t series, uint8_t flags, float value, float zScore, uint64_t timestamp);
+
+    void clear();
+
+    size_t size() const { return events.size(); }
+    uint32_t totalEvents() const { return total; }
+
+    // Access event i, 0 = oldest retained
+    const AnomalyEvent& at(size_t i) const { return events[(uint32_t)i]; }
+
+private:
+    TimeSeriesRing<AnomalyEvent, ANOMALY_EVENT_LOG_SIZE> events;
+    uint32_t total;
+    uint8_t lastFlags[2];
+};
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,94 @@
+/*
+ * Delta OTA Update Session
+ *
+ * Receives a compressed delta (DeltaPatch.h) on a detached HTTP
+ * connection and rebuilds the new firmware straight into the inactive app
+ * slot. service() is called from loop() and does a bounded amount of work
+ * per call - one socket read and one applier step of at most one flash
+ * sector - so sampling and the web server keep running while the update
+ * downloads. RAM use is the applier plus one receive buffer.
+ *
+ * Once the image verifies, the slot becomes the boot partition and the
+ * device restarts shortly after the response has been sent.
+ */
+
+#ifndef DELTA_OTA_H
+#define DELTA_OTA_H
+
+#include <WiFi.h>
+
+#include "DeltaPatch.h"
+
+#define OTA_RX_BUFFER_SIZE   2048              // Holds the request buffer's body prefix
+#define OTA_IDLE_TIMEOUT_MS  15000             // Upload abandoned when no bytes arrive
+#define OTA_REBOOT_DELAY_MS  1000              // Lets the response reach the client
+
+enum OtaState : uint8_t {
+    OTA_IDLE = 0,
+    OTA_RECEIVING,
+    OTA_REBOOT_PENDING,
+    OTA_FAILED
+};
+
+struct OtaProgress {
+    OtaState state;
+    uint32_t patchSize;
+    uint32_t received;                         // Patch bytes read from the client
+    uint32_t written;                          // New-image bytes written to flash
+    uint32_t imageSize;                        // From the patch header (0 until parsed)
+    uint32_t elapsedMs;
+    uint32_t maxStepMicros;                    // Longest single service() call
+    const char* error;                         // Last failure, nullptr if none
+};
+
+class DeltaOtaSession {
+public:
+    DeltaOtaSession();
+
+    /*
+     * Take over an upload; prefix holds body bytes already received with
+     * the headers. Returns an error message (and responds) on refusal.
+     */
+    const char* start(WiFiClient client, size_t patchSize, const char* prefix, size_t prefixLength);
+
+    // Advance the update by one bounded step; call from loop()
+    void service();
+
+    bool active() const { return state == OTA_RECEIVING; }
+    bool rebootDue() const;
+    OtaProgress progress() const;
+
+    static const char* stateName(OtaState state);
+
+    // Cancel a pending rollback once the new image has booted (true if one was pending)
+    static bool confirmRunningImage();
+
+private:
+    static bool readOld(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+    static bool writeNew(void* context, const uint8_t* data, size_t length);
+
+    void finish();
+    void abort(int code, const char* message);
+
+    DeltaApplier applier;
+    WiFiClient connection;
+
+    uint8_t rxBuffer[OTA_RX_BUFFER_SIZE];
+    size_t buffered;
+
+    const void* runningPartition;              // esp_partition_t, kept out of this header
+    const void* targetPartition;
+    uint32_t otaHandle;
+    bool otaOpen;
+
+    OtaState state;
+    uint32_t patchSize;
+    uint32_t received;
+    unsigned long startedAt;
+    unsigned long lastData;
+    unsigned long finishedAt;
+    uint32_t maxStepMicros;
+    const char* error;
+};
+
+#endif // DELTA_OTA_H
@@ -0,0 +1,155 @@
+/*
+ * Compressed Firmware Delta Format and Streaming Applier
+ *
+ * A delta rebuilds the new firmware image from the running one. It is a
+ * stream of operations against the old image:
+ *   COPY   old[offset .. offset+length) unchanged
+ *   ADD    old[offset + i] + diff[i] for each i (code that moved keeps its
+ *          shape, so most diff bytes are zero)
+ *   INSERT literal bytes
+ * The operation stream is LZSS-compressed (4 KB window, which the diff
+ * zeros shrink well). tools/delta_tool.cpp produces deltas on the host.
+ *
+ * The applier is fed the patch in arbitrary pieces as it arrives and
+ * works within a per-call output budget, so a long COPY never stalls the
+ * caller. RAM use is fixed: the LZSS window plus two small buffers.
+ * Old-image reads and new-image writes go through callbacks (flash
+ * partitions on the device, files on the host).
+ */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_MAGIC          0x50444D45UL      // "EMDP"
+#define DELTA_VERSION        1
+
+#define DELTA_WINDOW_BITS    12
+#define DELTA_WINDOW_SIZE    (1u << DELTA_WINDOW_BITS)
+#define DELTA_MIN_MATCH      3                 // Shortest LZSS back-reference
+#define DELTA_LENGTH_BITS    4                 // Length nibble; 15 means an extension byte follows
+#define DELTA_MAX_MATCH      (DELTA_MIN_MATCH + 15 + 255)
+
+#define DELTA_IO_BLOCK       256               // Old-image read and new-image write granularity
+#define DELTA_OUTPUT_BUDGET  4096              // New-image bytes per push() (one flash sector erase)
+
+// Operation codes in the decompressed stream
+enum DeltaOp : uint8_t {
+    DELTA_OP_END = 0,
+    DELTA_OP_COPY = 1,                         // u32 offset, u32 length
+    DELTA_OP_ADD = 2,                          // u32 offset, u32 length, length diff bytes
+    DELTA_OP_INSERT = 3                        // u32 length, length literal bytes
+};
+
+// Uncompressed header at the start of a patch (little-endian)
+struct DeltaHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t oldSize;                          // Bytes of the base image the delta was made against
+    uint32_t oldCrc;                           // CRC-32 of those bytes
+    uint32_t newSize;
+    uint32_t newCrc;
+    uint32_t reserved;
+    uint32_t crc;                              // CRC-32 of all fields above
+};
+
+enum DeltaStatus : uint8_t {
+    DELTA_CONTINUE = 0,                        // Push more input (or call again with none)
+    DELTA_DONE,                                // New image complete and verified
+    DELTA_ERROR_HEADER,                        // Bad magic, version or header CRC
+    DELTA_ERROR_BASE,                          // Running image does not match the delta's base
+    DELTA_ERROR_FORMAT,                        // Corrupt operation stream
+    DELTA_ERROR_IO,                            // Read or write callback failed
+    DELTA_ERROR_VERIFY                         // New image CRC or size mismatch
+};
+
+// Old-image reader and new-image writer, called with at most DELTA_IO_BLOCK bytes
+typedef bool (*DeltaReadOld)(void* context, uint32_t offset, uint8_t* buffer, size_t length);
+typedef bool (*DeltaWriteNew)(void* context, const uint8_t* data, size_t length);
+
+const char* deltaStatusName(DeltaStatus status);
+
+// Header helpers (also used by the host tool)
+void sealDeltaHeader(DeltaHeader& header);
+bool deltaHeaderValid(const DeltaHeader& header);
+
+class DeltaApplier {
+public:
+    DeltaApplier();
+
+    void begin(DeltaReadOld readOld, DeltaWriteNew writeNew, void* context);
+
+    /*
+     * Consume patch bytes; *consumed reports how many were used. Input is
+     * left unconsumed when the output budget runs out - call again with
+     * the rest (or with no input to let pending work finish).
+     */
+    DeltaStatus push(const uint8_t* data, size_t length, size_t* consumed);
+
+    DeltaStatus status() const { return state == STATE_FAILED ? error : (state == STATE_DONE ? DELTA_DONE : DELTA_CONTINUE); }
+    const DeltaHeader& header() const { return patchHeader; }
+    uint32_t written() const { return outputOffset; }
+    bool headerReady() const { return state > STATE_HEADER; }
+    bool needsInput() const { return starved; }  // Last push() stopped for lack of input
+
+private:
+    enum State : uint8_t {
+        STATE_HEADER,                          // Collecting the raw header
+        STATE_VERIFY_BASE,                     // CRC of the old image, in budgeted slices
+        STATE_OP,                              // Reading an opcode and its fields
+        STATE_COPY,
+        STATE_ADD,
+        STATE_INSERT,
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    DeltaStatus fail(DeltaStatus status);
+    bool nextStreamByte(const uint8_t*& in, const uint8_t* end, uint8_t& out);
+    bool emit(uint8_t value);
+    bool flushOutput();
+    bool oldByte(uint32_t offset, uint8_t& out);
+    bool finishImage();
+
+    DeltaReadOld readOld;
+    DeltaWriteNew writeNew;
+    void* context;
+
+    State state;
+    DeltaStatus error;
+    bool starved;
+    DeltaHeader patchHeader;
+    uint8_t headerBytes;
+
+    // LZSS decoder
+    uint8_t window[DELTA_WINDOW_SIZE];
+    uint16_t windowPos;
+    uint16_t flagBits;                         // Remaining flags in the low byte, marker in bit 8
+    uint16_t matchDistance;
+    uint16_t matchRemaining;
+    uint8_t tokenBytes[3];
+    uint8_t tokenLength;
+
+    // Operation parser
+    uint8_t opCode;
+    uint8_t fieldBytes;
+    uint8_t fields[8];
+    uint32_t opOffset;
+    uint32_t opRemaining;
+
+    // Old-image cache and output buffer
+    uint8_t oldBlock[DELTA_IO_BLOCK];
+    uint32_t oldBlockStart;
+    size_t oldBlockLength;
+    uint8_t outBlock[DELTA_IO_BLOCK];
+    size_t outLength;
+    uint32_t outputOffset;
+    uint32_t outputCrc;
+    uint32_t verifyOffset;
+    uint32_t verifyCrc;
+};
+
+#endif // DELTA_PATCH_H
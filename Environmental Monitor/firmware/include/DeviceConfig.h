@@ -0,0 +1,59 @@
+/*
+ * Runtime Device Configuration
+ *
+ * Typed settings that used to be compile-time constants. They are stored
+ * as one versioned blob in NVS (a single NVS write, so a power loss never
+ * leaves a half-written configuration) and applied live by the firmware.
+ */
+
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <stdint.h>
+
+#define DEVICE_CONFIG_VERSION 3            // Older blobs are migrated by loadDeviceConfig()
+
+// Part played on the node link (applied at the next boot)
+enum LinkRole : uint8_t {
+    LINK_ROLE_STANDALONE = 0,                  // Own WiFi association and web server
+    LINK_ROLE_GATEWAY = 1,                     // Standalone, plus collects node frames
+    LINK_ROLE_NODE = 2                         // Sends readings to a gateway, no WiFi association
+};
+
+// CPU clock and WiFi power-save policy (PowerManager.h)
+enum PowerMode : uint8_t {
+    POWER_MODE_PERFORMANCE = 0,                // Fixed top clock, radio always on
+    POWER_MODE_BALANCED = 1,                   // Clock scaled down when idle, modem sleep between DTIM beacons
+    POWER_MODE_LOW_POWER = 2,                  // Lowest idle clock, modem sleep over several beacons
+    POWER_MODE_COUNT
+};
+
+struct DeviceConfig {
+    uint16_t version;
+    uint32_t readingIntervalMs;                // Sampler period
+    uint16_t historySize;                      // Readings kept in the history ring
+    uint16_t dataHistoryLimit;                 // Readings returned by /data
+    uint8_t dhtPin;                            // GPIO connected to the DHT sensor
+    uint8_t dhtType;                           // 11, 12, 21 or 22 (DHT library type ids)
+    uint8_t linkRole;                          // LinkRole
+    uint8_t linkChannel;                       // WiFi channel nodes transmit on (the gateway's AP channel)
+    uint16_t nodeId;                           // Id on the node link, 0 = derived from the MAC address
+    uint8_t powerMode;                         // PowerMode
+};
+
+// Validate a candidate against the ring capacity, returns nullptr or a reason
+const char* validateDeviceConfig(const DeviceConfig& config, uint16_t historyCapacity);
+
+const char* linkRoleName(uint8_t role);
+bool parseLinkRole(const char* text, uint8_t* role);
+
+const char* powerModeName(uint8_t mode);
+bool parsePowerMode(const char* text, uint8_t* mode);
+
+// Load from NVS, migrating blobs from earlier versions; defaults when missing or invalid
+bool loadDeviceConfig(DeviceConfig& config, const DeviceConfig& defaults, uint16_t historyCapacity);
+
+// Persist to NVS
+bool saveDeviceConfig(const DeviceConfig& config);
+
+#endif // DEVICE_CONFIG_H
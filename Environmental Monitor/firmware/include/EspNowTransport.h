@@ -0,0 +1,42 @@
+/*
+ * ESP-NOW Node Transport
+ *
+ * NodeTransport over ESP-NOW broadcast. Nodes need no association with
+ * the access point, only the gateway's WiFi channel. Received frames are
+ * copied from the WiFi task's callback into a FreeRTOS queue and drained
+ * by the gateway from loop().
+ */
+
+#ifndef ESP_NOW_TRANSPORT_H
+#define ESP_NOW_TRANSPORT_H
+
+#include <stdint.h>
+
+#include "NodeLink.h"
+
+#define ESPNOW_RX_QUEUE_LENGTH 32              // Frames buffered between loop() passes
+
+class EspNowTransport : public NodeTransport {
+public:
+    EspNowTransport();
+
+    // channel 0 keeps the current one (a gateway follows its access point)
+    bool begin(uint8_t channel);
+
+    bool send(const uint8_t* frame, size_t length) override;
+    bool receive(uint8_t* frame, size_t& length) override;
+
+    bool running() const { return started; }
+    uint32_t sendFailures() const { return failedSends; }
+    uint32_t queueDrops() const { return droppedFrames; }
+
+    // Called from the ESP-NOW receive callback
+    static void deliverFrame(const uint8_t* data, int length);
+
+private:
+    bool started;
+    uint32_t failedSends;
+    static volatile uint32_t droppedFrames;
+};
+
+#endif // ESP_NOW_TRANSPORT_H
@@ -0,0 +1,62 @@
+/*
+ * Server-Sent Events Stream
+ *
+ * GET /events detaches its connection and hands it here; every new
+ * reading is then pushed to all attached clients as one "reading" event.
+ * A comment line is sent when nothing else has been for a while, which
+ * keeps proxies from closing the stream and finds dead clients.
+ *
+ * publish() only queues: each client has a small send queue that service()
+ * drains with non-blocking socket writes, so a slow or stalled client never
+ * holds up the sampler. A client whose queue cannot take the next event
+ * (it has fallen that far behind) or whose write fails is dropped.
+ *
+ * Loop task only.
+ */
+
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <WiFi.h>
+
+#define EVENT_STREAM_MAX_CLIENTS 4             // Attached clients, more are refused with 503
+#define EVENT_STREAM_QUEUE_BYTES 1024          // Unsent bytes held per client (a few events)
+#define EVENT_STREAM_KEEPALIVE_MS 15000        // Comment line after this much silence
+#define EVENT_STREAM_RETRY_MS 3000             // Reconnect delay suggested to browsers
+
+class EventStream {
+public:
+    EventStream();
+
+    // Take over a detached connection and queue the stream headers; false (after a 503) when full
+    bool attach(WiFiClient client);
+
+    // Queue one event for every client
+    void publish(const char* event, const char* data);
+
+    // Send queued bytes, keep-alive, closed connections; call from loop()
+    void service(unsigned long now);
+
+    uint8_t clientCount() const { return count; }
+    uint32_t eventsSent() const { return sent; }
+    uint32_t clientsDropped() const { return dropped; }
+
+private:
+    struct Client {
+        WiFiClient connection;
+        char queue[EVENT_STREAM_QUEUE_BYTES];
+        size_t queued;
+    };
+
+    bool enqueue(uint8_t index, const char* text, size_t length);
+    bool flush(uint8_t index);
+    void drop(uint8_t index);
+
+    Client clients[EVENT_STREAM_MAX_CLIENTS];
+    uint8_t count;
+    unsigned long lastWrite;
+    uint32_t sent;
+    uint32_t dropped;
+};
+
+#endif // EVENT_STREAM_H
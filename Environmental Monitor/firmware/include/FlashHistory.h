@@ -0,0 +1,178 @@
+/*
+ * Flash-Backed History Segments
+ *
+ * Readings are appended to a raw data partition ("history") as fixed-size
+ * records in 64 KB segments. The whole partition is memory-mapped through
+ * the flash cache (esp_partition_mmap), so query and serialization code
+ * reads stored records in place - each segment is a contiguous array of
+ * StoredReading - without copying pages into RAM.
+ *
+ * On the host the same format is emulated with mmap() of a regular file,
+ * including NOR semantics (writes can only clear bits, erase sets 0xFF).
+ *
+ * Segment layout:
+ *   SegmentHeader (32 bytes) | StoredReading[FLASH_RECORDS_PER_SEGMENT]
+ * A record is valid when its CRC matches; erased slots read as 0xFF.
+ *
+ * A gateway logs its nodes' readings here too, keyed by node id (0 is the
+ * monitor itself). They only exist in flash - the RAM ring stays local -
+ * and take the sequence of the next local reading, so one sequence can
+ * cover several records: the node readings that arrived since the previous
+ * local reading, then the local one. Sequences never decrease along the
+ * log, and an export up to a local reading's sequence is complete.
+ */
+
+#ifndef FLASH_HISTORY_H
+#define FLASH_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorReading.h"
+
+#define FLASH_SECTOR_SIZE          4096
+#define FLASH_SEGMENT_SIZE         65536       // One MMU page
+#define FLASH_SEGMENT_MAGIC        0x47455348UL    // "HSEG"
+#define FLASH_SEGMENT_VERSION      2           // 2: node id in every record
+#define FLASH_MAX_SEGMENTS         64
+
+// Persisted form of a reading (44 bytes, read in place from mapped flash)
+struct StoredReading {
+    uint32_t sequence;
+    uint32_t timestamp;                        // Low 32 bits of the history clock
+    float temperature;
+    float humidity;
+    float dewPoint;
+    float heatIndex;
+    float absoluteHumidity;
+    float vaporPressureDeficit;
+    uint8_t temperatureFlags;
+    uint8_t humidityFlags;
+    uint16_t timestampHigh;                    // Bits 32-47 of the history clock
+    uint16_t nodeId;                           // Sending node at a gateway, 0 for this monitor
+    uint16_t reserved;                         // 0xFFFF
+    uint32_t crc;                              // CRC-32 of all fields above
+};
+
+// Full history clock of a stored reading
+inline uint64_t storedTimestamp(const StoredReading& record) {
+    return ((uint64_t)record.timestampHigh << 32) | record.timestamp;
+}
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t segmentSequence;                  // Increases with every segment started
+    uint32_t firstReading;                     // Sequence of the first record
+    uint8_t reserved[12];
+    uint32_t crc;
+};
+
+#define FLASH_RECORDS_PER_SEGMENT ((FLASH_SEGMENT_SIZE - sizeof(SegmentHeader)) / sizeof(StoredReading))
+
+// Read position in the log: a sequence and the slots of it already read.
+// Kept as a sequence rather than a slot so it survives segment reclaim.
+struct FlashCursor {
+    uint32_t sequence;
+    uint32_t skip;
+
+    // Step past one slot; a local reading (node 0) is the last record of its sequence
+    void advance(const StoredReading& record, bool valid) {
+        if (valid && record.sequence != sequence) {
+            sequence = record.sequence;
+            skip = 0;
+        }
+        skip++;
+        if (valid && record.nodeId == 0) {
+            sequence++;
+            skip = 0;
+        }
+    }
+};
+
+/*
+ * Raw flash region: a data partition on the device, a file on the host
+ */
+class FlashRegion {
+public:
+    FlashRegion();
+    ~FlashRegion();
+
+    // Partition label on the device, file path on the host
+    bool open(const char* name, size_t hostSize);
+    void close();
+
+    const uint8_t* data() const { return mapped; }
+    size_t size() const { return length; }
+
+    bool eraseSector(size_t offset);
+    bool write(size_t offset, const void* source, size_t bytes);
+
+private:
+    const uint8_t* mapped;
+    size_t length;
+    void* handle;                              // Partition pointer or file descriptor
+    uint32_t mapHandle;
+};
+
+/*
+ * Append-only segment log over a FlashRegion
+ */
+class FlashHistory {
+public:
+    FlashHistory();
+
+    // Map the region and find the append position
+    bool begin(const char* name, size_t hostSize = 0);
+
+    bool ready() const { return segmentCount > 0; }
+
+    // Append one reading (a node's at a gateway); erases ahead incrementally so no single call blocks long
+    bool append(const SensorReading& reading, uint16_t nodeId = 0);
+
+    // Segments oldest to newest; records are a contiguous array in mapped flash
+    // (check recordValid() on each - a power loss can tear the last write)
+    size_t segments() const { return usedSegments; }
+    const StoredReading* segmentRecords(size_t index, size_t* count) const;
+
+    // First unread record at a cursor (nullptr past the end), and the slots left in its segment
+    const StoredReading* locate(const FlashCursor& cursor, size_t* remaining) const;
+
+    // First stored reading taken at or after timestamp, 0 if there is none
+    uint32_t sequenceAtTime(uint64_t timestamp) const;
+
+    uint32_t firstSequence() const;
+    uint32_t lastSequence() const { return lastReading; }
+    uint16_t lastNodeId() const { return lastReadingNode; }
+    uint64_t lastTimestamp() const { return lastReadingTime; }
+    uint32_t storedReadings() const;
+    uint32_t capacityReadings() const { return segmentCount * FLASH_RECORDS_PER_SEGMENT; }
+
+    static bool recordValid(const StoredReading& record);
+
+private:
+    const SegmentHeader* header(size_t segment) const;
+    bool headerValid(size_t segment) const;
+    size_t countRecords(size_t segment) const;
+    size_t lastValidRecord(size_t index, const StoredReading** records) const;
+    bool startSegment(size_t segment, uint32_t firstReading);
+    void eraseAhead();
+
+    FlashRegion region;
+    size_t segmentCount;
+    size_t usedSegments;                       // Segments holding data
+    size_t oldestSegment;                      // Physical index of the oldest used segment
+    size_t activeSegment;                      // Physical index being appended to
+    size_t activeRecords;
+    uint32_t nextSegmentSequence;
+    uint32_t lastReading;
+    uint64_t lastReadingTime;
+    uint16_t lastReadingNode;
+    size_t erasedSectors;                      // Sectors of the next segment already erased
+};
+
+// Convert a reading to its stored form (computes the CRC)
+void toStoredReading(const SensorReading& reading, StoredReading& stored, uint16_t nodeId = 0);
+
+#endif // FLASH_HISTORY_H
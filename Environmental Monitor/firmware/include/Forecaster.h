@@ -0,0 +1,148 @@
+/*
+ * Short-Horizon Forecasting
+ *
+ * Holt's double exponential smoothing (level + trend) updated once per
+ * sample, with the trend damped towards zero over a time constant so long
+ * horizons do not extrapolate a short swing. Forecasts for the fixed
+ * horizons are refreshed after every sample, so serving them is constant
+ * time.
+ *
+ * ForecastAccuracy keeps timestamped snapshots of the forecasts and scores
+ * each horizon against the first sample at or after its target time (MAE
+ * and band coverage). With a reading interval longer than a horizon's
+ * tolerance that horizon is never scored rather than scored late.
+ *
+ * It scores the Holt forecast and persistence (the last value held flat)
+ * side by side and decides what is served per horizon: the Holt forecast
+ * while its recent error is below persistence's, persistence otherwise.
+ * Once enough forecasts are scored the band is the tracked 95th percentile
+ * of the served method's absolute error, instead of the model's normal
+ * approximation. trusted() holds back predictive alerts until the Holt
+ * forecast both wins and keeps its band coverage.
+ */
+
+#ifndef FORECASTER_H
+#define FORECASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FORECAST_HORIZON_COUNT 4
+#define FORECAST_MAX_HORIZON_MINUTES 30
+#define FORECAST_SNAPSHOT_SLOTS 40             // Pending snapshots (30 min + tolerance at one per minute)
+#define FORECAST_MIN_EVALUATIONS 30            // Scored forecasts before bands and method are chosen from them
+#define FORECAST_RECENT_ALPHA 0.05f            // Smoothing of the recent error and coverage (~20 evaluations)
+#define FORECAST_MIN_COVERAGE 0.90f            // Recent band coverage a trusted horizon keeps
+
+// Forecast horizons served by /forecast
+extern const uint16_t FORECAST_HORIZON_MINUTES[FORECAST_HORIZON_COUNT];
+
+// One forecast value with its 95% band
+struct ForecastPoint {
+    float value;
+    float lower;
+    float upper;
+};
+
+// Method a served forecast comes from
+enum ForecastSource : uint8_t {
+    FORECAST_SOURCE_HOLT = 0,
+    FORECAST_SOURCE_PERSISTENCE
+};
+
+class HoltForecaster {
+public:
+    // trendSeconds: time constant over which the trend is damped to zero
+    HoltForecaster(float alpha, float beta, float errorAlpha, float trendSeconds);
+
+    // Feed one sample (timestamps in milliseconds)
+    void update(float value, unsigned long timestampMs);
+
+    // Forecast the given number of seconds ahead of the last sample
+    ForecastPoint forecast(float horizonSeconds) const;
+
+    void reset();
+
+    bool ready() const { return sampleCount >= 2; }
+    float level() const { return smoothedLevel; }
+    float trendPerMinute() const { return trendPerSecond * 60.0f; }
+    float residualStdDev() const;
+    uint32_t samples() const { return sampleCount; }
+
+private:
+    float alpha;                               // Level smoothing
+    float beta;                                // Trend smoothing
+    float errorAlpha;                          // One-step error variance smoothing
+    float trendSeconds;                        // Damping time constant
+    float smoothedLevel;
+    float trendPerSecond;
+    float errorVariance;
+    float samplePeriod;                        // Smoothed seconds between samples
+    unsigned long lastTimestamp;
+    uint32_t sampleCount;
+};
+
+/*
+ * Online accuracy tracking for the fixed horizons
+ */
+class ForecastAccuracy {
+public:
+    ForecastAccuracy();
+
+    // Call with every sample: scores the snapshots whose horizon has elapsed
+    void score(float actual, unsigned long timestampMs);
+
+    // The forecast to serve for a horizon, given the Holt forecast and the last value
+    ForecastPoint serve(size_t horizonIndex, const ForecastPoint& holt, float lastValue) const;
+
+    // Store the forecasts made at this time (once per minute is enough):
+    // what was served, and the Holt values and last value scored behind it
+    void addSnapshot(unsigned long timestampMs, const ForecastPoint* served, const ForecastPoint* holt,
+                     float lastValue);
+
+    // Of the served forecasts
+    float meanAbsoluteError(size_t horizonIndex) const;
+    float bandCoverage(size_t horizonIndex) const;
+    // Of each method, over all scored forecasts
+    float holtError(size_t horizonIndex) const { return holtMeanError[horizonIndex]; }
+    float persistenceError(size_t horizonIndex) const { return persistenceMeanError[horizonIndex]; }
+
+    ForecastSource source(size_t horizonIndex) const;
+    // Holt is served and keeps its band coverage - predictive alerts may use it
+    bool trusted(size_t horizonIndex) const;
+
+    uint32_t evaluations(size_t horizonIndex) const { return evaluated[horizonIndex]; }
+    uint32_t missed(size_t horizonIndex) const { return expired[horizonIndex]; }
+
+private:
+    struct Snapshot {
+        unsigned long timestamp;
+        ForecastPoint forecasts[FORECAST_HORIZON_COUNT];
+        float holt[FORECAST_HORIZON_COUNT];
+        float lastValue;
+        uint8_t pending;                       // Bit per horizon not yet scored or expired
+    };
+
+    // Recent error of one method: smoothed MAE and tracked 95th percentile
+    struct ErrorTracker {
+        float recent;
+        float quantile;
+    };
+
+    static void track(ErrorTracker& tracker, float error, bool first);
+
+    Snapshot snapshots[FORECAST_SNAPSHOT_SLOTS];
+    size_t head;
+    size_t count;
+    float meanError[FORECAST_HORIZON_COUNT];   // Running means, so precision does not decay
+    float holtMeanError[FORECAST_HORIZON_COUNT];
+    float persistenceMeanError[FORECAST_HORIZON_COUNT];
+    ErrorTracker holtRecent[FORECAST_HORIZON_COUNT];
+    ErrorTracker persistenceRecent[FORECAST_HORIZON_COUNT];
+    float recentCoverage[FORECAST_HORIZON_COUNT];
+    uint32_t withinBand[FORECAST_HORIZON_COUNT];
+    uint32_t evaluated[FORECAST_HORIZON_COUNT];
+    uint32_t expired[FORECAST_HORIZON_COUNT];  // No sample inside the tolerance after the target time
+};
+
+#endif // FORECASTER_H
@@ -0,0 +1,88 @@
+/*
+ * Value Histograms
+ *
+ * Fixed-bin histograms per series and rollup period (total, current and
+ * previous hour, current and previous day). Each sample costs one bin
+ * increment per period, and the served arrays do not depend on how much
+ * raw history is still in the readings ring.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTOGRAM_MAX_BINS 64
+
+// Bin layout: binCount bins of binWidth starting at minValue
+struct HistogramConfig {
+    float minValue;
+    float binWidth;
+    uint8_t binCount;
+};
+
+// Rollup periods kept for every series
+enum HistogramPeriod : uint8_t {
+    HISTOGRAM_PERIOD_TOTAL = 0,
+    HISTOGRAM_PERIOD_HOUR,
+    HISTOGRAM_PERIOD_PREVIOUS_HOUR,
+    HISTOGRAM_PERIOD_DAY,
+    HISTOGRAM_PERIOD_PREVIOUS_DAY,
+    HISTOGRAM_PERIOD_COUNT
+};
+
+const char* histogramPeriodName(uint8_t period);
+
+// Parse a period name, returns false if unknown
+bool parseHistogramPeriod(const char* text, uint8_t* period);
+
+// Check a layout for sane values
+bool histogramConfigValid(const HistogramConfig& config);
+
+class ValueHistogram {
+public:
+    ValueHistogram();
+
+    void configure(const HistogramConfig& config);
+    void clear();
+
+    // O(1) - one division and one increment
+    void add(float value);
+
+    const HistogramConfig& config() const { return layout; }
+    uint32_t bin(size_t index) const { return bins[index]; }
+    uint32_t underflow() const { return below; }
+    uint32_t overflow() const { return above; }
+    uint32_t samples() const { return total; }
+
+private:
+    HistogramConfig layout;
+    uint32_t bins[HISTOGRAM_MAX_BINS];
+    uint32_t below;
+    uint32_t above;
+    uint32_t total;
+};
+
+/*
+ * All rollup periods for one series
+ * Period boundaries come from wall-clock epoch seconds.
+ */
+class SeriesHistograms {
+public:
+    SeriesHistograms();
+
+    // Reset all periods to a new layout
+    void configure(const HistogramConfig& config);
+
+    void add(float value, uint32_t epochSeconds);
+
+    const ValueHistogram& period(uint8_t index) const { return periods[index]; }
+
+private:
+    ValueHistogram periods[HISTOGRAM_PERIOD_COUNT];
+    uint32_t currentHour;
+    uint32_t currentDay;
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,67 @@
+/*
+ * Warm-Reboot History Checkpoint
+ *
+ * The readings ring lives in memory that is not cleared at boot. A small
+ * header (magic, version, layout, head index, count, CRC) is rewritten
+ * after every sample and each record carries its own checksum, so after a
+ * watchdog reset, panic or OTA restart the ring can be validated and
+ * resumed instead of cleared.
+ */
+
+#ifndef HISTORY_CHECKPOINT_H
+#define HISTORY_CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorReading.h"
+
+#define HISTORY_CHECKPOINT_MAGIC   0x48495354UL    // "HIST"
+#define HISTORY_CHECKPOINT_VERSION 4       // 4: 64-bit history clock
+
+struct HistoryCheckpoint {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;                       // sizeof(SensorReading) when written
+    uint16_t capacity;                         // Ring storage capacity (power of two)
+    uint16_t historySize;                      // Active ring length (TimeSeriesRing limit)
+    uint32_t head;                             // Free-running write position
+    int32_t readingCount;
+    uint64_t lastTimestamp;                    // History clock of the newest reading (ms)
+    uint32_t lastEpochSeconds;                 // Wall clock of the newest reading, 0 if unknown
+    uint32_t crc;                              // CRC-32 of all fields above
+};
+
+// Result of validating the checkpoint at boot
+struct HistoryRecovery {
+    bool recovered;
+    uint32_t head;
+    int readingCount;
+    uint16_t historySize;
+    uint64_t lastTimestamp;
+    uint32_t lastEpochSeconds;
+};
+
+// Standard CRC-32 (IEEE), chainable
+uint32_t checkpointCrc32(const void* data, size_t length, uint32_t crc = 0);
+
+// Per-record checksum over the stored fields (padding is ignored)
+uint16_t readingChecksum(const SensorReading& reading);
+void sealReading(SensorReading& reading);
+
+// Rewrite the header after the ring changed
+void updateCheckpoint(HistoryCheckpoint& checkpoint, uint16_t capacity, uint16_t historySize,
+                      uint32_t head, int readingCount, uint64_t lastTimestamp, uint32_t lastEpochSeconds);
+
+// Mark the checkpoint unusable (e.g. before clearing the ring)
+void invalidateCheckpoint(HistoryCheckpoint& checkpoint);
+
+/*
+ * Validate header and records; keeps the longest run of intact,
+ * time-ordered readings ending at the head. Slots outside it are
+ * marked invalid. readings is the storage of a TimeSeriesRing, so slot
+ * i of position p is p & (capacity - 1).
+ */
+HistoryRecovery recoverHistory(const HistoryCheckpoint& checkpoint, SensorReading* readings, uint16_t capacity);
+
+#endif // HISTORY_CHECKPOINT_H
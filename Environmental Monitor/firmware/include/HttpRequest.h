@@ -0,0 +1,125 @@
+/*
+ * Allocation-Free HTTP Request Parsing
+ *
+ * Parses the request line, headers and query string in place from the
+ * receive buffer. Every field is a (pointer, length) view into that
+ * buffer; nothing is copied into String objects.
+ *
+ * Query parameters are bound against a route's parameter schema before
+ * the handler runs: values are percent-decoded and NUL-terminated in place
+ * (decoding only shrinks them) and numbers are converted, so handlers get
+ * typed arguments and malformed input is rejected with 400 up front.
+ *
+ * No Arduino dependencies - builds and benchmarks on the host.
+ */
+
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_MAX_HEADERS 16                    // Further headers are skipped, not stored
+#define HTTP_MAX_PARAMS 8                      // Parameters per route schema
+
+enum HttpVerb : uint8_t {
+    HTTP_VERB_UNKNOWN = 0,
+    HTTP_VERB_GET,
+    HTTP_VERB_POST
+};
+
+// Non-owning view into the receive buffer
+struct TextView {
+    const char* data;
+    uint16_t length;
+
+    bool equals(const char* text) const;
+    bool equalsIgnoreCase(const char* text) const;
+};
+
+struct HttpHeader {
+    TextView name;
+    TextView value;
+};
+
+struct HttpRequest {
+    HttpVerb verb;
+    TextView path;                             // Without the query string
+    char* query;                               // Mutable: decoded in place when bound
+    uint16_t queryLength;
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    uint8_t headerCount;
+    const char* body;
+    size_t contentLength;
+    size_t bodyReceived;                       // Body bytes in the buffer so far
+    size_t headerBytes;                        // Request line and headers, 0 until complete
+    size_t totalBytes;                         // Request line, headers and body
+    uint8_t minorVersion;                      // HTTP/1.x
+    bool keepAlive;
+
+    // Header value by case-insensitive name, or nullptr
+    const TextView* header(const char* name) const;
+};
+
+enum HttpParseStatus : uint8_t {
+    HTTP_PARSE_INCOMPLETE = 0,                 // Need more bytes (headerBytes set once headers are in)
+    HTTP_PARSE_OK,
+    HTTP_PARSE_BAD_REQUEST
+};
+
+// Parse one request from the start of buffer (length bytes received so far)
+HttpParseStatus parseHttpRequest(char* buffer, size_t length, HttpRequest& request);
+
+// Query parameter schema
+enum ParamType : uint8_t {
+    PARAM_UINT = 0,                            // Decimal unsigned 32-bit
+    PARAM_FLOAT,
+    PARAM_TEXT,                                // Decoded C string (may be empty)
+    PARAM_UINT64                               // Decimal unsigned 64-bit (history clock times)
+};
+
+struct ParamSpec {
+    const char* name;
+    ParamType type;
+};
+
+// Typed arguments, indexed like the route's ParamSpec array
+class RequestArgs {
+public:
+    RequestArgs();
+
+    bool has(uint8_t index) const { return (present >> index) & 1; }
+    uint32_t u32(uint8_t index, uint32_t fallback) const;
+    uint64_t u64(uint8_t index, uint64_t fallback) const;
+    float f32(uint8_t index, float fallback) const;
+    const char* text(uint8_t index, const char* fallback) const;
+
+    // Request body (POST); for streamed uploads only the part received so far
+    const char* body() const { return bodyData; }
+    size_t bodyLength() const { return bodySize; }
+    size_t contentLength() const { return declaredLength; }
+
+private:
+    friend const char* bindRequestArgs(HttpRequest& request, const ParamSpec* params,
+                                       uint8_t paramCount, RequestArgs& args);
+
+    union Value {
+        uint32_t u;
+        uint64_t u64;
+        float f;
+        const char* text;
+    };
+
+    Value values[HTTP_MAX_PARAMS];
+    uint16_t present;
+    const char* bodyData;
+    size_t bodySize;
+    size_t declaredLength;
+};
+
+// Bind query parameters and body; returns nullptr or the name of the first
+// malformed parameter. Unknown parameters are ignored.
+const char* bindRequestArgs(HttpRequest& request, const ParamSpec* params,
+                            uint8_t paramCount, RequestArgs& args);
+
+#endif // HTTP_REQUEST_H
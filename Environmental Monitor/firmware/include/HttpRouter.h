@@ -0,0 +1,143 @@
+/*
+ * Compile-Time HTTP Route Table
+ *
+ * Routes (path, verb, handler, query parameter schema) are declared as a
+ * constexpr array and turned into a perfect hash table by the compiler:
+ * makeRouteTable() searches for a seed under which FNV-1a of (path, verb)
+ * sends every route to its own power-of-two slot. A lookup is one hash of
+ * the request path, one mask and one comparison - no linear scan and no
+ * String objects.
+ *
+ * Header-only, no Arduino dependencies.
+ */
+
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AdmissionControl.h"
+#include "HttpRequest.h"
+
+typedef void (*RouteHandler)(const RequestArgs& args);
+
+struct RouteSpec {
+    const char* path;
+    HttpVerb verb;
+    RouteHandler handler;
+    const ParamSpec* params;                   // Query parameter schema (may be nullptr)
+    uint8_t paramCount;
+    RoutePriority priority;                    // Admission class
+    uint16_t cost;                             // Expected loop time in ms (admission budget units)
+    bool streamsBody;                          // Dispatched once headers arrive; the handler
+                                               // detaches the connection to read the body
+};
+
+#define ROUTE_SLOT_EMPTY 0xFF
+#define ROUTE_MAX_SEEDS 4096
+
+constexpr uint32_t routeHash(const char* path, size_t length, HttpVerb verb, uint32_t seed) {
+    uint32_t hash = 2166136261UL ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)path[i];
+        hash *= 16777619UL;
+    }
+    hash ^= verb;
+    hash *= 16777619UL;
+    return hash ^ (hash >> 15);
+}
+
+constexpr size_t routePathLength(const char* path) {
+    size_t length = 0;
+    while (path[length] != '\0') length++;
+    return length;
+}
+
+// Smallest power of two holding twice the routes (keeps the seed search short)
+constexpr size_t routeSlotCount(size_t routes) {
+    size_t slots = 1;
+    while (slots < routes * 2) slots <<= 1;
+    return slots;
+}
+
+template <size_t N>
+class RouteTable {
+public:
+    static constexpr size_t SLOTS = routeSlotCount(N);
+    static_assert(N < ROUTE_SLOT_EMPTY, "too many routes");
+
+    constexpr explicit RouteTable(const RouteSpec (&specs)[N])
+        : routes(), slots(), seed(0), found(false) {
+        for (size_t i = 0; i < N; i++) routes[i] = specs[i];
+
+        for (uint32_t candidate = 0; candidate < ROUTE_MAX_SEEDS && !found; candidate++) {
+            for (size_t s = 0; s < SLOTS; s++) slots[s] = ROUTE_SLOT_EMPTY;
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; i++) {
+                size_t slot = slotOf(routes[i].path, routePathLength(routes[i].path), routes[i].verb, candidate);
+                if (slots[slot] != ROUTE_SLOT_EMPTY) {
+                    collision = true;
+                } else {
+                    slots[slot] = (uint8_t)i;
+                }
+            }
+            if (!collision) {
+                seed = candidate;
+                found = true;
+            }
+        }
+    }
+
+    // True when a collision-free seed was found (check with static_assert)
+    constexpr bool valid() const { return found; }
+
+    const RouteSpec* find(HttpVerb verb, const char* path, size_t length) const {
+        uint8_t index = slots[slotOf(path, length, verb, seed)];
+        if (index == ROUTE_SLOT_EMPTY) return nullptr;
+
+        const RouteSpec& route = routes[index];
+        if (route.verb != verb || !samePath(route.path, path, length)) return nullptr;
+        return &route;
+    }
+
+    // Path registered under another verb (for 405 responses)
+    bool hasPath(const char* path, size_t length) const {
+        for (size_t i = 0; i < N; i++) {
+            if (samePath(routes[i].path, path, length)) return true;
+        }
+        return false;
+    }
+
+    // Type-erased entry points for the server
+    static const RouteSpec* findIn(const void* table, HttpVerb verb, const char* path, size_t length) {
+        return static_cast<const RouteTable*>(table)->find(verb, path, length);
+    }
+    static bool hasPathIn(const void* table, const char* path, size_t length) {
+        return static_cast<const RouteTable*>(table)->hasPath(path, length);
+    }
+
+private:
+    static constexpr size_t slotOf(const char* path, size_t length, HttpVerb verb, uint32_t seed) {
+        return routeHash(path, length, verb, seed) & (SLOTS - 1);
+    }
+
+    static bool samePath(const char* routePath, const char* path, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (routePath[i] != path[i]) return false;   // Also stops at routePath's NUL
+        }
+        return routePath[length] == '\0';
+    }
+
+    RouteSpec routes[N];
+    uint8_t slots[SLOTS];
+    uint32_t seed;
+    bool found;
+};
+
+template <size_t N>
+constexpr RouteTable<N> makeRouteTable(const RouteSpec (&specs)[N]) {
+    return RouteTable<N>(specs);
+}
+
+#endif // HTTP_ROUTER_H
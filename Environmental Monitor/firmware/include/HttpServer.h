@@ -0,0 +1,149 @@
+/*
+ * Minimal HTTP/1.1 Server
+ *
+ * Replaces the Arduino WebServer for the plain-HTTP endpoints. Requests
+ * are read into one fixed receive buffer, parsed in place (HttpRequest.h)
+ * and dispatched through a compile-time route table (HttpRouter.h) with
+ * typed, already-validated arguments. Connections are kept alive and
+ * pipelined requests are served from the same buffer.
+ *
+ * The response side keeps the WebServer calls the handlers already use
+ * (send, sendHeader, setContentLength, sendContent, client), including
+ * chunked streaming when the length is not known up front.
+ *
+ * With an AdmissionController attached every routed request is checked
+ * against the budgets first: it may be deferred (left in the buffer until
+ * the sampler has run) or shed with 503 and Retry-After.
+ *
+ * With a StallMonitor attached the route path and client address of the
+ * request being handled are recorded, so a stall can be attributed.
+ *
+ * With a PowerManager attached the CPU is held at its top clock for the
+ * handler, and the handler time is charged to the current power mode.
+ *
+ * Routes marked streamsBody (large uploads) are dispatched as soon as the
+ * headers are in. Their handler takes the connection with detach() and
+ * reads the body from loop(), so other clients keep being served.
+ */
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <WiFi.h>
+
+#include "HttpRequest.h"
+#include "HttpRouter.h"
+#include "PowerManager.h"
+#include "StallMonitor.h"
+
+#define HTTP_RX_BUFFER_SIZE 2048               // Largest request (line, headers and body)
+#define HTTP_EXTRA_HEADERS_SIZE 256            // Response headers added with sendHeader()
+#define HTTP_REQUEST_TIMEOUT_MS 2000           // Request abandoned this long after its first byte
+#define HTTP_KEEP_ALIVE_TIMEOUT_MS 5000        // Idle persistent connection closed after this
+#define HTTP_CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+// Parser and dispatch counters
+struct HttpServerStats {
+    uint32_t requests;
+    uint32_t badRequests;                      // Malformed, oversized or bad parameters
+    uint32_t notFound;
+    uint32_t keepAliveReuses;                  // Requests served on an already open connection
+    uint32_t shed;                             // Answered 503 by admission control
+};
+
+// Milliseconds until the sampler's next deadline
+typedef uint32_t (*SampleSlack)();
+
+class HttpServer {
+public:
+    explicit HttpServer(uint16_t port);
+
+    template <size_t N>
+    void begin(const RouteTable<N>& table) {
+        routeTable = &table;
+        findRoute = &RouteTable<N>::findIn;
+        pathKnown = &RouteTable<N>::hasPathIn;
+        listener.begin();
+        listener.setNoDelay(true);
+    }
+
+    // Budget checks before every handler (nullptr disables them)
+    void setAdmission(AdmissionController* controller, SampleSlack slack) {
+        admission = controller;
+        sampleSlack = slack;
+    }
+
+    // Attribute handler time to the request for stall reports (nullptr disables it)
+    void setStallMonitor(StallMonitor* monitor, StallTask task) {
+        stallMonitor = monitor;
+        stallTask = task;
+    }
+
+    // Top clock while a handler runs (nullptr disables it)
+    void setPowerManager(PowerManager* manager) { powerManager = manager; }
+
+    // Serve at most one request; call from loop()
+    void handleClient();
+
+    // Response API
+    void sendHeader(const char* name, const String& value);
+    void setContentLength(size_t length);
+    void send(int code, const char* contentType, const char* body, size_t length);
+    void send(int code, const char* contentType, const char* body);
+    void send(int code, const char* contentType, const String& body);
+    void sendContent(const char* data, size_t length);
+    void sendContent(const String& text);
+
+    WiFiClient& client() { return connection; }
+
+    // Hand the current connection to the handler; the server forgets it
+    WiFiClient detach();
+
+    // Complete response on a detached connection (closes after sending)
+    static void respond(WiFiClient& client, int code, const char* contentType, const char* body);
+
+    const HttpServerStats& stats() const { return counters; }
+
+private:
+    typedef const RouteSpec* (*FindRoute)(const void* table, HttpVerb verb, const char* path, size_t length);
+    typedef bool (*PathKnown)(const void* table, const char* path, size_t length);
+
+    bool dispatch(HttpRequest& request);
+    void sendError(int code, const char* message);
+    void writeHead(int code, const char* contentType, size_t length);
+    void closeConnection();
+    void releaseConnection();
+
+    WiFiServer listener;
+    WiFiClient connection;
+
+    const void* routeTable;
+    FindRoute findRoute;
+    PathKnown pathKnown;
+    AdmissionController* admission;
+    SampleSlack sampleSlack;
+    StallMonitor* stallMonitor;
+    StallTask stallTask;
+    PowerManager* powerManager;
+
+    char rxBuffer[HTTP_RX_BUFFER_SIZE];
+    size_t received;
+    unsigned long lastActivity;
+    unsigned long requestStarted;              // First byte of the buffered request
+    uint32_t connectionRequests;
+
+    // Response state for the request being handled
+    char extraHeaders[HTTP_EXTRA_HEADERS_SIZE];
+    size_t extraHeadersLength;
+    size_t contentLength;
+    bool lengthSet;                            // setContentLength() called
+    bool headSent;
+    bool chunked;
+    bool http11;
+    bool keepAlive;
+    bool detached;
+
+    HttpServerStats counters;
+};
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,104 @@
+/*
+ * Per-Subsystem Memory Budget
+ *
+ * A ledger of RAM per subsystem (history, HTTP buffers, JSON documents,
+ * logging, network queues). Each subsystem has:
+ *   Reserved   static buffers it owns (the history ring, receive buffers,
+ *              the stall journal), declared once at boot
+ *   Pool       a byte budget for dynamic allocations, which go through
+ *              allocate()/release() and are counted against it, with a
+ *              high-water mark
+ *
+ * An allocation that would exceed its pool, or leave the heap below the
+ * floor kept for the WiFi stack and lwIP, is refused instead of being
+ * attempted. Callers then degrade (a shorter history page, an unbuffered
+ * response, a 503) and say so with noteDegraded(), so the ledger shows
+ * how often each subsystem ran into its limit.
+ *
+ * MemoryPoolAllocator plugs a pool into ArduinoJson's BasicJsonDocument.
+ *
+ * Portable. Accounting is safe from several tasks; the allocation itself is
+ * the platform malloc.
+ */
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+enum MemorySubsystem : uint8_t {
+    MEMORY_HISTORY = 0,                        // Reading ring, checkpoint, node histories
+    MEMORY_HTTP,                               // Receive, upload and response buffers
+    MEMORY_JSON,                               // JSON documents
+    MEMORY_LOGGING,                            // Anomaly events, stall journal
+    MEMORY_NETWORK,                            // Node link queue, event streams
+    MEMORY_SUBSYSTEM_COUNT
+};
+
+struct MemoryAccount {
+    uint32_t reserved;                         // Static buffers
+    uint32_t budget;                           // Pool size for dynamic allocations
+    uint32_t inUse;
+    uint32_t highWater;
+    uint32_t allocations;
+    uint32_t refused;                          // Over budget, under the heap floor, or out of heap
+    uint32_t degraded;                         // Requests served in a reduced form instead
+};
+
+// Free heap and largest allocatable block, in bytes
+typedef size_t (*HeapProbe)();
+
+class MemoryBudget {
+public:
+    MemoryBudget();
+
+    void setBudget(MemorySubsystem subsystem, uint32_t bytes);
+    void reserve(MemorySubsystem subsystem, uint32_t bytes);
+
+    // Refuse allocations that would leave less than floorBytes of free heap
+    void setHeapFloor(uint32_t floorBytes, HeapProbe freeHeap, HeapProbe largestBlock);
+
+    // nullptr when refused; release() returns the bytes to the pool they came from
+    void* allocate(MemorySubsystem subsystem, size_t size);
+    void* reallocate(void* block, size_t size);
+    void release(void* block);
+
+    // Largest single allocation the pool and the heap would accept now
+    uint32_t available(MemorySubsystem subsystem) const;
+
+    void noteDegraded(MemorySubsystem subsystem);
+
+    const MemoryAccount& account(MemorySubsystem subsystem) const { return accounts[subsystem]; }
+    uint32_t totalReserved() const;
+    uint32_t totalInUse() const;
+
+    static const char* subsystemName(uint8_t subsystem);
+
+private:
+    bool charge(MemorySubsystem subsystem, uint32_t bytes);
+    void refund(MemorySubsystem subsystem, uint32_t bytes);
+    void lock() const;
+    void unlock() const;
+
+    MemoryAccount accounts[MEMORY_SUBSYSTEM_COUNT];
+    uint32_t heapFloor;
+    HeapProbe freeHeap;
+    HeapProbe largestBlock;
+    mutable std::atomic_flag busy;
+};
+
+// ArduinoJson allocator drawing from one pool
+struct MemoryPoolAllocator {
+    MemoryBudget* budget;
+    MemorySubsystem subsystem;
+
+    MemoryPoolAllocator(MemoryBudget* owner, MemorySubsystem pool) : budget(owner), subsystem(pool) {}
+
+    void* allocate(size_t size) { return budget->allocate(subsystem, size); }
+    void deallocate(void* block) { budget->release(block); }
+    void* reallocate(void* block, size_t size) { return budget->reallocate(block, size); }
+};
+
+#endif // MEMORY_BUDGET_H
@@ -0,0 +1,166 @@
+/*
+ * Sensor Node Link - frames, deduplication and batching
+ *
+ * In gateway mode nearby monitors run as nodes: they skip WiFi
+ * association and the web server and send each reading as one compact
+ * frame over a connectionless link (ESP-NOW on the device). The gateway
+ * checks, deduplicates and batches the frames into per-node histories
+ * served with its own data, and logs them to its flash history keyed by
+ * node id (FlashHistory.h), so they are exported with it.
+ *
+ * Frame (20 bytes, little-endian):
+ *   0  magic            8  age_ms (u16)       14 temperature flags
+ *   1  session          10 temperature x100   15 humidity flags
+ *   2  node_id (u16)    12 humidity x100      16 CRC-32 of bytes 0..15
+ *   4  sequence (u32)
+ * The session byte is random per node boot, so a restarted node's
+ * sequence numbers are not mistaken for replays.
+ *
+ * Everything here is portable; the link itself sits behind NodeTransport
+ * (EspNowTransport.h on the device, a simulated lossy link on the host -
+ * see tools/node_link_bench.cpp).
+ */
+
+#ifndef NODE_LINK_H
+#define NODE_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TimeSeriesRing.h"
+
+#define NODE_FRAME_MAGIC       0xE7
+#define NODE_FRAME_SIZE        20
+
+#define NODE_MAX_NODES         16              // Nodes tracked by one gateway
+#define NODE_DEDUP_WINDOW      64              // Sequences remembered per node (bitmap)
+#define NODE_BATCH_SIZE        32              // Readings handed to the sink at once
+#define NODE_BATCH_MAX_AGE_MS  2000            // A partial batch is flushed after this
+#define NODE_HISTORY_SIZE      64              // Readings kept per node at the gateway (power of two)
+#define NODE_EXPIRY_MS         600000          // Silent nodes give up their slot after 10 min
+
+// One reading as carried over the link
+struct NodeReading {
+    uint16_t nodeId;
+    uint8_t session;
+    uint32_t sequence;
+    uint64_t timestamp;                        // Gateway history clock (ms) when sampled
+    float temperature;
+    float humidity;
+    uint8_t temperatureFlags;
+    uint8_t humidityFlags;
+};
+
+// Frame codec
+size_t encodeNodeFrame(const NodeReading& reading, uint16_t ageMs, uint8_t* frame);
+bool decodeNodeFrame(const uint8_t* frame, size_t length, uint64_t receivedAt, NodeReading& reading);
+
+/*
+ * Connectionless link: nodes send, the gateway receives
+ */
+class NodeTransport {
+public:
+    virtual ~NodeTransport() {}
+
+    virtual bool send(const uint8_t* frame, size_t length) = 0;
+
+    // Next received frame (at most NODE_FRAME_SIZE bytes kept), false when none is waiting
+    virtual bool receive(uint8_t* frame, size_t& length) = 0;
+};
+
+// Per-node link statistics
+struct NodeLinkStats {
+    uint16_t nodeId;
+    uint8_t session;
+    uint32_t highestSequence;
+    uint32_t accepted;
+    uint32_t duplicates;
+    uint32_t stale;                            // Older than the dedup window
+    uint32_t lost;                             // Sequence gaps not (yet) filled
+    uint32_t restarts;                         // Session changes
+    uint64_t lastSeen;
+};
+
+struct NodeAggregatorStats {
+    uint32_t frames;
+    uint32_t badFrames;                        // Wrong size, magic or CRC
+    uint32_t rejectedNodes;                    // Node table full
+    uint32_t batches;
+    uint32_t batchedReadings;
+};
+
+typedef void (*NodeBatchSink)(void* context, const NodeReading* readings, size_t count);
+
+/*
+ * Gateway side: validate, drop duplicates, group into batches
+ */
+class NodeAggregator {
+public:
+    NodeAggregator();
+
+    void begin(NodeBatchSink sink, void* context);
+
+    // One received frame; returns true when it was new
+    bool accept(const uint8_t* frame, size_t length, uint64_t now);
+
+    // Flush a batch that has waited long enough, expire silent nodes
+    void service(uint64_t now);
+    void flush();
+
+    uint8_t nodeCount() const;
+    const NodeLinkStats* node(uint8_t index) const;
+    const NodeAggregatorStats& stats() const { return counters; }
+
+private:
+    struct NodeState {
+        bool used;
+        uint64_t window;                       // Bit i: highestSequence - i already seen
+        uint8_t previousSession;               // Late frames from before a restart are stale
+        NodeLinkStats link;
+    };
+
+    NodeState* lookup(uint16_t nodeId, uint64_t now);
+    bool admit(NodeState& state, const NodeReading& reading);
+
+    NodeBatchSink sink;
+    void* sinkContext;
+
+    NodeState nodes[NODE_MAX_NODES];
+    NodeReading batch[NODE_BATCH_SIZE];
+    size_t batchCount;
+    uint64_t batchStarted;
+    uint64_t lastExpiry;
+
+    NodeAggregatorStats counters;
+};
+
+/*
+ * Gateway storage: the newest readings per node id, for /nodes
+ */
+class NodeHistory {
+public:
+    NodeHistory();
+
+    void add(const NodeReading* readings, size_t count);
+
+    uint8_t nodeCount() const;
+    uint16_t nodeId(uint8_t index) const { return slots[index].nodeId; }
+    uint16_t readingCount(uint8_t index) const { return (uint16_t)slots[index].readings.size(); }
+
+    // age 0 is the newest reading of that node
+    const NodeReading& reading(uint8_t index, uint16_t age) const { return slots[index].readings.newest(age); }
+    int8_t find(uint16_t nodeId) const;
+
+private:
+    struct Slot {
+        bool used;
+        uint16_t nodeId;
+        TimeSeriesRing<NodeReading, NODE_HISTORY_SIZE> readings;
+    };
+
+    Slot* slotFor(uint16_t nodeId);
+
+    Slot slots[NODE_MAX_NODES];
+};
+
+#endif // NODE_LINK_H
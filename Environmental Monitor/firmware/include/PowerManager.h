@@ -0,0 +1,119 @@
+/*
+ * CPU Clock and WiFi Power-Save Policy
+ *
+ * Three modes (DeviceConfig.powerMode) trade request latency for current:
+ * - performance: CPU fixed at the top clock, radio always listening
+ * - balanced: dynamic frequency scaling between 80 and 240 MHz, modem
+ *   sleep between DTIM beacons
+ * - low_power: scaling down to 40 MHz, light sleep when the scheduler
+ *   allows it, modem sleep over several beacons
+ *
+ * With scaling the CPU only runs at the top clock while an activity lock
+ * is held: acquire()/release() around sampling and request handling, so
+ * the rest of the loop (mostly delay()) runs at the idle clock. While an
+ * event stream client is attached the effective mode is performance, so
+ * pushed readings are not held back by modem sleep.
+ *
+ * Per effective mode the time spent in it, the time with the lock held and
+ * the handler latencies are measured; the current estimate weights
+ * datasheet figures for the idle and active clocks and the radio state by
+ * that measured duty cycle. A gateway keeps the radio on in every mode
+ * (ESP-NOW frames only arrive while it listens).
+ *
+ * Loop task only, except acquireShared()/releaseShared(), which other
+ * tasks (the HTTPS server) use to hold the top clock; they take only the
+ * SDK locks, so that time is not in the busy figures. Without power management in the SDK (CONFIG_PM_ENABLE)
+ * the clock is switched with setCpuFrequencyMhz() between the idle and the
+ * top clock instead, never below 80 MHz so the APB clock stays put.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <esp_pm.h>
+#include <stdint.h>
+
+#include "DeviceConfig.h"
+
+#define POWER_FALLBACK_MIN_MHZ 80              // Lowest clock without the SDK's power management
+
+// What a mode configures, and its datasheet current figures (ESP32-S3, typical)
+struct PowerModeProfile {
+    uint16_t maxMhz;                           // Clock while an activity lock is held
+    uint16_t minMhz;                           // Idle clock
+    uint8_t wifiPowerSave;                     // wifi_ps_type_t
+    bool lightSleep;                           // Automatic light sleep when idle
+    float activeMa;                            // CPU running at maxMhz
+    float idleMa;                              // CPU waiting at minMhz
+    float radioMa;                             // Average radio current for the power-save type
+    uint16_t wakeLatencyMs;                    // Worst-case delay before a frame to the station is received
+};
+
+// Measured per effective mode since boot
+struct PowerModeStats {
+    uint64_t residencyMicros;                  // Time spent in the mode
+    uint64_t busyMicros;                       // With an activity lock held
+    uint32_t requests;
+    uint64_t requestMicros;                    // Handler time, summed
+    uint32_t maxRequestMicros;
+};
+
+class PowerManager {
+public:
+    PowerManager();
+
+    // Create the locks and apply the mode; radioAlwaysOn pins WiFi power save off
+    void begin(uint8_t mode, bool radioAlwaysOn, int64_t now);
+
+    // Configured mode (from /config)
+    void setMode(uint8_t mode, int64_t now);
+
+    // Low latency while an event stream client is attached
+    void setStreaming(bool attached, int64_t now);
+
+    // Hold the top clock; nests
+    void acquire(int64_t now);
+    void release(int64_t now);
+
+    // Same from another task; release only when acquireShared() returned true
+    bool acquireShared();
+    void releaseShared();
+
+    // Handler time of one request, charged to the effective mode
+    void recordRequest(uint32_t micros);
+
+    uint8_t mode() const { return configured; }
+    uint8_t effectiveMode() const { return effective; }
+    bool streaming() const { return streamAttached; }
+    bool scalingActive() const { return dfs; }
+    bool radioAlwaysOn() const { return radioPinned; }
+
+    // Statistics with the time up to now included
+    PowerModeStats stats(uint8_t mode, int64_t now) const;
+
+    // Average current in a mode at its measured duty cycle (datasheet figures, not measured)
+    float estimatedCurrentMa(uint8_t mode, int64_t now) const;
+
+    // Clocks and radio figures the mode actually runs with on this build
+    PowerModeProfile profile(uint8_t mode) const;
+
+private:
+    void apply();
+    void account(int64_t now);
+
+    esp_pm_lock_handle_t cpuLock;
+    esp_pm_lock_handle_t sleepLock;
+    bool started;
+    bool dfs;                                  // esp_pm_configure() accepted
+    bool lightSleepRefused;                    // Accepted only without light sleep (no tickless idle)
+    bool radioPinned;
+    bool streamAttached;
+    uint8_t configured;
+    uint8_t effective;
+    uint8_t depth;                             // Nested acquire() calls
+    int64_t lastAccounted;
+    int64_t busySince;
+    PowerModeStats modes[POWER_MODE_COUNT];
+};
+
+#endif // POWER_MANAGER_H
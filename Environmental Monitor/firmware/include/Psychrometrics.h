@@ -0,0 +1,32 @@
+/*
+ * Psychrometric Calculations
+ *
+ * Derived comfort/moisture values computed once per sample:
+ * - Dew point (°C)
+ * - NWS heat index (°C, Rothfusz regression with adjustments)
+ * - Absolute humidity (g/m³)
+ * - Vapor pressure deficit (kPa)
+ *
+ * Saturation vapor pressure comes from a 1 °C lookup table (Buck 1981)
+ * with linear interpolation, and dew point is found by inverting the same
+ * table, so no log()/exp() calls are made per sample.
+ */
+
+#ifndef PSYCHROMETRICS_H
+#define PSYCHROMETRICS_H
+
+// Derived values for one temperature/humidity pair
+struct PsychrometricValues {
+    float dewPoint;                            // °C
+    float heatIndex;                           // °C
+    float absoluteHumidity;                    // g/m³
+    float vaporPressureDeficit;                // kPa
+};
+
+// Saturation vapor pressure over water in hPa (table range -40..80 °C, clamped)
+float saturationVaporPressure(float temperatureC);
+
+// Compute all derived values for a reading
+PsychrometricValues computePsychrometrics(float temperatureC, float relativeHumidity);
+
+#endif // PSYCHROMETRICS_H
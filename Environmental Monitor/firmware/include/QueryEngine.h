@@ -0,0 +1,111 @@
+/*
+ * Bucketed Aggregation Queries
+ *
+ * Evaluates /query?series=...&agg=...&bucket=...&from=&to= in a single
+ * streaming pass over readings given in time order. Each bucket holds a
+ * fixed-size accumulator per selected series; a finished bucket is handed
+ * to a callback immediately, so results can be streamed to the client
+ * without materializing them.
+ */
+
+#ifndef QUERY_ENGINE_H
+#define QUERY_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SensorReading.h"
+#include "FlashHistory.h"
+
+// Queryable series (bit positions in a series mask)
+enum QuerySeries : uint8_t {
+    QUERY_SERIES_TEMPERATURE = 0,
+    QUERY_SERIES_HUMIDITY,
+    QUERY_SERIES_DEW_POINT,
+    QUERY_SERIES_HEAT_INDEX,
+    QUERY_SERIES_ABSOLUTE_HUMIDITY,
+    QUERY_SERIES_VPD,
+    QUERY_SERIES_COUNT
+};
+
+// Aggregations (bit positions in an aggregation mask)
+enum QueryAggregation : uint8_t {
+    QUERY_AGG_MEAN = 0,
+    QUERY_AGG_MIN,
+    QUERY_AGG_MAX,
+    QUERY_AGG_COUNT,
+    QUERY_AGG_SUM,
+    QUERY_AGG_FIRST,
+    QUERY_AGG_LAST,
+    QUERY_AGG_TOTAL
+};
+
+// Accumulator for one series within one bucket
+struct BucketAccumulator {
+    float sum;
+    float min;
+    float max;
+    float first;
+    float last;
+    uint32_t count;
+};
+
+// Parsed query
+struct QuerySpec {
+    uint8_t seriesMask;
+    uint8_t aggregationMask;
+    unsigned long bucketMs;
+    uint64_t fromMs;                           // History clock range, inclusive
+    uint64_t toMs;
+};
+
+const char* querySeriesName(uint8_t series);
+const char* queryAggregationName(uint8_t aggregation);
+
+// Extract one series value from a reading
+float querySeriesValue(const SensorReading& reading, uint8_t series);
+
+// Parse comma-separated names into a mask, returns false on unknown names
+bool parseSeriesList(const char* text, uint8_t* mask);
+bool parseAggregationList(const char* text, uint8_t* mask);
+
+// Parse "60", "60s", "5m", "1h" or "1d" into milliseconds, returns false if invalid
+bool parseBucketDuration(const char* text, unsigned long* bucketMs);
+
+// Value of an aggregation from an accumulator
+float bucketAggregationValue(const BucketAccumulator& accumulator, uint8_t aggregation);
+
+// Called for every non-empty bucket, in time order
+typedef void (*BucketCallback)(uint64_t bucketStart, const BucketAccumulator* accumulators,
+                               const QuerySpec& spec, void* context);
+
+/*
+ * Streaming bucket aggregator - feed readings oldest first, then finish()
+ */
+class BucketAggregator {
+public:
+    BucketAggregator(const QuerySpec& spec, BucketCallback callback, void* context);
+
+    void add(const SensorReading& reading);
+    void add(const StoredReading& record);     // Read in place from mapped flash
+    void finish();
+
+    uint32_t bucketsEmitted() const { return emitted; }
+    uint32_t readingsScanned() const { return scanned; }
+
+private:
+    void resetBucket();
+    void emitBucket();
+    void addSample(uint64_t timestamp, const float* values);
+
+    QuerySpec spec;
+    BucketCallback callback;
+    void* context;
+    BucketAccumulator accumulators[QUERY_SERIES_COUNT];
+    uint64_t bucketStart;
+    bool bucketOpen;
+    uint32_t emitted;
+    uint32_t scanned;
+};
+
+#endif // QUERY_ENGINE_H
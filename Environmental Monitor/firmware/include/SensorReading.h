@@ -0,0 +1,29 @@
+/*
+ * Sensor Reading Record
+ *
+ * One entry of the historical readings buffer, shared by the firmware
+ * and the host-buildable analysis/query modules.
+ */
+
+#ifndef SENSOR_READING_H
+#define SENSOR_READING_H
+
+#include <stdint.h>
+
+// Historical data storage - circular buffer for time-series data
+struct SensorReading {
+    uint32_t sequence;                         // Monotonic reading number, continues across reboots
+    float temperature;
+    float humidity;
+    uint64_t timestamp;                        // History clock (ms); 64 bits so it never wraps
+    bool isValid;
+    uint8_t temperatureFlags;                  // ANOMALY_* flags for temperature
+    uint8_t humidityFlags;                     // ANOMALY_* flags for humidity
+    uint16_t checksum;                         // Integrity check for warm-reboot recovery
+    float dewPoint;                            // Derived series, computed at sample time
+    float heatIndex;
+    float absoluteHumidity;
+    float vaporPressureDeficit;
+};
+
+#endif // SENSOR_READING_H
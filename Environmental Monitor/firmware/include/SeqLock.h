@@ -0,0 +1,56 @@
+/*
+ * Sequence Lock
+ *
+ * Single-writer publication primitive: the writer bumps a counter to an
+ * odd value before changing shared state and to the next even value after,
+ * never waiting for readers. Readers copy the state between two counter
+ * reads and retry only if a write overlapped the copy.
+ *
+ * Used to publish the history ring (head, count and records) to HTTP
+ * handlers, uploaders and analytics without stalling the sampler.
+ */
+
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <stdint.h>
+
+class SeqLock {
+public:
+    SeqLock() : sequence(0) {}
+
+    // Writer side - must not be nested or called from two writers
+    void writeBegin() {
+        uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void writeEnd() {
+        uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_release);
+    }
+
+    // Reader side - spins only while a write is in progress
+    uint32_t readBegin() const {
+        uint32_t start;
+        while ((start = sequence.load(std::memory_order_acquire)) & 1) {
+        }
+        return start;
+    }
+
+    // True if the data copied since readBegin() may be torn
+    bool readRetry(uint32_t start) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) != start;
+    }
+
+    // Completed writes so far
+    uint32_t writes() const { return sequence.load(std::memory_order_relaxed) / 2; }
+
+private:
+    std::atomic<uint32_t> sequence;
+};
+
+#endif // SEQ_LOCK_H
@@ -0,0 +1,60 @@
+/*
+ * Spectral Analysis of Temperature History
+ *
+ * Runs a Hann-windowed real FFT over the most recent samples to find the
+ * dominant oscillation (e.g. short-cycling HVAC units). The real FFT of
+ * N samples is computed as an N/2-point complex FFT plus a split step.
+ *
+ * On ESP32-S3 the complex FFT uses esp-dsp, whose fc32 kernels are written
+ * with the S3 vector (PIE) instructions. Elsewhere a portable scalar radix-2
+ * kernel is used, so the analyzer builds and runs on the host.
+ */
+
+#ifndef SPECTRAL_ANALYZER_H
+#define SPECTRAL_ANALYZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPECTRUM_SIZE 256                      // Real FFT length (power of two)
+#define SPECTRUM_BINS (SPECTRUM_SIZE / 2)      // Bins 0..N/2-1 reported
+
+// Result of one analysis run
+struct SpectralResult {
+    bool valid;
+    float dominantFrequencyHz;                 // Interpolated peak frequency
+    float dominantPeriodSeconds;               // 1 / dominantFrequencyHz
+    float dominantAmplitude;                   // Sinusoid amplitude in input units
+    float peakToMeanRatio;                     // Peak power over mean non-DC power
+    float samplePeriodSeconds;                 // Spacing of the analyzed samples
+};
+
+class SpectralAnalyzer {
+public:
+    SpectralAnalyzer();
+
+    // Prepare window/twiddle tables (and esp-dsp tables on the device)
+    bool begin();
+
+    // Analyze SPECTRUM_SIZE samples ordered oldest to newest
+    SpectralResult analyze(const float* samples, float samplePeriodSeconds);
+
+    // Amplitude spectrum of the last analysis (SPECTRUM_BINS entries)
+    const float* amplitudes() const { return amplitude; }
+
+    // Name of the FFT kernel in use ("esp-dsp" or "scalar")
+    const char* backend() const;
+
+private:
+    void complexFFT(float* data, size_t points);
+
+    float window[SPECTRUM_SIZE];
+    float windowSum;
+    float twiddleCos[SPECTRUM_SIZE / 2];
+    float twiddleSin[SPECTRUM_SIZE / 2];
+    float buffer[SPECTRUM_SIZE];               // N/2 interleaved complex values
+    float amplitude[SPECTRUM_BINS];
+    bool ready;
+};
+
+#endif // SPECTRAL_ANALYZER_H
@@ -0,0 +1,152 @@
+/*
+ * Loop and Task Stall Monitor
+ *
+ * Each monitored task reports progress points: entering or leaving a
+ * stage (sampler, HTTP, node link, ...) and explicit progress() calls
+ * from long handlers. The time between two progress points is charged to
+ * the stage that was running; the maximum per stage is kept, and a gap
+ * over the stage's threshold is written to the stall journal together
+ * with what was running (task, stage, endpoint, client).
+ *
+ * A stall that never ends (the board is reset by the task watchdog) has no
+ * closing progress point, so:
+ * - the live state of each task (stage, endpoint, client) is kept in the
+ *   journal itself, in memory that survives a warm reset
+ * - watch(), run from a timer on another task, notes how long a task has
+ *   been stuck once it passes STALL_HANG_MS
+ * After an abnormal reset, begin() turns a task that was busy into a fatal
+ * record, so the stall that killed the board is in the history too.
+ *
+ * Portable; times are esp_timer_get_time() microseconds.
+ */
+
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STALL_JOURNAL_MAGIC    0x53544C4CUL    // "STLL"
+#define STALL_JOURNAL_VERSION  1
+#define STALL_JOURNAL_SIZE     16              // Stall records kept across reboots
+#define STALL_ENDPOINT_LENGTH  24              // Route path, truncated
+#define STALL_NESTING          4               // Stages entered inside a stage (sampler from a handler)
+#define STALL_HANG_MS          1000            // watch() marks a task hung after this
+#define STALL_WATCH_INTERVAL_MS 100            // How often watch() should run
+
+enum StallTask : uint8_t {
+    STALL_TASK_LOOP = 0,                       // Arduino loop()
+    STALL_TASK_TLS,                            // HTTPS server task
+    STALL_TASK_COUNT
+};
+
+enum StallStage : uint8_t {
+    STALL_STAGE_IDLE = 0,                      // Between stages (loop: delay and preemption)
+    STALL_STAGE_SAMPLER,
+    STALL_STAGE_HTTP,
+    STALL_STAGE_NODE_LINK,
+    STALL_STAGE_OTA,
+    STALL_STAGE_SPECTRUM,
+    STALL_STAGE_TLS,
+    STALL_STAGE_COUNT
+};
+
+// StallRecord.flags
+#define STALL_FLAG_HUNG   0x01                 // watch() saw it in progress
+#define STALL_FLAG_FATAL  0x02                 // The board was reset during it
+
+struct StallRecord {
+    uint32_t boot;                             // Boot number it happened in
+    uint32_t uptimeMs;                         // When it ended (0 for fatal records)
+    uint32_t durationMs;                       // Gap without progress (fatal: as far as watch() saw)
+    uint32_t client;                           // Peer IPv4 of the request being served, 0 if none
+    uint8_t task;
+    uint8_t stage;
+    uint8_t flags;
+    uint8_t resetReason;                       // Fatal records: esp_reset_reason() after the reset
+    char endpoint[STALL_ENDPOINT_LENGTH];
+    uint32_t crc;                              // CRC-32 of the fields above
+};
+
+// What one task is doing right now
+struct StallTaskState {
+    volatile uint8_t stage;
+    uint8_t depth;                             // Stages saved on the stack
+    uint8_t stack[STALL_NESTING];
+    volatile uint32_t lastProgress;            // Low 32 bits of the clock (read by watch())
+    volatile uint32_t hungMs;                  // Set by watch() while stuck
+    uint32_t client;
+    char endpoint[STALL_ENDPOINT_LENGTH];
+};
+
+// Lives in no-init RAM; the header CRC covers magic through count
+struct StallJournal {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t boots;
+    uint16_t head;                             // Next record slot
+    uint16_t count;
+    uint32_t crc;
+    StallRecord records[STALL_JOURNAL_SIZE];
+    StallTaskState tasks[STALL_TASK_COUNT];
+};
+
+struct StallStageStats {
+    uint32_t entries;
+    uint32_t stalls;                           // Gaps over the threshold
+    uint32_t maxGapMicros;                     // Longest gap since boot
+};
+
+class StallMonitor {
+public:
+    StallMonitor();
+
+    /*
+     * Adopt the journal after a reset. A power-on or a journal that fails
+     * validation is cleared; after an abnormal reset (panic, watchdog)
+     * tasks that were busy become fatal records. Returns the number of
+     * fatal records added.
+     */
+    uint8_t begin(StallJournal* journal, bool warmReset, bool abnormalReset, uint8_t resetReason, int64_t now);
+
+    // Progress points; enter/leave nest up to STALL_NESTING deep
+    void enter(StallTask task, StallStage stage, int64_t now);
+    void leave(StallTask task, int64_t now);
+    void progress(StallTask task, int64_t now);
+
+    // Attribute what follows to a request (endpoint is copied)
+    void beginRequest(StallTask task, const char* endpoint, uint32_t client);
+    void endRequest(StallTask task);
+
+    // From a timer on another task; true when a task has just passed STALL_HANG_MS
+    bool watch(int64_t now);
+
+    uint32_t boot() const { return journal ? journal->boots : 0; }
+    uint8_t recordCount() const { return journal ? (uint8_t)journal->count : 0; }
+    const StallRecord* record(uint8_t age) const;   // 0 = newest; nullptr if damaged
+    const StallTaskState* taskState(StallTask task) const;
+    const StallStageStats& stageStats(StallStage stage) const { return stages[stage]; }
+    uint32_t stallTotal() const;
+
+    static uint32_t thresholdMs(StallTask task, StallStage stage);
+    static const char* stageName(uint8_t stage);
+    static const char* taskName(uint8_t task);
+
+private:
+    void mark(StallTaskState& state, StallTask task, int64_t now);
+    void append(const StallTaskState& state, StallTask task, uint8_t stage, uint32_t durationMs,
+                uint8_t flags, uint32_t uptimeMs, uint8_t resetReason);
+    void resetJournal();
+    static uint32_t headerCrc(const StallJournal& journal);
+    static uint32_t recordCrc(const StallRecord& record);
+
+    StallJournal* journal;
+    StallStageStats stages[STALL_STAGE_COUNT];
+
+    // The loop and the HTTPS task both append; held for one record copy
+    std::atomic_flag appending;
+};
+
+#endif // STALL_MONITOR_H
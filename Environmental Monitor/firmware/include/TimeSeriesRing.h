@@ -0,0 +1,187 @@
+/*
+ * Fixed-Capacity Time-Series Ring
+ *
+ * Header-only ring of N records (N a power of two). The write position is
+ * a free-running 32-bit counter and slots are found by masking, so there
+ * is no modulo on the sample path and resizing the active window (limit)
+ * never moves data. Logical index 0 is the oldest retained record.
+ *
+ * Access:
+ * - push() / newest(age) / oldest() / operator[] for single records
+ * - begin()/end() iterate oldest first, newestFirst() newest first
+ * - spans() splits a logical range into at most two contiguous pieces,
+ *   for memcpy-style bulk copies and serialization
+ * - lowerBound() binary-searches records kept in time order (T needs a
+ *   timestamp member, or pass a key function)
+ *
+ * There is deliberately no constructor: a ring can live in no-init RAM
+ * and be adopted with restore() after a warm reset, or started with clear().
+ * Not synchronized; writers publish through the caller's lock (SeqLock).
+ */
+
+#ifndef TIME_SERIES_RING_H
+#define TIME_SERIES_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, uint32_t N>
+class TimeSeriesRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "TimeSeriesRing capacity must be a power of two");
+
+public:
+    static constexpr uint32_t CAPACITY = N;
+    static constexpr uint32_t MASK = N - 1;
+
+    // Contiguous run of records
+    struct Span {
+        const T* data;
+        uint32_t length;
+    };
+
+    // A logical range as one or two runs (second.length is 0 when it does not wrap)
+    struct Spans {
+        Span first;
+        Span second;
+        uint32_t size() const { return first.length + second.length; }
+    };
+
+    // Walks positions forwards (oldest first) or backwards (newest first)
+    class Iterator {
+    public:
+        Iterator(const TimeSeriesRing* owner, uint32_t start, bool backwards)
+            : ring(owner), position(start), reverse(backwards) {}
+
+        const T& operator*() const { return ring->slots[(reverse ? position - 1 : position) & MASK]; }
+        const T* operator->() const { return &**this; }
+        Iterator& operator++() {
+            position += reverse ? (uint32_t)-1 : 1;
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return position == other.position; }
+        bool operator!=(const Iterator& other) const { return position != other.position; }
+
+    private:
+        const TimeSeriesRing* ring;
+        uint32_t position;
+        bool reverse;
+    };
+
+    struct Range {
+        Iterator first;
+        Iterator last;
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+    };
+
+    // Empty ring keeping at most limit records
+    void clear(uint32_t limit = N) {
+        head = 0;
+        count = 0;
+        window = (limit == 0 || limit > N) ? N : limit;
+    }
+
+    // Adopt existing contents (after validating them); false if the state is impossible
+    bool restore(uint32_t headPosition, uint32_t size, uint32_t limit) {
+        if (limit == 0 || limit > N || size > limit) return false;
+        head = headPosition;
+        count = size;
+        window = limit;
+        return true;
+    }
+
+    // Change the active window; shrinking forgets the oldest records
+    void setLimit(uint32_t limit) {
+        window = (limit == 0 || limit > N) ? N : limit;
+        if (count > window) count = window;
+    }
+
+    uint32_t size() const { return count; }
+    uint32_t limit() const { return window; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == window; }
+
+    // Free-running write position (records ever pushed, modulo 2^32)
+    uint32_t headPosition() const { return head; }
+
+    // Slot for the next record, which becomes the newest; fill it in place
+    T& push() {
+        T& slot = slots[head & MASK];
+        head++;
+        if (count < window) count++;
+        return slot;
+    }
+
+    void push(const T& value) { push() = value; }
+
+    // age 0 is the newest record; index 0 the oldest
+    const T& newest(uint32_t age = 0) const { return slots[(head - 1 - age) & MASK]; }
+    T& newest(uint32_t age = 0) { return slots[(head - 1 - age) & MASK]; }
+    const T& oldest() const { return slots[(head - count) & MASK]; }
+    const T& operator[](uint32_t index) const { return slots[(head - count + index) & MASK]; }
+    T& operator[](uint32_t index) { return slots[(head - count + index) & MASK]; }
+
+    Iterator begin() const { return Iterator(this, head - count, false); }
+    Iterator end() const { return Iterator(this, head, false); }
+    Range newestFirst() const { return { Iterator(this, head, true), Iterator(this, head - count, true) }; }
+
+    // Logical [first, first + length), clipped to the records held
+    Spans spans(uint32_t first, uint32_t length) const {
+        Spans result = { { slots, 0 }, { slots, 0 } };
+        if (first >= count) return result;
+        if (length > count - first) length = count - first;
+
+        uint32_t start = (head - count + first) & MASK;
+        uint32_t run = N - start;
+        if (run > length) run = length;
+        result.first = { slots + start, run };
+        result.second = { slots, length - run };
+        return result;
+    }
+
+    Spans spans() const { return spans(0, count); }
+
+    // Copy logical [first, first + maxCount) out in at most two block copies
+    uint32_t copy(uint32_t first, T* out, uint32_t maxCount) const {
+        Spans runs = spans(first, maxCount);
+        for (uint32_t i = 0; i < runs.first.length; i++) out[i] = runs.first.data[i];
+        for (uint32_t i = 0; i < runs.second.length; i++) out[runs.first.length + i] = runs.second.data[i];
+        return runs.size();
+    }
+
+    /*
+     * First logical index whose key is not less than key (size() if none).
+     * Records must be in non-decreasing key order, oldest first.
+     */
+    template <typename Key, typename KeyOf>
+    uint32_t lowerBound(const Key& key, KeyOf keyOf) const {
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            if (keyOf((*this)[middle]) < key) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    template <typename Time>
+    uint32_t lowerBound(Time timestamp) const {
+        return lowerBound(timestamp, [](const T& record) { return record.timestamp; });
+    }
+
+    // Backing store, for validation of no-init contents before restore()
+    T* storage() { return slots; }
+    const T* storage() const { return slots; }
+
+private:
+    T slots[N];
+    uint32_t head;
+    uint32_t count;
+    uint32_t window;
+};
+
+#endif // TIME_SERIES_RING_H
@@ -0,0 +1,18 @@
+/*
+ * TLS Credentials for the HTTPS listener
+ *
+ * Paste a PEM certificate and private key here to enable https://<ip>/data.
+ * The listener stays off while these are placeholders. An ECDSA P-256 key
+ * keeps full handshakes short; generate a self-signed pair with:
+ *
+ *   openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+ *       -keyout key.pem -out cert.pem -days 3650 -subj "/CN=envmon.local"
+ */
+
+#ifndef TLS_CREDENTIALS_H
+#define TLS_CREDENTIALS_H
+
+static const char TLS_SERVER_CERT_PEM[] = "YOUR_SERVER_CERTIFICATE_PEM";
+static const char TLS_SERVER_KEY_PEM[] = "YOUR_SERVER_PRIVATE_KEY_PEM";
+
+#endif // TLS_CREDENTIALS_H
@@ -0,0 +1,91 @@
+/*
+ * TLS Listener for /data
+ *
+ * Serves a small set of read-only endpoints over HTTPS using the IDF
+ * esp_https_server component (mbedTLS). A 1 Hz poller must not pay a full
+ * handshake per request, so the listener:
+ * - keeps connections alive (HTTP/1.1 persistent sockets)
+ * - issues session tickets so reconnecting clients resume without the
+ *   ECDHE/signature work of a full handshake. Whether a handshake resumed
+ *   is not reported by esp_https_server, so /status lists resumption as
+ *   unavailable rather than guessing
+ * - bounds concurrent sessions; the least recently used idle session is
+ *   closed when a new client arrives
+ *
+ * mbedTLS on the ESP32-S3 is built with the AES, SHA and RSA/MPI
+ * accelerators enabled (CONFIG_MBEDTLS_HARDWARE_*), so record encryption
+ * and the big-number work of a handshake run on the crypto peripherals.
+ *
+ * Handlers run on the HTTPS server task, not the Arduino loop, so body
+ * providers must only read state published for concurrent readers. With a
+ * PowerManager attached the CPU is held at its top clock for each request
+ * (PowerManager::acquireShared()), as the loop's HttpServer does.
+ */
+
+#ifndef TLS_SERVER_H
+#define TLS_SERVER_H
+
+#include <Arduino.h>
+
+#include "PowerManager.h"
+
+// IDF types, kept out of this header because esp_http_server.h and the
+// Arduino WebServer both define HTTP_GET
+struct httpd_req;
+struct esp_https_server_user_cb_arg;
+
+#define TLS_SERVER_PORT 443
+#define TLS_MAX_SESSIONS 3                     // Each session holds ~40 KB of mbedTLS buffers
+#define TLS_MAX_ROUTES 4
+
+// Fills the response body for one GET request
+typedef void (*TlsBodyProvider)(String& body);
+
+// Counters published to /status
+struct TlsServerStats {
+    uint32_t handshakes;                       // Sessions established, full or resumed
+    uint32_t requests;                         // Requests served
+    uint32_t bytesSent;                        // Response body bytes
+    uint64_t sendMicros;                       // Time spent encrypting and sending bodies
+};
+
+class TlsServer {
+public:
+    TlsServer();
+
+    // Register a GET route before begin()
+    bool on(const char* path, const char* contentType, TlsBodyProvider provider);
+
+    // Start the listener with PEM credentials; false if TLS is unavailable
+    bool begin(const char* certPem, const char* keyPem);
+
+    // Hold the top clock while requests are handled
+    void setPowerManager(PowerManager* manager) { powerManager = manager; }
+
+    bool running() const { return handle != nullptr; }
+    bool sessionTickets() const;
+    bool handshakeStatsAvailable() const;
+
+    const TlsServerStats& stats() const { return counters; }
+
+    // Average microseconds spent encrypting and sending one response
+    float averageSendMicros() const;
+
+private:
+    struct Route {
+        const char* path;
+        const char* contentType;
+        TlsBodyProvider provider;
+    };
+
+    static int handleRequest(struct httpd_req* request);
+    static void sessionCallback(struct esp_https_server_user_cb_arg* arg);
+
+    void* handle;
+    PowerManager* powerManager;
+    Route routes[TLS_MAX_ROUTES];
+    size_t routeCount;
+    TlsServerStats counters;                   // Written only by the HTTPS task
+};
+
+#endif // TLS_SERVER_H
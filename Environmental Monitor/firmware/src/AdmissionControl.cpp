@@ -0,0 +1,132 @@
+/*
+ * Request Admission Control - implementation
+ */
+
+#include "AdmissionControl.h"
+
+#include <string.h>
+
+// Bucket level a class must leave behind, in milli-units (room kept for the classes above)
+static const int32_t CLASS_RESERVE[PRIORITY_COUNT] = {
+    0,                                         // health is charged but never shed
+    ADMISSION_BURST * 1000 / 4,                // current keeps a quarter for health
+    ADMISSION_BURST * 1000 / 2                 // history keeps half for current and health
+};
+
+AdmissionController::AdmissionController() {
+    reset(0);
+}
+
+void AdmissionController::reset(uint32_t now) {
+    globalLevel = ADMISSION_BURST * 1000;
+    lastRefill = now;
+    memset(clients, 0, sizeof(clients));
+    memset(&counters, 0, sizeof(counters));
+}
+
+/*
+ * Units per second equal milli-units per millisecond
+ */
+void AdmissionController::refill(uint32_t now) {
+    uint32_t elapsed = now - lastRefill;
+    lastRefill = now;
+    if (elapsed > 2 * ADMISSION_BURST * 1000 / ADMISSION_RATE) elapsed = 2 * ADMISSION_BURST * 1000 / ADMISSION_RATE;
+
+    globalLevel += (int32_t)(elapsed * ADMISSION_RATE);
+    if (globalLevel > ADMISSION_BURST * 1000) globalLevel = ADMISSION_BURST * 1000;
+}
+
+AdmissionController::ClientBucket& AdmissionController::clientBucket(uint32_t address, uint32_t now) {
+    ClientBucket* oldest = &clients[0];
+    for (uint8_t i = 0; i < ADMISSION_MAX_CLIENTS; i++) {
+        ClientBucket& bucket = clients[i];
+        if (bucket.lastSeen != 0 && bucket.address == address) {
+            uint32_t elapsed = now - bucket.lastSeen;
+            if (elapsed > ADMISSION_CLIENT_BURST * 1000 / ADMISSION_CLIENT_RATE) {
+                bucket.level = ADMISSION_CLIENT_BURST * 1000;
+            } else {
+                bucket.level += (int32_t)(elapsed * ADMISSION_CLIENT_RATE);
+                if (bucket.level > ADMISSION_CLIENT_BURST * 1000) bucket.level = ADMISSION_CLIENT_BURST * 1000;
+            }
+            bucket.lastSeen = now ? now : 1;
+            return bucket;
+        }
+        if (bucket.lastSeen == 0 || (int32_t)(bucket.lastSeen - oldest->lastSeen) < 0) oldest = &bucket;
+    }
+
+    // New client starts with a full bucket (0 marks an unused slot)
+    oldest->address = address;
+    oldest->level = ADMISSION_CLIENT_BURST * 1000;
+    oldest->lastSeen = now ? now : 1;
+    return *oldest;
+}
+
+uint16_t AdmissionController::secondsToRefill(int32_t missing, uint32_t rate) {
+    if (missing <= 0) return 1;
+    uint32_t seconds = ((uint32_t)missing + rate * 1000 - 1) / (rate * 1000);
+    if (seconds < 1) seconds = 1;
+    if (seconds > 60) seconds = 60;
+    return (uint16_t)seconds;
+}
+
+AdmissionDecision AdmissionController::admit(RoutePriority priority, uint16_t cost, uint32_t client,
+                                             uint32_t now, uint32_t sampleSlackMs) {
+    AdmissionDecision decision = { ADMISSION_ADMIT, SHED_GLOBAL_BUDGET, 0 };
+    if (priority >= PRIORITY_COUNT) priority = PRIORITY_HISTORY;
+
+    // The sampler always comes first: a request must finish before the next sample
+    if (cost >= sampleSlackMs) {
+        counters.deferred[priority]++;
+        decision.verdict = ADMISSION_DEFER;
+        return decision;
+    }
+
+    refill(now);
+    int32_t charge = ((int32_t)cost + ADMISSION_PASS_COST) * 1000;
+    int32_t floor = CLASS_RESERVE[priority];
+    if (priority != PRIORITY_HEALTH && globalLevel - charge < floor) {
+        counters.shed[priority][SHED_GLOBAL_BUDGET]++;
+        decision.verdict = ADMISSION_SHED;
+        decision.reason = SHED_GLOBAL_BUDGET;
+        decision.retryAfterSeconds = secondsToRefill(floor + charge - globalLevel, ADMISSION_RATE);
+        return decision;
+    }
+
+    ClientBucket& bucket = clientBucket(client, now);
+    if (priority != PRIORITY_HEALTH && bucket.level < charge) {
+        counters.shed[priority][SHED_CLIENT_BUDGET]++;
+        decision.verdict = ADMISSION_SHED;
+        decision.reason = SHED_CLIENT_BUDGET;
+        decision.retryAfterSeconds = secondsToRefill(charge - bucket.level, ADMISSION_CLIENT_RATE);
+        return decision;
+    }
+
+    globalLevel -= charge;
+    bucket.level -= charge;
+    counters.admitted[priority]++;
+    return decision;
+}
+
+/*
+ * Replace the estimate with the measured time (a unit is a millisecond, so
+ * microseconds are milli-units); an overrun leaves the bucket in debt,
+ * which holds back the lower classes until it is repaid. The pass cost
+ * charged by admit() is kept
+ */
+void AdmissionController::complete(uint16_t cost, uint32_t elapsedMicros) {
+    int32_t actual = (int32_t)(elapsedMicros > 60000000UL ? 60000000UL : elapsedMicros);
+    int32_t difference = (int32_t)cost * 1000 - actual;
+    if (difference < 0) counters.overruns++;
+
+    globalLevel += difference;
+    if (globalLevel > ADMISSION_BURST * 1000) globalLevel = ADMISSION_BURST * 1000;
+    if (globalLevel < -ADMISSION_DEBT_LIMIT * 1000) globalLevel = -ADMISSION_DEBT_LIMIT * 1000;
+}
+
+uint32_t AdmissionController::shedTotal() const {
+    uint32_t total = 0;
+    for (uint8_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        for (uint8_t reason = 0; reason < SHED_REASON_COUNT; reason++) total += counters.shed[priority][reason];
+    }
+    return total;
+}
@@ -0,0 +1,147 @@
+/*
+ * Streaming Anomaly Detection - implementation
+ * See AnomalyDetector.h for an overview of the detectors.
+ */
+
+#include "AnomalyDetector.h"
+
+#include <math.h>
+
+SeriesAnomalyDetector::SeriesAnomalyDetector(const AnomalyConfig& cfg)
+    : config(cfg) {
+    reset();
+}
+
+/*
+ * Reset learned statistics (e.g. after a sensor swap)
+ */
+void SeriesAnomalyDetector::reset() {
+    ewmaMean = 0.0f;
+    ewmaVariance = 0.0f;
+    cusumPos = 0.0f;
+    cusumNeg = 0.0f;
+    zScore = 0.0f;
+    lastValue = 0.0f;
+    lastTimestamp = 0;
+    unchangedSince = 0;
+    sampleCount = 0;
+}
+
+/*
+ * Standard deviation with the configured resolution floor
+ */
+float SeriesAnomalyDetector::stdDev() const {
+    float sd = sqrtf(ewmaVariance);
+    return (sd < config.minStdDev) ? config.minStdDev : sd;
+}
+
+/*
+ * Update all detectors with one sample
+ * Cost is a handful of float operations and one sqrtf.
+ */
+uint8_t SeriesAnomalyDetector::update(float value, unsigned long timestampMs) {
+    uint8_t flags = ANOMALY_NONE;
+
+    // First sample only seeds the state
+    if (sampleCount == 0) {
+        ewmaMean = value;
+        lastValue = value;
+        lastTimestamp = timestampMs;
+        unchangedSince = timestampMs;
+        sampleCount = 1;
+        return flags;
+    }
+
+    // Rate of change against the previous sample
+    unsigned long elapsed = timestampMs - lastTimestamp;
+    if (elapsed > 0) {
+        float rate = fabsf(value - lastValue) * 1000.0f / (float)elapsed;
+        if (rate > config.maxRatePerSecond) {
+            flags |= ANOMALY_RATE;
+        }
+    }
+
+    // Flat-line detection, timed so it does not depend on the reading interval
+    if (fabsf(value - lastValue) < 0.5f * config.resolution) {
+        if (timestampMs - unchangedSince >= config.stuckSeconds * 1000UL) {
+            flags |= ANOMALY_STUCK;
+        }
+    } else {
+        unchangedSince = timestampMs;
+    }
+
+    // Standardized residual against the prior estimate
+    float sd = stdDev();
+    float residual = value - ewmaMean;
+    zScore = residual / sd;
+
+    bool warmedUp = sampleCount >= config.warmupSamples;
+    if (warmedUp) {
+        if (fabsf(zScore) > config.zThreshold) {
+            flags |= ANOMALY_OUTLIER;
+        }
+
+        // Two-sided CUSUM on z clipped to the outlier threshold, so one spike
+        // adds at most zThreshold - k and only a sustained shift can alarm;
+        // restarted after each alarm
+        float clipped = fmaxf(-config.zThreshold, fminf(config.zThreshold, zScore));
+        cusumPos = fmaxf(0.0f, cusumPos + clipped - config.cusumSlack);
+        cusumNeg = fmaxf(0.0f, cusumNeg - clipped - config.cusumSlack);
+        if (cusumPos > config.cusumThreshold || cusumNeg > config.cusumThreshold) {
+            flags |= ANOMALY_LEVEL_SHIFT;
+            cusumPos = 0.0f;
+            cusumNeg = 0.0f;
+        }
+    }
+
+    // Winsorize outliers so a single spike does not inflate the variance
+    if (flags & ANOMALY_OUTLIER) {
+        float limit = config.zThreshold * sd;
+        residual = (residual > 0.0f) ? limit : -limit;
+    }
+
+    // Incremental EWMA mean and variance (West's update)
+    float increment = config.ewmaAlpha * residual;
+    ewmaMean += increment;
+    ewmaVariance = (1.0f - config.ewmaAlpha) * (ewmaVariance + residual * increment);
+
+    lastValue = value;
+    lastTimestamp = timestampMs;
+    if (sampleCount < 0xFFFFFFFFUL) sampleCount++;
+
+    return flags;
+}
+
+AnomalyEventLog::AnomalyEventLog() {
+    clear();
+}
+
+/*
+ * Drop all logged events
+ */
+void AnomalyEventLog::clear() {
+    events.clear();
+    total = 0;
+    lastFlags[0] = ANOMALY_NONE;
+    lastFlags[1] = ANOMALY_NONE;
+}
+
+/*
+ * Log an event when the flag set of a series changes to something non-zero
+ */
+void AnomalyEventLog::record(uint8_t series, uint8_t flags, float value, float zScore,
+                             uint64_t timestamp) {
+    if (series > ANOMALY_SERIES_HUMIDITY) return;
+
+    uint8_t previous = lastFlags[series];
+    lastFlags[series] = flags;
+    if (flags == ANOMALY_NONE || flags == previous) return;
+
+    AnomalyEvent& event = events.push();
+    event.timestamp = timestamp;
+    event.value = value;
+    event.zScore = zScore;
+    event.series = series;
+    event.flags = flags;
+    total++;
+}
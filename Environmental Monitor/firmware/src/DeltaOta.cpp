@@ -0,0 +1,208 @@
+/*
+ * Delta OTA Update Session - implementation
+ */
+
+#include "DeltaOta.h"
+#include "HttpServer.h"
+
+#include <esp_idf_version.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+
+DeltaOtaSession::DeltaOtaSession()
+    : buffered(0), runningPartition(nullptr), targetPartition(nullptr), otaHandle(0), otaOpen(false),
+      state(OTA_IDLE), patchSize(0), received(0), startedAt(0), lastData(0), finishedAt(0),
+      maxStepMicros(0), error(nullptr) {
+}
+
+const char* DeltaOtaSession::stateName(OtaState state) {
+    switch (state) {
+        case OTA_IDLE: return "idle";
+        case OTA_RECEIVING: return "receiving";
+        case OTA_REBOOT_PENDING: return "reboot_pending";
+        case OTA_FAILED: return "failed";
+    }
+    return "unknown";
+}
+
+const char* DeltaOtaSession::start(WiFiClient client, size_t size, const char* prefix, size_t prefixLength) {
+    const char* refusal = nullptr;
+    int code = 400;
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+
+    if (state == OTA_RECEIVING || state == OTA_REBOOT_PENDING) {
+        refusal = "Update already in progress";
+        code = 409;
+    } else if (size < sizeof(DeltaHeader) || prefixLength > size || prefixLength > OTA_RX_BUFFER_SIZE) {
+        refusal = "Missing or invalid Content-Length";
+    } else if (running == nullptr || target == nullptr) {
+        refusal = "No OTA slot available";
+        code = 500;
+    }
+    if (refusal != nullptr) {
+        HttpServer::respond(client, code, "text/plain", refusal);
+        return refusal;
+    }
+
+    connection = client;
+    runningPartition = running;
+    targetPartition = target;
+    otaOpen = false;
+    memcpy(rxBuffer, prefix, prefixLength);
+    buffered = prefixLength;
+    patchSize = size;
+    received = prefixLength;
+    startedAt = millis();
+    lastData = startedAt;
+    finishedAt = 0;
+    maxStepMicros = 0;
+    error = nullptr;
+    applier.begin(readOld, writeNew, this);
+    state = OTA_RECEIVING;
+    return nullptr;
+}
+
+bool DeltaOtaSession::readOld(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    DeltaOtaSession* session = static_cast<DeltaOtaSession*>(context);
+    const esp_partition_t* running = (const esp_partition_t*)session->runningPartition;
+    if (offset + length > running->size) return false;
+    return esp_partition_read(running, offset, buffer, length) == ESP_OK;
+}
+
+/*
+ * The slot is opened on the first write, once the header has told us the
+ * image size and the base image has been checked - a rejected delta never
+ * erases anything.
+ */
+bool DeltaOtaSession::writeNew(void* context, const uint8_t* data, size_t length) {
+    DeltaOtaSession* session = static_cast<DeltaOtaSession*>(context);
+    const esp_partition_t* target = (const esp_partition_t*)session->targetPartition;
+
+    if (!session->otaOpen) {
+        if (session->applier.header().newSize > target->size) return false;
+        esp_ota_handle_t handle = 0;
+#ifdef OTA_WITH_SEQUENTIAL_WRITES
+        size_t eraseSize = OTA_WITH_SEQUENTIAL_WRITES;   // Erase sector by sector as data arrives
+#else
+        size_t eraseSize = session->applier.header().newSize;
+#endif
+        if (esp_ota_begin(target, eraseSize, &handle) != ESP_OK) return false;
+        session->otaHandle = handle;
+        session->otaOpen = true;
+    }
+    return esp_ota_write((esp_ota_handle_t)session->otaHandle, data, length) == ESP_OK;
+}
+
+/*
+ * One bounded step: top up the buffer from the socket, then let the
+ * applier consume it within its output budget
+ */
+void DeltaOtaSession::service() {
+    if (state != OTA_RECEIVING) return;
+    int64_t stepStart = esp_timer_get_time();
+
+    int available = connection.available();
+    if (available > 0 && buffered < OTA_RX_BUFFER_SIZE && received < patchSize) {
+        size_t room = OTA_RX_BUFFER_SIZE - buffered;
+        size_t remaining = patchSize - received;
+        size_t wanted = (size_t)available;
+        if (wanted > room) wanted = room;
+        if (wanted > remaining) wanted = remaining;
+        int count = connection.read(rxBuffer + buffered, wanted);
+        if (count > 0) {
+            buffered += count;
+            received += count;
+            lastData = millis();
+        }
+    }
+
+    size_t consumed = 0;
+    DeltaStatus status = applier.push(rxBuffer, buffered, &consumed);
+    if (consumed > 0) {
+        memmove(rxBuffer, rxBuffer + consumed, buffered - consumed);
+        buffered -= consumed;
+    }
+
+    if (status == DELTA_DONE) {
+        finish();
+    } else if (status != DELTA_CONTINUE) {
+        abort((status == DELTA_ERROR_IO) ? 500 : 400, deltaStatusName(status));
+    } else if (received == patchSize && applier.needsInput()) {
+        abort(400, "truncated_patch");   // Whole body in, applier still wants more
+    } else if (received < patchSize && millis() - lastData > OTA_IDLE_TIMEOUT_MS) {
+        abort(408, "upload_timeout");
+    } else if (received < patchSize && !connection.connected() && connection.available() == 0) {
+        abort(400, "client_disconnected");
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - stepStart);
+    if (elapsed > maxStepMicros) maxStepMicros = elapsed;
+}
+
+void DeltaOtaSession::finish() {
+    if (esp_ota_end((esp_ota_handle_t)otaHandle) != ESP_OK) {
+        otaOpen = false;
+        abort(500, "image_rejected");
+        return;
+    }
+    otaOpen = false;
+    if (esp_ota_set_boot_partition((const esp_partition_t*)targetPartition) != ESP_OK) {
+        abort(500, "set_boot_failed");
+        return;
+    }
+
+    char body[128];
+    snprintf(body, sizeof(body), "{\"status\":\"ok\",\"image_size\":%lu,\"patch_size\":%lu,\"rebooting\":true}",
+             (unsigned long)applier.header().newSize, (unsigned long)patchSize);
+    HttpServer::respond(connection, 200, "application/json", body);
+    finishedAt = millis();
+    state = OTA_REBOOT_PENDING;
+}
+
+void DeltaOtaSession::abort(int code, const char* message) {
+    if (otaOpen) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 3, 0)
+        esp_ota_abort((esp_ota_handle_t)otaHandle);
+#else
+        esp_ota_end((esp_ota_handle_t)otaHandle);
+#endif
+        otaOpen = false;
+    }
+
+    char body[96];
+    snprintf(body, sizeof(body), "{\"status\":\"error\",\"error\":\"%s\"}", message);
+    HttpServer::respond(connection, code, "application/json", body);
+    error = message;
+    finishedAt = millis();
+    state = OTA_FAILED;
+    Serial.printf("OTA failed: %s after %lu of %lu bytes\n", message,
+                  (unsigned long)received, (unsigned long)patchSize);
+}
+
+bool DeltaOtaSession::confirmRunningImage() {
+    esp_ota_img_states_t imageState;
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (esp_ota_get_state_partition(running, &imageState) != ESP_OK) return false;
+    if (imageState != ESP_OTA_IMG_PENDING_VERIFY) return false;
+    return esp_ota_mark_app_valid_cancel_rollback() == ESP_OK;
+}
+
+bool DeltaOtaSession::rebootDue() const {
+    return state == OTA_REBOOT_PENDING && millis() - finishedAt > OTA_REBOOT_DELAY_MS;
+}
+
+OtaProgress DeltaOtaSession::progress() const {
+    OtaProgress result;
+    result.state = state;
+    result.patchSize = patchSize;
+    result.received = received;
+    result.written = applier.written();
+    result.imageSize = applier.headerReady() ? applier.header().newSize : 0;
+    unsigned long end = (state == OTA_RECEIVING) ? millis() : finishedAt;
+    result.elapsedMs = (state == OTA_IDLE) ? 0 : (uint32_t)(end - startedAt);
+    result.maxStepMicros = maxStepMicros;
+    result.error = error;
+    return result;
+}
@@ -0,0 +1,275 @@
+/*
+ * Compressed Firmware Delta Format and Streaming Applier - implementation
+ */
+
+#include "DeltaPatch.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "HistoryCheckpoint.h"
+
+#define DELTA_NO_OP 0xFF
+
+const char* deltaStatusName(DeltaStatus status) {
+    switch (status) {
+        case DELTA_CONTINUE: return "in_progress";
+        case DELTA_DONE: return "done";
+        case DELTA_ERROR_HEADER: return "bad_header";
+        case DELTA_ERROR_BASE: return "base_mismatch";
+        case DELTA_ERROR_FORMAT: return "corrupt_patch";
+        case DELTA_ERROR_IO: return "flash_error";
+        case DELTA_ERROR_VERIFY: return "verify_failed";
+    }
+    return "unknown";
+}
+
+void sealDeltaHeader(DeltaHeader& header) {
+    header.crc = checkpointCrc32(&header, offsetof(DeltaHeader, crc));
+}
+
+bool deltaHeaderValid(const DeltaHeader& header) {
+    return header.magic == DELTA_MAGIC &&
+           header.version == DELTA_VERSION &&
+           header.crc == checkpointCrc32(&header, offsetof(DeltaHeader, crc));
+}
+
+static uint32_t readLE32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+DeltaApplier::DeltaApplier()
+    : readOld(nullptr), writeNew(nullptr), context(nullptr) {
+    begin(nullptr, nullptr, nullptr);
+}
+
+void DeltaApplier::begin(DeltaReadOld reader, DeltaWriteNew writer, void* ioContext) {
+    readOld = reader;
+    writeNew = writer;
+    context = ioContext;
+
+    state = STATE_HEADER;
+    error = DELTA_CONTINUE;
+    starved = false;
+    memset(&patchHeader, 0, sizeof(patchHeader));
+    headerBytes = 0;
+
+    memset(window, 0, sizeof(window));
+    windowPos = 0;
+    flagBits = 0;
+    matchDistance = 0;
+    matchRemaining = 0;
+    tokenLength = 0;
+
+    opCode = DELTA_NO_OP;
+    fieldBytes = 0;
+    opOffset = 0;
+    opRemaining = 0;
+
+    oldBlockStart = 0;
+    oldBlockLength = 0;
+    outLength = 0;
+    outputOffset = 0;
+    outputCrc = 0;
+    verifyOffset = 0;
+    verifyCrc = 0;
+}
+
+DeltaStatus DeltaApplier::fail(DeltaStatus status) {
+    state = STATE_FAILED;
+    error = status;
+    return status;
+}
+
+/*
+ * Next byte of the decompressed operation stream
+ * Flag bytes announce eight tokens (1 = literal, 0 = match). A match is
+ * 12 bits of distance - 1 and a 4-bit length - 3; length nibble 15 adds
+ * an extension byte. Tokens may straddle push() calls.
+ */
+bool DeltaApplier::nextStreamByte(const uint8_t*& in, const uint8_t* end, uint8_t& out) {
+    const uint16_t mask = DELTA_WINDOW_SIZE - 1;
+    while (matchRemaining == 0) {
+        if (in >= end) return false;
+
+        if (flagBits <= 1) {
+            flagBits = 0x100 | *in++;
+            continue;
+        }
+        if (flagBits & 1) {
+            flagBits >>= 1;
+            out = *in++;
+            window[windowPos++ & mask] = out;
+            return true;
+        }
+
+        tokenBytes[tokenLength++] = *in++;
+        if (tokenLength < 2) continue;
+        uint8_t nibble = tokenBytes[1] & 0x0F;
+        if (nibble == 15 && tokenLength < 3) continue;
+
+        matchDistance = (uint16_t)((((tokenBytes[1] >> 4) << 8) | tokenBytes[0]) + 1);
+        matchRemaining = (uint16_t)(nibble + DELTA_MIN_MATCH + ((nibble == 15) ? tokenBytes[2] : 0));
+        tokenLength = 0;
+        flagBits >>= 1;
+    }
+
+    out = window[(uint16_t)(windowPos - matchDistance) & mask];
+    window[windowPos++ & mask] = out;
+    matchRemaining--;
+    return true;
+}
+
+bool DeltaApplier::flushOutput() {
+    if (outLength == 0) return true;
+    outputCrc = checkpointCrc32(outBlock, outLength, outputCrc);
+    bool ok = writeNew(context, outBlock, outLength);
+    outLength = 0;
+    return ok;
+}
+
+bool DeltaApplier::emit(uint8_t value) {
+    outBlock[outLength++] = value;
+    outputOffset++;
+    return outLength < DELTA_IO_BLOCK || flushOutput();
+}
+
+/*
+ * Old-image byte through a one-block cache (operations read forward)
+ */
+bool DeltaApplier::oldByte(uint32_t offset, uint8_t& out) {
+    if (offset - oldBlockStart >= oldBlockLength) {
+        uint32_t available = patchHeader.oldSize - offset;
+        oldBlockLength = (available < DELTA_IO_BLOCK) ? available : DELTA_IO_BLOCK;
+        oldBlockStart = offset;
+        if (!readOld(context, offset, oldBlock, oldBlockLength)) {
+            oldBlockLength = 0;
+            return false;
+        }
+    }
+    out = oldBlock[offset - oldBlockStart];
+    return true;
+}
+
+bool DeltaApplier::finishImage() {
+    if (!flushOutput()) {
+        fail(DELTA_ERROR_IO);
+        return false;
+    }
+    if (outputOffset != patchHeader.newSize || outputCrc != patchHeader.newCrc) {
+        fail(DELTA_ERROR_VERIFY);
+        return false;
+    }
+    state = STATE_DONE;
+    return true;
+}
+
+DeltaStatus DeltaApplier::push(const uint8_t* data, size_t length, size_t* consumed) {
+    const uint8_t* in = data;
+    const uint8_t* end = data + length;
+    uint32_t budget = DELTA_OUTPUT_BUDGET;
+    uint8_t value = 0;
+
+    while (budget > 0 && state != STATE_DONE && state != STATE_FAILED) {
+        if (state == STATE_HEADER) {
+            uint8_t* raw = (uint8_t*)&patchHeader;
+            while (headerBytes < sizeof(DeltaHeader) && in < end) {
+                raw[headerBytes++] = *in++;
+            }
+            if (headerBytes < sizeof(DeltaHeader)) break;
+            if (!deltaHeaderValid(patchHeader)) {
+                fail(DELTA_ERROR_HEADER);
+                break;
+            }
+            state = STATE_VERIFY_BASE;
+
+        } else if (state == STATE_VERIFY_BASE) {
+            // Check the running image is the delta's base before writing anything
+            uint32_t remaining = patchHeader.oldSize - verifyOffset;
+            size_t chunk = (remaining < DELTA_IO_BLOCK) ? remaining : DELTA_IO_BLOCK;
+            if (chunk > 0) {
+                if (!readOld(context, verifyOffset, oldBlock, chunk)) {
+                    fail(DELTA_ERROR_IO);
+                    break;
+                }
+                verifyCrc = checkpointCrc32(oldBlock, chunk, verifyCrc);
+                verifyOffset += chunk;
+                budget = (budget > chunk) ? budget - chunk : 0;
+            }
+            if (verifyOffset == patchHeader.oldSize) {
+                if (verifyCrc != patchHeader.oldCrc) {
+                    fail(DELTA_ERROR_BASE);
+                    break;
+                }
+                oldBlockLength = 0;
+                state = STATE_OP;
+            }
+
+        } else if (state == STATE_OP) {
+            if (!nextStreamByte(in, end, value)) break;
+
+            if (opCode == DELTA_NO_OP) {
+                opCode = value;
+                fieldBytes = 0;
+                if (opCode == DELTA_OP_END) {
+                    finishImage();
+                    break;
+                }
+                if (opCode != DELTA_OP_COPY && opCode != DELTA_OP_ADD && opCode != DELTA_OP_INSERT) {
+                    fail(DELTA_ERROR_FORMAT);
+                    break;
+                }
+                continue;
+            }
+
+            fields[fieldBytes++] = value;
+            uint8_t needed = (opCode == DELTA_OP_INSERT) ? 4 : 8;
+            if (fieldBytes < needed) continue;
+
+            if (opCode == DELTA_OP_INSERT) {
+                opOffset = 0;
+                opRemaining = readLE32(fields);
+            } else {
+                opOffset = readLE32(fields);
+                opRemaining = readLE32(fields + 4);
+                if (opOffset > patchHeader.oldSize || opRemaining > patchHeader.oldSize - opOffset) {
+                    fail(DELTA_ERROR_FORMAT);
+                    break;
+                }
+            }
+            if (opRemaining > patchHeader.newSize - outputOffset) {
+                fail(DELTA_ERROR_FORMAT);
+                break;
+            }
+
+            state = (opCode == DELTA_OP_COPY) ? STATE_COPY : (opCode == DELTA_OP_ADD) ? STATE_ADD : STATE_INSERT;
+            opCode = DELTA_NO_OP;
+
+        } else {
+            // COPY, ADD or INSERT: one output byte per step, within the budget
+            uint8_t base = 0;
+            uint8_t diff = 0;
+            if (opRemaining == 0) {
+                state = STATE_OP;
+                continue;
+            }
+            if (state != STATE_COPY && !nextStreamByte(in, end, diff)) break;
+            if (state != STATE_INSERT && !oldByte(opOffset++, base)) {
+                fail(DELTA_ERROR_IO);
+                break;
+            }
+            value = (state == STATE_INSERT) ? diff : (uint8_t)(base + diff);
+            if (!emit(value)) {
+                fail(DELTA_ERROR_IO);
+                break;
+            }
+            opRemaining--;
+            budget--;
+        }
+    }
+
+    starved = budget > 0 && state != STATE_DONE && state != STATE_FAILED;
+    if (consumed != nullptr) *consumed = in - data;
+    return status();
+}
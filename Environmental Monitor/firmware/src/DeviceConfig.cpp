@@ -0,0 +1,176 @@
+/*
+ * Runtime Device Configuration - implementation
+ */
+
+#include "DeviceConfig.h"
+
+#include <Preferences.h>
+#include <string.h>
+
+#define DEVICE_CONFIG_NAMESPACE "envmon"
+#define DEVICE_CONFIG_KEY "config"
+
+// Layouts written by earlier firmware, read back on upgrade
+struct DeviceConfigV1 {
+    uint16_t version;
+    uint32_t readingIntervalMs;
+    uint16_t historySize;
+    uint16_t dataHistoryLimit;
+    uint8_t dhtPin;
+    uint8_t dhtType;
+};
+
+struct DeviceConfigV2 {
+    uint16_t version;
+    uint32_t readingIntervalMs;
+    uint16_t historySize;
+    uint16_t dataHistoryLimit;
+    uint8_t dhtPin;
+    uint8_t dhtType;
+    uint8_t linkRole;
+    uint8_t linkChannel;
+    uint16_t nodeId;
+};
+
+/*
+ * Range checks for every field
+ */
+const char* validateDeviceConfig(const DeviceConfig& config, uint16_t historyCapacity) {
+    if (config.readingIntervalMs < 1000 || config.readingIntervalMs > 3600000) {
+        return "reading_interval_ms must be 1000..3600000";
+    }
+    if (config.historySize < 10 || config.historySize > historyCapacity) {
+        return "history_size out of range";
+    }
+    if (config.dataHistoryLimit < 1 || config.dataHistoryLimit > config.historySize) {
+        return "data_history_limit must be 1..history_size";
+    }
+    if (config.dhtPin > 48) {
+        return "dht_pin must be a valid GPIO";
+    }
+    if (config.dhtType != 11 && config.dhtType != 12 && config.dhtType != 21 && config.dhtType != 22) {
+        return "dht_type must be 11, 12, 21 or 22";
+    }
+    if (config.linkRole > LINK_ROLE_NODE) {
+        return "link_role must be standalone, gateway or node";
+    }
+    if (config.linkChannel < 1 || config.linkChannel > 13) {
+        return "link_channel must be 1..13";
+    }
+    if (config.powerMode >= POWER_MODE_COUNT) {
+        return "power_mode must be performance, balanced or low_power";
+    }
+    return nullptr;
+}
+
+const char* linkRoleName(uint8_t role) {
+    switch (role) {
+        case LINK_ROLE_STANDALONE: return "standalone";
+        case LINK_ROLE_GATEWAY: return "gateway";
+        case LINK_ROLE_NODE: return "node";
+    }
+    return "unknown";
+}
+
+bool parseLinkRole(const char* text, uint8_t* role) {
+    for (uint8_t candidate = LINK_ROLE_STANDALONE; candidate <= LINK_ROLE_NODE; candidate++) {
+        if (strcmp(text, linkRoleName(candidate)) == 0) {
+            *role = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* powerModeName(uint8_t mode) {
+    switch (mode) {
+        case POWER_MODE_PERFORMANCE: return "performance";
+        case POWER_MODE_BALANCED: return "balanced";
+        case POWER_MODE_LOW_POWER: return "low_power";
+    }
+    return "unknown";
+}
+
+bool parsePowerMode(const char* text, uint8_t* mode) {
+    for (uint8_t candidate = POWER_MODE_PERFORMANCE; candidate < POWER_MODE_COUNT; candidate++) {
+        if (strcmp(text, powerModeName(candidate)) == 0) {
+            *mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Bring a blob written by earlier firmware up to the current layout;
+ * fields that version did not have keep their defaults
+ */
+static bool migrateDeviceConfig(uint16_t version, const uint8_t* blob, size_t length, DeviceConfig& config) {
+    if (version == 1 && length == sizeof(DeviceConfigV1)) {
+        DeviceConfigV1 old;
+        memcpy(&old, blob, sizeof(old));
+        config.readingIntervalMs = old.readingIntervalMs;
+        config.historySize = old.historySize;
+        config.dataHistoryLimit = old.dataHistoryLimit;
+        config.dhtPin = old.dhtPin;
+        config.dhtType = old.dhtType;
+        return true;
+    }
+    if (version == 2 && length == sizeof(DeviceConfigV2)) {
+        DeviceConfigV2 old;
+        memcpy(&old, blob, sizeof(old));
+        config.readingIntervalMs = old.readingIntervalMs;
+        config.historySize = old.historySize;
+        config.dataHistoryLimit = old.dataHistoryLimit;
+        config.dhtPin = old.dhtPin;
+        config.dhtType = old.dhtType;
+        config.linkRole = old.linkRole;
+        config.linkChannel = old.linkChannel;
+        config.nodeId = old.nodeId;
+        return true;
+    }
+    return false;
+}
+
+bool loadDeviceConfig(DeviceConfig& config, const DeviceConfig& defaults, uint16_t historyCapacity) {
+    config = defaults;
+
+    Preferences preferences;
+    if (!preferences.begin(DEVICE_CONFIG_NAMESPACE, true)) {
+        return false;
+    }
+
+    uint8_t blob[sizeof(DeviceConfig)];
+    size_t length = preferences.getBytes(DEVICE_CONFIG_KEY, blob, sizeof(blob));
+    preferences.end();
+
+    uint16_t version = 0;
+    if (length >= sizeof(version)) {
+        memcpy(&version, blob, sizeof(version));
+    }
+
+    DeviceConfig stored = defaults;
+    if (version == DEVICE_CONFIG_VERSION && length == sizeof(stored)) {
+        memcpy(&stored, blob, sizeof(stored));
+    } else if (!migrateDeviceConfig(version, blob, length, stored)) {
+        return false;
+    }
+    stored.version = DEVICE_CONFIG_VERSION;
+
+    if (validateDeviceConfig(stored, historyCapacity) != nullptr) {
+        return false;
+    }
+
+    config = stored;
+    return true;
+}
+
+bool saveDeviceConfig(const DeviceConfig& config) {
+    Preferences preferences;
+    if (!preferences.begin(DEVICE_CONFIG_NAMESPACE, false)) {
+        return false;
+    }
+    size_t written = preferences.putBytes(DEVICE_CONFIG_KEY, &config, sizeof(config));
+    preferences.end();
+    return written == sizeof(config);
+}
@@ -0,0 +1,91 @@
+/*
+ * ESP-NOW Node Transport - implementation
+ */
+
+#include "EspNowTransport.h"
+
+#include <WiFi.h>
+#include <esp_idf_version.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+struct QueuedFrame {
+    uint8_t length;
+    uint8_t data[NODE_FRAME_SIZE];
+};
+
+static const uint8_t BROADCAST_ADDRESS[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+static QueueHandle_t receiveQueue = nullptr;
+
+volatile uint32_t EspNowTransport::droppedFrames = 0;
+
+// Runs on the WiFi task: copy and return, never block
+void EspNowTransport::deliverFrame(const uint8_t* data, int length) {
+    if (length <= 0 || length > NODE_FRAME_SIZE) return;
+    QueuedFrame frame;
+    frame.length = (uint8_t)length;
+    memcpy(frame.data, data, length);
+    if (xQueueSend(receiveQueue, &frame, 0) != pdTRUE) droppedFrames = droppedFrames + 1;
+}
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int length) {
+    (void)info;
+    EspNowTransport::deliverFrame(data, length);
+}
+#else
+static void onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+    (void)mac;
+    EspNowTransport::deliverFrame(data, length);
+}
+#endif
+
+EspNowTransport::EspNowTransport()
+    : started(false), failedSends(0) {
+}
+
+bool EspNowTransport::begin(uint8_t channel) {
+    if (started) return true;
+
+    if (WiFi.getMode() == WIFI_OFF) WiFi.mode(WIFI_STA);
+    if (channel != 0) {
+        esp_wifi_set_promiscuous(true);
+        esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+        esp_wifi_set_promiscuous(false);
+    }
+
+    if (receiveQueue == nullptr) receiveQueue = xQueueCreate(ESPNOW_RX_QUEUE_LENGTH, sizeof(QueuedFrame));
+    if (receiveQueue == nullptr || esp_now_init() != ESP_OK) return false;
+    esp_now_register_recv_cb(onReceive);
+
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, BROADCAST_ADDRESS, sizeof(BROADCAST_ADDRESS));
+    peer.channel = 0;                          // Whatever channel the interface is on
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = false;
+    if (esp_now_add_peer(&peer) != ESP_OK) {
+        esp_now_deinit();
+        return false;
+    }
+
+    started = true;
+    return true;
+}
+
+bool EspNowTransport::send(const uint8_t* frame, size_t length) {
+    if (!started) return false;
+    bool ok = esp_now_send(BROADCAST_ADDRESS, frame, length) == ESP_OK;
+    if (!ok) failedSends++;
+    return ok;
+}
+
+bool EspNowTransport::receive(uint8_t* frame, size_t& length) {
+    if (!started) return false;
+    QueuedFrame queued;
+    if (xQueueReceive(receiveQueue, &queued, 0) != pdTRUE) return false;
+    memcpy(frame, queued.data, queued.length);
+    length = queued.length;
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * Server-Sent Events Stream - implementation
+ */
+
+#include "EventStream.h"
+#include "HttpServer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <lwip/sockets.h>
+
+EventStream::EventStream()
+    : count(0), lastWrite(0), sent(0), dropped(0) {
+    for (uint8_t i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) clients[i].queued = 0;
+}
+
+bool EventStream::attach(WiFiClient client) {
+    if (count >= EVENT_STREAM_MAX_CLIENTS) {
+        HttpServer::respond(client, 503, "text/plain", "Too many event streams");
+        return false;
+    }
+
+    char head[192];
+    int length = snprintf(head, sizeof(head),
+                          "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                          "Connection: keep-alive\r\nAccess-Control-Allow-Origin: *\r\n\r\nretry: %d\n\n",
+                          EVENT_STREAM_RETRY_MS);
+    client.setNoDelay(true);
+    clients[count].connection = client;
+    clients[count].queued = 0;
+    enqueue(count, head, length);
+    count++;
+    lastWrite = millis();
+    return true;
+}
+
+bool EventStream::enqueue(uint8_t index, const char* text, size_t length) {
+    Client& client = clients[index];
+    if (client.queued + length > EVENT_STREAM_QUEUE_BYTES) return false;
+    memcpy(client.queue + client.queued, text, length);
+    client.queued += length;
+    return true;
+}
+
+/*
+ * Send what the socket takes without waiting; false when the connection failed
+ */
+bool EventStream::flush(uint8_t index) {
+    Client& client = clients[index];
+    if (!client.connection.connected()) return false;
+    if (client.queued == 0) return true;
+
+    ssize_t written = send(client.connection.fd(), client.queue, client.queued, MSG_DONTWAIT);
+    if (written < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    client.queued -= written;
+    memmove(client.queue, client.queue + written, client.queued);
+    return true;
+}
+
+// Swap the last client into the slot
+void EventStream::drop(uint8_t index) {
+    clients[index].connection.stop();
+    count--;
+    if (index != count) {
+        clients[index].connection = clients[count].connection;
+        clients[index].queued = clients[count].queued;
+        memcpy(clients[index].queue, clients[count].queue, clients[count].queued);
+    }
+    clients[count].connection = WiFiClient();
+    clients[count].queued = 0;
+    dropped++;
+}
+
+void EventStream::publish(const char* event, const char* data) {
+    if (count == 0) return;
+
+    char frame[320];
+    int length = snprintf(frame, sizeof(frame), "event: %s\ndata: %s\n\n", event, data);
+    if (length <= 0 || length >= (int)sizeof(frame)) return;
+
+    for (uint8_t i = count; i-- > 0;) {
+        if (enqueue(i, frame, length)) {
+            sent++;
+        } else {
+            drop(i);                           // Too far behind to catch up
+        }
+    }
+    lastWrite = millis();
+}
+
+void EventStream::service(unsigned long now) {
+    if (count == 0) return;
+
+    if (now - lastWrite >= EVENT_STREAM_KEEPALIVE_MS) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (clients[i].queued == 0) enqueue(i, ": keep-alive\n\n", 14);
+        }
+        lastWrite = now;
+    }
+
+    // Discard anything a client sends (the stream is one way), then send
+    for (uint8_t i = count; i-- > 0;) {
+        while (clients[i].connection.available() > 0) clients[i].connection.read();
+        if (!flush(i)) drop(i);
+    }
+}
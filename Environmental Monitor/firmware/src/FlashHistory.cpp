@@ -0,0 +1,453 @@
+/*
+ * Flash-Backed History Segments - implementation
+ */
+
+#include "FlashHistory.h"
+#include "HistoryCheckpoint.h"
+
+#include <string.h>
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FlashRegion::FlashRegion()
+    : mapped(nullptr), length(0), handle(nullptr), mapHandle(0) {
+}
+
+FlashRegion::~FlashRegion() {
+    close();
+}
+
+#ifdef ESP_PLATFORM
+
+/*
+ * Map the whole data partition through the flash cache
+ */
+bool FlashRegion::open(const char* name, size_t hostSize) {
+    (void)hostSize;
+    const esp_partition_t* partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, name);
+    if (partition == nullptr) return false;
+
+    const void* pointer = nullptr;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    esp_partition_mmap_handle_t mmapHandle;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &pointer, &mmapHandle);
+#else
+    spi_flash_mmap_handle_t mmapHandle;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &pointer, &mmapHandle);
+#endif
+    if (err != ESP_OK) return false;
+
+    handle = (void*)partition;
+    mapHandle = (uint32_t)mmapHandle;
+    mapped = static_cast<const uint8_t*>(pointer);
+    length = partition->size;
+    return true;
+}
+
+void FlashRegion::close() {
+    if (mapped) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        esp_partition_munmap((esp_partition_mmap_handle_t)mapHandle);
+#else
+        spi_flash_munmap((spi_flash_mmap_handle_t)mapHandle);
+#endif
+    }
+    mapped = nullptr;
+    length = 0;
+    handle = nullptr;
+}
+
+bool FlashRegion::eraseSector(size_t offset) {
+    const esp_partition_t* partition = static_cast<const esp_partition_t*>(handle);
+    return partition && esp_partition_erase_range(partition, offset, FLASH_SECTOR_SIZE) == ESP_OK;
+}
+
+bool FlashRegion::write(size_t offset, const void* source, size_t bytes) {
+    const esp_partition_t* partition = static_cast<const esp_partition_t*>(handle);
+    return partition && esp_partition_write(partition, offset, source, bytes) == ESP_OK;
+}
+
+#else
+
+/*
+ * Host emulation: a file of the given size, mapped read-only;
+ * writes go through pwrite() and are visible through the mapping
+ */
+bool FlashRegion::open(const char* name, size_t hostSize) {
+    int fd = ::open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // A new file starts out erased
+    if ((size_t)info.st_size < hostSize) {
+        uint8_t erased[FLASH_SECTOR_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (size_t offset = info.st_size; offset < hostSize; offset += sizeof(erased)) {
+            if (pwrite(fd, erased, sizeof(erased), offset) != (ssize_t)sizeof(erased)) {
+                ::close(fd);
+                return false;
+            }
+        }
+    } else {
+        hostSize = info.st_size;
+    }
+
+    void* pointer = mmap(nullptr, hostSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (pointer == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    handle = (void*)(intptr_t)fd;
+    mapped = static_cast<const uint8_t*>(pointer);
+    length = hostSize;
+    return true;
+}
+
+void FlashRegion::close() {
+    if (mapped) {
+        munmap((void*)mapped, length);
+        ::close((int)(intptr_t)handle);
+    }
+    mapped = nullptr;
+    length = 0;
+    handle = nullptr;
+}
+
+bool FlashRegion::eraseSector(size_t offset) {
+    uint8_t erased[FLASH_SECTOR_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    return pwrite((int)(intptr_t)handle, erased, sizeof(erased), offset) == (ssize_t)sizeof(erased);
+}
+
+bool FlashRegion::write(size_t offset, const void* source, size_t bytes) {
+    // NOR flash programming can only clear bits
+    uint8_t buffer[256];
+    const uint8_t* input = static_cast<const uint8_t*>(source);
+    while (bytes > 0) {
+        size_t chunk = (bytes < sizeof(buffer)) ? bytes : sizeof(buffer);
+        for (size_t i = 0; i < chunk; i++) {
+            buffer[i] = mapped[offset + i] & input[i];
+        }
+        if (pwrite((int)(intptr_t)handle, buffer, chunk, offset) != (ssize_t)chunk) return false;
+        offset += chunk;
+        input += chunk;
+        bytes -= chunk;
+    }
+    return true;
+}
+
+#endif
+
+void toStoredReading(const SensorReading& reading, StoredReading& stored, uint16_t nodeId) {
+    stored.sequence = reading.sequence;
+    stored.timestamp = (uint32_t)reading.timestamp;
+    stored.timestampHigh = (uint16_t)(reading.timestamp >> 32);
+    stored.temperature = reading.temperature;
+    stored.humidity = reading.humidity;
+    stored.dewPoint = reading.dewPoint;
+    stored.heatIndex = reading.heatIndex;
+    stored.absoluteHumidity = reading.absoluteHumidity;
+    stored.vaporPressureDeficit = reading.vaporPressureDeficit;
+    stored.temperatureFlags = reading.temperatureFlags;
+    stored.humidityFlags = reading.humidityFlags;
+    stored.nodeId = nodeId;
+    stored.reserved = 0xFFFF;
+    stored.crc = checkpointCrc32(&stored, offsetof(StoredReading, crc));
+}
+
+bool FlashHistory::recordValid(const StoredReading& record) {
+    return record.sequence != 0xFFFFFFFFUL &&
+           record.crc == checkpointCrc32(&record, offsetof(StoredReading, crc));
+}
+
+FlashHistory::FlashHistory()
+    : segmentCount(0), usedSegments(0), oldestSegment(0), activeSegment(0), activeRecords(0),
+      nextSegmentSequence(1), lastReading(0), lastReadingTime(0), lastReadingNode(0),
+      erasedSectors(0) {
+}
+
+const SegmentHeader* FlashHistory::header(size_t segment) const {
+    return reinterpret_cast<const SegmentHeader*>(region.data() + segment * FLASH_SEGMENT_SIZE);
+}
+
+bool FlashHistory::headerValid(size_t segment) const {
+    const SegmentHeader* h = header(segment);
+    return h->magic == FLASH_SEGMENT_MAGIC && h->version == FLASH_SEGMENT_VERSION &&
+           h->recordSize == sizeof(StoredReading) &&
+           h->crc == checkpointCrc32(h, offsetof(SegmentHeader, crc));
+}
+
+/*
+ * Number of programmed record slots in a segment (appends are sequential)
+ * A slot torn by a power loss counts as used, so it is never programmed twice.
+ */
+size_t FlashHistory::countRecords(size_t segment) const {
+    const uint8_t* slots = reinterpret_cast<const uint8_t*>(header(segment) + 1);
+    size_t count = 0;
+    while (count < FLASH_RECORDS_PER_SEGMENT) {
+        const uint8_t* slot = slots + count * sizeof(StoredReading);
+        bool erased = true;
+        for (size_t i = 0; i < sizeof(StoredReading); i++) {
+            if (slot[i] != 0xFF) {
+                erased = false;
+                break;
+            }
+        }
+        if (erased) break;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Scan segment headers to rebuild the log state
+ */
+bool FlashHistory::begin(const char* name, size_t hostSize) {
+    if (!region.open(name, hostSize)) return false;
+
+    segmentCount = region.size() / FLASH_SEGMENT_SIZE;
+    if (segmentCount > FLASH_MAX_SEGMENTS) segmentCount = FLASH_MAX_SEGMENTS;
+    if (segmentCount < 2) {
+        segmentCount = 0;
+        return false;
+    }
+
+    // Newest and oldest valid segments by segment sequence
+    bool found = false;
+    uint32_t newestSequence = 0;
+    uint32_t oldestSequence = 0;
+    usedSegments = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (!headerValid(i)) continue;
+        uint32_t sequence = header(i)->segmentSequence;
+        if (!found || sequence > newestSequence) {
+            newestSequence = sequence;
+            activeSegment = i;
+        }
+        if (!found || sequence < oldestSequence) {
+            oldestSequence = sequence;
+            oldestSegment = i;
+        }
+        found = true;
+        usedSegments++;
+    }
+
+    if (!found) {
+        // Fresh partition - start at segment 0
+        usedSegments = 0;
+        activeSegment = segmentCount - 1;
+        activeRecords = FLASH_RECORDS_PER_SEGMENT;
+        oldestSegment = 0;
+        nextSegmentSequence = 1;
+        lastReading = 0;
+        erasedSectors = 0;
+        return true;
+    }
+
+    activeRecords = countRecords(activeSegment);
+    nextSegmentSequence = newestSequence + 1;
+
+    // Newest intact record gives the last stored sequence
+    const StoredReading* records = reinterpret_cast<const StoredReading*>(header(activeSegment) + 1);
+    lastReading = header(activeSegment)->firstReading - 1;
+    for (size_t i = activeRecords; i > 0; i--) {
+        if (recordValid(records[i - 1])) {
+            lastReading = records[i - 1].sequence;
+            lastReadingTime = storedTimestamp(records[i - 1]);
+            lastReadingNode = records[i - 1].nodeId;
+            break;
+        }
+    }
+    erasedSectors = 0;
+    return true;
+}
+
+/*
+ * Erase the next segment one sector at a time once the active one is half full
+ */
+void FlashHistory::eraseAhead() {
+    const size_t sectorsPerSegment = FLASH_SEGMENT_SIZE / FLASH_SECTOR_SIZE;
+    if (erasedSectors >= sectorsPerSegment || activeRecords < FLASH_RECORDS_PER_SEGMENT / 2) return;
+
+    size_t next = (activeSegment + 1) % segmentCount;
+    if (erasedSectors == 0 && next == oldestSegment && usedSegments > 0) {
+        // The oldest segment is about to be reclaimed
+        oldestSegment = (oldestSegment + 1) % segmentCount;
+        usedSegments--;
+    }
+    region.eraseSector(next * FLASH_SEGMENT_SIZE + erasedSectors * FLASH_SECTOR_SIZE);
+    erasedSectors++;
+}
+
+bool FlashHistory::startSegment(size_t segment, uint32_t firstReading) {
+    // Finish any erase that did not complete ahead of time
+    const size_t sectorsPerSegment = FLASH_SEGMENT_SIZE / FLASH_SECTOR_SIZE;
+    if (segment == oldestSegment && usedSegments > 0 && erasedSectors == 0) {
+        oldestSegment = (oldestSegment + 1) % segmentCount;
+        usedSegments--;
+    }
+    for (size_t i = erasedSectors; i < sectorsPerSegment; i++) {
+        if (!region.eraseSector(segment * FLASH_SEGMENT_SIZE + i * FLASH_SECTOR_SIZE)) return false;
+    }
+
+    SegmentHeader h;
+    memset(&h, 0xFF, sizeof(h));
+    h.magic = FLASH_SEGMENT_MAGIC;
+    h.version = FLASH_SEGMENT_VERSION;
+    h.recordSize = sizeof(StoredReading);
+    h.segmentSequence = nextSegmentSequence++;
+    h.firstReading = firstReading;
+    h.crc = checkpointCrc32(&h, offsetof(SegmentHeader, crc));
+    if (!region.write(segment * FLASH_SEGMENT_SIZE, &h, sizeof(h))) return false;
+
+    if (usedSegments == 0) oldestSegment = segment;
+    activeSegment = segment;
+    activeRecords = 0;
+    erasedSectors = 0;
+    usedSegments++;
+    return true;
+}
+
+bool FlashHistory::append(const SensorReading& reading, uint16_t nodeId) {
+    if (segmentCount == 0) return false;
+
+    if (activeRecords >= FLASH_RECORDS_PER_SEGMENT) {
+        if (!startSegment((activeSegment + 1) % segmentCount, reading.sequence)) return false;
+    }
+
+    StoredReading stored;
+    toStoredReading(reading, stored, nodeId);
+    size_t offset = activeSegment * FLASH_SEGMENT_SIZE + sizeof(SegmentHeader) + activeRecords * sizeof(StoredReading);
+    if (!region.write(offset, &stored, sizeof(stored))) return false;
+
+    activeRecords++;
+    lastReading = reading.sequence;
+    lastReadingTime = reading.timestamp;
+    lastReadingNode = nodeId;
+    eraseAhead();
+    return true;
+}
+
+/*
+ * Record slots of the index-th oldest segment, pointing straight into mapped flash
+ * Closed segments are always full; callers skip slots failing recordValid().
+ */
+const StoredReading* FlashHistory::segmentRecords(size_t index, size_t* count) const {
+    size_t segment = (oldestSegment + index) % segmentCount;
+    if (count) {
+        *count = (segment == activeSegment) ? activeRecords : FLASH_RECORDS_PER_SEGMENT;
+    }
+    return reinterpret_cast<const StoredReading*>(header(segment) + 1);
+}
+
+/*
+ * Find the segment whose first reading is the last one < sequence (records
+ * of one sequence can run across a segment boundary), binary search its
+ * (sequence ordered) slots, then step over the slots already read
+ */
+const StoredReading* FlashHistory::locate(const FlashCursor& cursor, size_t* remaining) const {
+    uint32_t sequence = cursor.sequence;
+    *remaining = 0;
+    if (usedSegments == 0 || sequence > lastReading) return nullptr;
+
+    size_t index = 0;
+    for (size_t i = 0; i < usedSegments; i++) {
+        size_t segment = (oldestSegment + i) % segmentCount;
+        if (header(segment)->firstReading < sequence) index = i;
+    }
+
+    size_t count = 0;
+    const StoredReading* records = segmentRecords(index, &count);
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (records[mid].sequence < sequence) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    low += cursor.skip;
+    while (low >= count) {
+        // Past this segment - continue in the next one
+        if (++index >= usedSegments) return nullptr;
+        low -= count;
+        records = segmentRecords(index, &count);
+    }
+
+    *remaining = count - low;
+    return records + low;
+}
+
+/*
+ * Slots up to and including the segment's last intact record (0 if it has none);
+ * index is in age order like segmentRecords()
+ */
+size_t FlashHistory::lastValidRecord(size_t index, const StoredReading** records) const {
+    size_t count = 0;
+    *records = segmentRecords(index, &count);
+    while (count > 0 && !recordValid((*records)[count - 1])) count--;
+    return count;
+}
+
+/*
+ * Binary search the segments on the time of their last record, then the
+ * slots of the first segment that ends at or after timestamp. Readings are
+ * appended in time order, so both are sorted.
+ */
+uint32_t FlashHistory::sequenceAtTime(uint64_t timestamp) const {
+    const StoredReading* records = nullptr;
+    size_t low = 0;
+    size_t high = usedSegments;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        size_t count = lastValidRecord(mid, &records);
+        if (count > 0 && storedTimestamp(records[count - 1]) < timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == usedSegments) return 0;
+
+    size_t count = lastValidRecord(low, &records);
+    if (count == 0) return 0;                  // Only the empty active segment is left
+    size_t first = 0;
+    size_t last = count - 1;
+    while (first < last) {
+        size_t mid = (first + last) / 2;
+        if (storedTimestamp(records[mid]) < timestamp) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return records[first].sequence;
+}
+
+uint32_t FlashHistory::firstSequence() const {
+    if (usedSegments == 0) return 0;
+    return header(oldestSegment)->firstReading;
+}
+
+uint32_t FlashHistory::storedReadings() const {
+    if (usedSegments == 0) return 0;
+    return (usedSegments - 1) * FLASH_RECORDS_PER_SEGMENT + activeRecords;
+}
@@ -0,0 +1,239 @@
+/*
+ * Short-Horizon Forecasting - implementation
+ */
+
+#include "Forecaster.h"
+
+#include <math.h>
+
+const uint16_t FORECAST_HORIZON_MINUTES[FORECAST_HORIZON_COUNT] = { 5, 10, 15, 30 };
+
+#define FORECAST_Z_95 1.96f                    // Two-sided 95% normal quantile
+#define FORECAST_QUANTILE 0.95f                // Error quantile the served band covers
+#define FORECAST_QUANTILE_STEP 0.2f            // Quantile tracker step, in units of the recent MAE
+
+HoltForecaster::HoltForecaster(float levelAlpha, float trendBeta, float varianceAlpha, float trendTimeConstant)
+    : alpha(levelAlpha), beta(trendBeta), errorAlpha(varianceAlpha), trendSeconds(trendTimeConstant) {
+    reset();
+}
+
+/*
+ * Seconds of trend a damped forecast adds over the given span: the
+ * continuous form of phi + phi^2 + ... with phi = exp(-1 s / trendSeconds)
+ */
+static float dampedSeconds(float seconds, float trendSeconds) {
+    if (trendSeconds <= 0.0f) return seconds;
+    return trendSeconds * (1.0f - expf(-seconds / trendSeconds));
+}
+
+void HoltForecaster::reset() {
+    smoothedLevel = 0.0f;
+    trendPerSecond = 0.0f;
+    errorVariance = 0.0f;
+    samplePeriod = 0.0f;
+    lastTimestamp = 0;
+    sampleCount = 0;
+}
+
+float HoltForecaster::residualStdDev() const {
+    return sqrtf(errorVariance);
+}
+
+/*
+ * Damped Holt update with the trend expressed per second, so irregular
+ * sample spacing (missed DHT reads) does not distort it
+ */
+void HoltForecaster::update(float value, unsigned long timestampMs) {
+    if (sampleCount == 0) {
+        smoothedLevel = value;
+        lastTimestamp = timestampMs;
+        sampleCount = 1;
+        return;
+    }
+
+    float dt = (timestampMs - lastTimestamp) / 1000.0f;
+    if (dt <= 0.0f) return;
+
+    samplePeriod = (sampleCount == 1) ? dt : samplePeriod + 0.05f * (dt - samplePeriod);
+
+    float decay = (trendSeconds > 0.0f) ? expf(-dt / trendSeconds) : 1.0f;
+    float predicted = smoothedLevel + trendPerSecond * dampedSeconds(dt, trendSeconds);
+    float error = value - predicted;
+    if (sampleCount > 2) {
+        errorVariance += errorAlpha * (error * error - errorVariance);
+    }
+
+    float previousLevel = smoothedLevel;
+    smoothedLevel = predicted + alpha * error;
+    float dampedTrend = trendPerSecond * decay;
+    trendPerSecond = dampedTrend + beta * ((smoothedLevel - previousLevel) / dt - dampedTrend);
+
+    lastTimestamp = timestampMs;
+    if (sampleCount < 0xFFFFFFFFUL) sampleCount++;
+}
+
+/*
+ * h-step forecast; the band uses the (undamped) Holt error variance
+ * sigma^2 * (1 + sum_{j=1}^{h-1} (alpha * (1 + j * beta))^2). It is only
+ * the starting point: ForecastAccuracy replaces it with the scored error.
+ */
+ForecastPoint HoltForecaster::forecast(float horizonSeconds) const {
+    ForecastPoint point;
+    point.value = smoothedLevel + trendPerSecond * dampedSeconds(horizonSeconds, trendSeconds);
+
+    float steps = (samplePeriod > 0.0f) ? horizonSeconds / samplePeriod : 1.0f;
+    if (steps < 1.0f) steps = 1.0f;
+    float m = steps - 1.0f;
+    float growth = alpha * alpha * (m + beta * m * steps + beta * beta * m * steps * (2.0f * steps - 1.0f) / 6.0f);
+    float spread = FORECAST_Z_95 * sqrtf(errorVariance * (1.0f + growth));
+
+    point.lower = point.value - spread;
+    point.upper = point.value + spread;
+    return point;
+}
+
+ForecastAccuracy::ForecastAccuracy()
+    : head(0), count(0) {
+    for (size_t i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+        meanError[i] = 0.0f;
+        holtMeanError[i] = 0.0f;
+        persistenceMeanError[i] = 0.0f;
+        holtRecent[i] = { 0.0f, 0.0f };
+        persistenceRecent[i] = { 0.0f, 0.0f };
+        recentCoverage[i] = 0.0f;
+        withinBand[i] = 0;
+        evaluated[i] = 0;
+        expired[i] = 0;
+    }
+}
+
+/*
+ * Score every pending horizon whose target time has been reached
+ * A sample within a fifth of the horizon after the target counts (one
+ * minute at 5 min, six at 30 min); past that the horizon is dropped, so
+ * each figure measures the horizon it is labelled with
+ */
+void ForecastAccuracy::score(float actual, unsigned long timestampMs) {
+    for (size_t n = 0; n < count; n++) {
+        Snapshot& snapshot = snapshots[(head + FORECAST_SNAPSHOT_SLOTS - count + n) % FORECAST_SNAPSHOT_SLOTS];
+        unsigned long elapsed = timestampMs - snapshot.timestamp;
+
+        for (size_t i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+            if (!(snapshot.pending & (1 << i))) continue;
+            unsigned long horizonMs = FORECAST_HORIZON_MINUTES[i] * 60000UL;
+            if (elapsed < horizonMs) continue;
+
+            snapshot.pending &= (uint8_t)~(1 << i);
+            if (elapsed > horizonMs + horizonMs / 5) {
+                expired[i]++;
+                continue;
+            }
+
+            const ForecastPoint& past = snapshot.forecasts[i];
+            float holt = fabsf(actual - snapshot.holt[i]);
+            float persistence = fabsf(actual - snapshot.lastValue);
+            bool inside = actual >= past.lower && actual <= past.upper;
+            bool first = evaluated[i] == 0;
+
+            evaluated[i]++;
+            float weight = 1.0f / (float)evaluated[i];
+            meanError[i] += (fabsf(actual - past.value) - meanError[i]) * weight;
+            holtMeanError[i] += (holt - holtMeanError[i]) * weight;
+            persistenceMeanError[i] += (persistence - persistenceMeanError[i]) * weight;
+            if (inside) withinBand[i]++;
+
+            track(holtRecent[i], holt, first);
+            track(persistenceRecent[i], persistence, first);
+            recentCoverage[i] = first ? (inside ? 1.0f : 0.0f)
+                                      : recentCoverage[i] + FORECAST_RECENT_ALPHA * ((inside ? 1.0f : 0.0f) - recentCoverage[i]);
+        }
+    }
+
+    // Fully scored snapshots leave from the old end
+    while (count > 0 && snapshots[(head + FORECAST_SNAPSHOT_SLOTS - count) % FORECAST_SNAPSHOT_SLOTS].pending == 0) {
+        count--;
+    }
+}
+
+/*
+ * Smoothed MAE, and a stochastic quantile tracker: stepping up by 0.95 and
+ * down by 0.05 (times a step scaled to the error size) settles where 95%
+ * of the errors fall below it
+ */
+void ForecastAccuracy::track(ErrorTracker& tracker, float error, bool first) {
+    if (first) {
+        tracker.recent = error;
+        tracker.quantile = 2.0f * error;
+        return;
+    }
+    tracker.recent += FORECAST_RECENT_ALPHA * (error - tracker.recent);
+    float step = FORECAST_QUANTILE_STEP * tracker.recent;
+    tracker.quantile += (error > tracker.quantile) ? step * FORECAST_QUANTILE : -step * (1.0f - FORECAST_QUANTILE);
+    if (tracker.quantile < 0.0f) tracker.quantile = 0.0f;
+}
+
+ForecastSource ForecastAccuracy::source(size_t horizonIndex) const {
+    if (evaluated[horizonIndex] < FORECAST_MIN_EVALUATIONS) return FORECAST_SOURCE_HOLT;
+    return (holtRecent[horizonIndex].recent < persistenceRecent[horizonIndex].recent)
+           ? FORECAST_SOURCE_HOLT : FORECAST_SOURCE_PERSISTENCE;
+}
+
+bool ForecastAccuracy::trusted(size_t horizonIndex) const {
+    return evaluated[horizonIndex] >= FORECAST_MIN_EVALUATIONS &&
+           source(horizonIndex) == FORECAST_SOURCE_HOLT &&
+           recentCoverage[horizonIndex] >= FORECAST_MIN_COVERAGE;
+}
+
+/*
+ * Until enough forecasts are scored the Holt forecast is served with its
+ * model band; after that the better recent method, banded by its own
+ * tracked error quantile
+ */
+ForecastPoint ForecastAccuracy::serve(size_t horizonIndex, const ForecastPoint& holt, float lastValue) const {
+    if (evaluated[horizonIndex] < FORECAST_MIN_EVALUATIONS) return holt;
+
+    ForecastPoint point;
+    float spread;
+    if (source(horizonIndex) == FORECAST_SOURCE_HOLT) {
+        point.value = holt.value;
+        spread = holtRecent[horizonIndex].quantile;
+    } else {
+        point.value = lastValue;
+        spread = persistenceRecent[horizonIndex].quantile;
+    }
+    point.lower = point.value - spread;
+    point.upper = point.value + spread;
+    return point;
+}
+
+void ForecastAccuracy::addSnapshot(unsigned long timestampMs, const ForecastPoint* served, const ForecastPoint* holt,
+                                   float lastValue) {
+    // Full: the oldest snapshot's remaining horizons can no longer be scored
+    if (count == FORECAST_SNAPSHOT_SLOTS) {
+        const Snapshot& oldest = snapshots[head];
+        for (size_t i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+            if (oldest.pending & (1 << i)) expired[i]++;
+        }
+        count--;
+    }
+
+    Snapshot& snapshot = snapshots[head];
+    snapshot.timestamp = timestampMs;
+    for (size_t i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+        snapshot.forecasts[i] = served[i];
+        snapshot.holt[i] = holt[i].value;
+    }
+    snapshot.lastValue = lastValue;
+    snapshot.pending = (uint8_t)((1 << FORECAST_HORIZON_COUNT) - 1);
+    head = (head + 1) % FORECAST_SNAPSHOT_SLOTS;
+    count++;
+}
+
+float ForecastAccuracy::meanAbsoluteError(size_t horizonIndex) const {
+    return meanError[horizonIndex];
+}
+
+float ForecastAccuracy::bandCoverage(size_t horizonIndex) const {
+    if (evaluated[horizonIndex] == 0) return 0.0f;
+    return (float)withinBand[horizonIndex] / evaluated[horizonIndex];
+}
@@ -0,0 +1,103 @@
+/*
+ * Value Histograms - implementation
+ */
+
+#include "Histogram.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char* const PERIOD_NAMES[HISTOGRAM_PERIOD_COUNT] = {
+    "total", "hour", "previous_hour", "day", "previous_day"
+};
+
+const char* histogramPeriodName(uint8_t period) {
+    return (period < HISTOGRAM_PERIOD_COUNT) ? PERIOD_NAMES[period] : "";
+}
+
+bool parseHistogramPeriod(const char* text, uint8_t* period) {
+    for (uint8_t i = 0; i < HISTOGRAM_PERIOD_COUNT; i++) {
+        if (strcmp(text, PERIOD_NAMES[i]) == 0) {
+            *period = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool histogramConfigValid(const HistogramConfig& config) {
+    return config.binWidth > 0.0f && isfinite(config.minValue) &&
+           config.binCount > 0 && config.binCount <= HISTOGRAM_MAX_BINS;
+}
+
+ValueHistogram::ValueHistogram() {
+    layout.minValue = 0.0f;
+    layout.binWidth = 1.0f;
+    layout.binCount = HISTOGRAM_MAX_BINS;
+    clear();
+}
+
+void ValueHistogram::configure(const HistogramConfig& config) {
+    layout = config;
+    clear();
+}
+
+void ValueHistogram::clear() {
+    memset(bins, 0, sizeof(bins));
+    below = 0;
+    above = 0;
+    total = 0;
+}
+
+void ValueHistogram::add(float value) {
+    total++;
+    float position = (value - layout.minValue) / layout.binWidth;
+    if (!(position >= 0.0f)) {          // Also catches NaN
+        below++;
+    } else if (position >= layout.binCount) {
+        above++;
+    } else {
+        bins[(size_t)position]++;
+    }
+}
+
+SeriesHistograms::SeriesHistograms()
+    : currentHour(0), currentDay(0) {
+}
+
+void SeriesHistograms::configure(const HistogramConfig& config) {
+    for (uint8_t i = 0; i < HISTOGRAM_PERIOD_COUNT; i++) {
+        periods[i].configure(config);
+    }
+    currentHour = 0;
+    currentDay = 0;
+}
+
+/*
+ * Roll the hour/day periods over when the wall clock crosses a boundary
+ */
+void SeriesHistograms::add(float value, uint32_t epochSeconds) {
+    uint32_t hour = epochSeconds / 3600;
+    uint32_t day = epochSeconds / 86400;
+
+    if (hour != currentHour) {
+        periods[HISTOGRAM_PERIOD_PREVIOUS_HOUR] = periods[HISTOGRAM_PERIOD_HOUR];
+        if (currentHour != 0 && hour != currentHour + 1) {
+            periods[HISTOGRAM_PERIOD_PREVIOUS_HOUR].clear();   // Gap - previous hour was not observed
+        }
+        periods[HISTOGRAM_PERIOD_HOUR].clear();
+        currentHour = hour;
+    }
+    if (day != currentDay) {
+        periods[HISTOGRAM_PERIOD_PREVIOUS_DAY] = periods[HISTOGRAM_PERIOD_DAY];
+        if (currentDay != 0 && day != currentDay + 1) {
+            periods[HISTOGRAM_PERIOD_PREVIOUS_DAY].clear();
+        }
+        periods[HISTOGRAM_PERIOD_DAY].clear();
+        currentDay = day;
+    }
+
+    periods[HISTOGRAM_PERIOD_TOTAL].add(value);
+    periods[HISTOGRAM_PERIOD_HOUR].add(value);
+    periods[HISTOGRAM_PERIOD_DAY].add(value);
+}
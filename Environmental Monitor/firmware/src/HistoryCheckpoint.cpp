@@ -0,0 +1,108 @@
+/*
+ * Warm-Reboot History Checkpoint - implementation
+ */
+
+#include "HistoryCheckpoint.h"
+
+#include <stddef.h>
+
+/*
+ * Nibble-table CRC-32 - small table, fast enough for a header and a record
+ */
+uint32_t checkpointCrc32(const void* data, size_t length, uint32_t crc) {
+    static const uint32_t TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = TABLE[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = TABLE[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+uint16_t readingChecksum(const SensorReading& reading) {
+    uint32_t crc = 0;
+    crc = checkpointCrc32(&reading.sequence, sizeof(reading.sequence), crc);
+    crc = checkpointCrc32(&reading.temperature, sizeof(reading.temperature), crc);
+    crc = checkpointCrc32(&reading.humidity, sizeof(reading.humidity), crc);
+    crc = checkpointCrc32(&reading.timestamp, sizeof(reading.timestamp), crc);
+    crc = checkpointCrc32(&reading.isValid, sizeof(reading.isValid), crc);
+    crc = checkpointCrc32(&reading.temperatureFlags, sizeof(reading.temperatureFlags), crc);
+    crc = checkpointCrc32(&reading.humidityFlags, sizeof(reading.humidityFlags), crc);
+    crc = checkpointCrc32(&reading.dewPoint, sizeof(reading.dewPoint), crc);
+    crc = checkpointCrc32(&reading.heatIndex, sizeof(reading.heatIndex), crc);
+    crc = checkpointCrc32(&reading.absoluteHumidity, sizeof(reading.absoluteHumidity), crc);
+    crc = checkpointCrc32(&reading.vaporPressureDeficit, sizeof(reading.vaporPressureDeficit), crc);
+    return (uint16_t)(crc ^ (crc >> 16));
+}
+
+void sealReading(SensorReading& reading) {
+    reading.checksum = readingChecksum(reading);
+}
+
+void updateCheckpoint(HistoryCheckpoint& checkpoint, uint16_t capacity, uint16_t historySize,
+                      uint32_t head, int readingCount, uint64_t lastTimestamp, uint32_t lastEpochSeconds) {
+    checkpoint.magic = HISTORY_CHECKPOINT_MAGIC;
+    checkpoint.version = HISTORY_CHECKPOINT_VERSION;
+    checkpoint.recordSize = sizeof(SensorReading);
+    checkpoint.capacity = capacity;
+    checkpoint.historySize = historySize;
+    checkpoint.head = head;
+    checkpoint.readingCount = readingCount;
+    checkpoint.lastTimestamp = lastTimestamp;
+    checkpoint.lastEpochSeconds = lastEpochSeconds;
+    checkpoint.crc = checkpointCrc32(&checkpoint, offsetof(HistoryCheckpoint, crc));
+}
+
+void invalidateCheckpoint(HistoryCheckpoint& checkpoint) {
+    checkpoint.magic = 0;
+    checkpoint.crc = 0;
+}
+
+HistoryRecovery recoverHistory(const HistoryCheckpoint& checkpoint, SensorReading* readings, uint16_t capacity) {
+    HistoryRecovery result = {};
+
+    // Header checks: identity, layout and CRC
+    if (checkpoint.magic != HISTORY_CHECKPOINT_MAGIC ||
+        checkpoint.version != HISTORY_CHECKPOINT_VERSION ||
+        checkpoint.recordSize != sizeof(SensorReading) ||
+        checkpoint.capacity != capacity || (capacity & (capacity - 1)) != 0 ||
+        checkpoint.crc != checkpointCrc32(&checkpoint, offsetof(HistoryCheckpoint, crc))) {
+        return result;
+    }
+    int size = checkpoint.historySize;
+    if (size <= 0 || size > capacity ||
+        checkpoint.readingCount < 0 || checkpoint.readingCount > size) {
+        return result;
+    }
+    uint32_t mask = capacity - 1;
+
+    // Walk back from the newest reading while records are intact and time-ordered
+    int kept = 0;
+    uint64_t newerTimestamp = checkpoint.lastTimestamp;
+    for (int i = 0; i < checkpoint.readingCount; i++) {
+        const SensorReading& reading = readings[(checkpoint.head - 1 - i) & mask];
+        if (!reading.isValid || reading.checksum != readingChecksum(reading) ||
+            reading.timestamp > newerTimestamp) {
+            break;
+        }
+        newerTimestamp = reading.timestamp;
+        kept++;
+    }
+
+    // Everything older than the intact run is discarded
+    for (int i = kept; i < capacity; i++) {
+        readings[(checkpoint.head - 1 - i) & mask].isValid = false;
+    }
+
+    result.recovered = kept > 0;
+    result.head = checkpoint.head;
+    result.readingCount = kept;
+    result.historySize = checkpoint.historySize;
+    result.lastTimestamp = checkpoint.lastTimestamp;
+    result.lastEpochSeconds = checkpoint.lastEpochSeconds;
+    return result;
+}
@@ -0,0 +1,269 @@
+/*
+ * Allocation-Free HTTP Request Parsing - implementation
+ */
+
+#include "HttpRequest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+bool TextView::equals(const char* text) const {
+    return strlen(text) == length && memcmp(data, text, length) == 0;
+}
+
+bool TextView::equalsIgnoreCase(const char* text) const {
+    for (uint16_t i = 0; i < length; i++) {
+        if (text[i] == '\0' || lowerAscii(data[i]) != lowerAscii(text[i])) return false;
+    }
+    return text[length] == '\0';
+}
+
+const TextView* HttpRequest::header(const char* name) const {
+    for (uint8_t i = 0; i < headerCount; i++) {
+        if (headers[i].name.equalsIgnoreCase(name)) return &headers[i].value;
+    }
+    return nullptr;
+}
+
+/*
+ * Next line starting at pos, without its CR/LF
+ * Returns false if the line is not complete yet.
+ */
+static bool nextLine(const char* buffer, size_t length, size_t& pos, TextView& line) {
+    const char* newline = (const char*)memchr(buffer + pos, '\n', length - pos);
+    if (newline == nullptr) return false;
+
+    size_t end = newline - buffer;
+    size_t lineEnd = (end > pos && buffer[end - 1] == '\r') ? end - 1 : end;
+    line.data = buffer + pos;
+    line.length = (uint16_t)(lineEnd - pos);
+    pos = end + 1;
+    return true;
+}
+
+/*
+ * Unsigned decimal of digits only, at most max; strtoul would also take a
+ * sign, leading spaces or a 0x prefix, and wraps instead of failing
+ */
+static bool parseDecimal(const char* text, size_t length, uint64_t max, uint64_t* value) {
+    if (length == 0) return false;
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        uint64_t digit = (uint64_t)(text[i] - '0');
+        if (result > (max - digit) / 10) return false;
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return true;
+}
+
+static TextView trim(TextView text) {
+    while (text.length > 0 && (text.data[0] == ' ' || text.data[0] == '\t')) {
+        text.data++;
+        text.length--;
+    }
+    while (text.length > 0 && (text.data[text.length - 1] == ' ' || text.data[text.length - 1] == '\t')) {
+        text.length--;
+    }
+    return text;
+}
+
+/*
+ * Request line, headers, then wait for the whole body
+ */
+HttpParseStatus parseHttpRequest(char* buffer, size_t length, HttpRequest& request) {
+    request.verb = HTTP_VERB_UNKNOWN;
+    request.path = { buffer, 0 };
+    request.query = nullptr;
+    request.queryLength = 0;
+    request.headerCount = 0;
+    request.body = nullptr;
+    request.contentLength = 0;
+    request.bodyReceived = 0;
+    request.headerBytes = 0;
+    request.totalBytes = 0;
+    request.minorVersion = 0;
+    request.keepAlive = false;
+
+    size_t pos = 0;
+    TextView line;
+    if (!nextLine(buffer, length, pos, line)) return HTTP_PARSE_INCOMPLETE;
+
+    // METHOD SP target SP HTTP/1.x
+    const char* lineEnd = line.data + line.length;
+    const char* methodEnd = (const char*)memchr(line.data, ' ', line.length);
+    if (methodEnd == nullptr) return HTTP_PARSE_BAD_REQUEST;
+    const char* target = methodEnd + 1;
+    const char* targetEnd = (const char*)memchr(target, ' ', lineEnd - target);
+    if (targetEnd == nullptr || targetEnd == target || *target != '/') return HTTP_PARSE_BAD_REQUEST;
+
+    TextView method = { line.data, (uint16_t)(methodEnd - line.data) };
+    if (method.equals("GET")) {
+        request.verb = HTTP_VERB_GET;
+    } else if (method.equals("POST")) {
+        request.verb = HTTP_VERB_POST;
+    }
+
+    TextView version = { targetEnd + 1, (uint16_t)(lineEnd - targetEnd - 1) };
+    if (version.equals("HTTP/1.1")) {
+        request.minorVersion = 1;
+        request.keepAlive = true;
+    } else if (!version.equals("HTTP/1.0")) {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+
+    const char* question = (const char*)memchr(target, '?', targetEnd - target);
+    const char* pathEnd = (question != nullptr) ? question : targetEnd;
+    request.path = { target, (uint16_t)(pathEnd - target) };
+    if (question != nullptr) {
+        request.query = (char*)question + 1;
+        request.queryLength = (uint16_t)(targetEnd - question - 1);
+    }
+
+    // Headers up to the blank line
+    while (true) {
+        if (!nextLine(buffer, length, pos, line)) return HTTP_PARSE_INCOMPLETE;
+        if (line.length == 0) break;
+
+        const char* colon = (const char*)memchr(line.data, ':', line.length);
+        if (colon == nullptr) return HTTP_PARSE_BAD_REQUEST;
+        TextView name = { line.data, (uint16_t)(colon - line.data) };
+        TextView value = trim({ colon + 1, (uint16_t)(line.data + line.length - colon - 1) });
+
+        if (name.equalsIgnoreCase("Content-Length")) {
+            uint64_t declared = 0;
+            if (!parseDecimal(value.data, value.length, SIZE_MAX, &declared)) return HTTP_PARSE_BAD_REQUEST;
+            request.contentLength = (size_t)declared;
+        } else if (name.equalsIgnoreCase("Connection")) {
+            if (value.equalsIgnoreCase("close")) request.keepAlive = false;
+            else if (value.equalsIgnoreCase("keep-alive")) request.keepAlive = true;
+        }
+
+        if (request.headerCount < HTTP_MAX_HEADERS) {
+            request.headers[request.headerCount].name = name;
+            request.headers[request.headerCount].value = value;
+            request.headerCount++;
+        }
+    }
+
+    request.headerBytes = pos;
+    request.body = buffer + pos;
+    if (length - pos < request.contentLength) {
+        request.bodyReceived = length - pos;
+        return HTTP_PARSE_INCOMPLETE;
+    }
+    request.bodyReceived = request.contentLength;
+    request.totalBytes = pos + request.contentLength;
+    return HTTP_PARSE_OK;
+}
+
+RequestArgs::RequestArgs()
+    : present(0), bodyData(nullptr), bodySize(0), declaredLength(0) {
+}
+
+uint32_t RequestArgs::u32(uint8_t index, uint32_t fallback) const {
+    return has(index) ? values[index].u : fallback;
+}
+
+uint64_t RequestArgs::u64(uint8_t index, uint64_t fallback) const {
+    return has(index) ? values[index].u64 : fallback;
+}
+
+float RequestArgs::f32(uint8_t index, float fallback) const {
+    return has(index) ? values[index].f : fallback;
+}
+
+const char* RequestArgs::text(uint8_t index, const char* fallback) const {
+    return has(index) ? values[index].text : fallback;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = lowerAscii(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/*
+ * Percent-decode in place and NUL-terminate, returns the decoded length
+ */
+static size_t decodeInPlace(char* text, size_t length) {
+    size_t out = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && i + 2 < length) {
+            int high = hexDigit(text[i + 1]);
+            int low = hexDigit(text[i + 2]);
+            if (high >= 0 && low >= 0) {
+                c = (char)((high << 4) | low);
+                i += 2;
+            }
+        }
+        text[out++] = c;
+    }
+    text[out] = '\0';
+    return out;
+}
+
+/*
+ * Split the query on '&' and '=', decode each pair in place and convert
+ * the values named by the schema. The byte after each pair (the '&' or
+ * the space before HTTP/1.x) becomes its terminator.
+ */
+const char* bindRequestArgs(HttpRequest& request, const ParamSpec* params,
+                            uint8_t paramCount, RequestArgs& args) {
+    args.present = 0;
+    args.bodyData = request.body;
+    args.bodySize = request.bodyReceived;
+    args.declaredLength = request.contentLength;
+    if (request.query == nullptr || paramCount == 0) return nullptr;
+
+    char* cursor = request.query;
+    char* end = request.query + request.queryLength;
+    while (cursor < end) {
+        char* pairEnd = (char*)memchr(cursor, '&', end - cursor);
+        if (pairEnd == nullptr) pairEnd = end;
+
+        char* equals = (char*)memchr(cursor, '=', pairEnd - cursor);
+        char* value = (equals != nullptr) ? equals + 1 : pairEnd;
+        size_t nameLength = decodeInPlace(cursor, ((equals != nullptr) ? equals : pairEnd) - cursor);
+        size_t valueLength = (equals != nullptr) ? decodeInPlace(value, pairEnd - value) : 0;
+        if (equals == nullptr) value = cursor + nameLength;   // Points at the name's terminator
+
+        for (uint8_t i = 0; i < paramCount && i < HTTP_MAX_PARAMS; i++) {
+            if (strcmp(params[i].name, cursor) != 0) continue;
+
+            RequestArgs::Value& slot = args.values[i];
+            char* parsedEnd = nullptr;
+            uint64_t number = 0;
+            switch (params[i].type) {
+                case PARAM_UINT:
+                    if (!parseDecimal(value, valueLength, UINT32_MAX, &number)) return params[i].name;
+                    slot.u = (uint32_t)number;
+                    break;
+                case PARAM_UINT64:
+                    if (!parseDecimal(value, valueLength, UINT64_MAX, &slot.u64)) return params[i].name;
+                    break;
+                case PARAM_FLOAT:
+                    if (valueLength == 0) return params[i].name;
+                    slot.f = strtof(value, &parsedEnd);
+                    if (parsedEnd != value + valueLength) return params[i].name;
+                    break;
+                case PARAM_TEXT:
+                    slot.text = value;
+                    break;
+            }
+            args.present |= (uint16_t)(1u << i);
+            break;
+        }
+        cursor = pairEnd + 1;
+    }
+    return nullptr;
+}
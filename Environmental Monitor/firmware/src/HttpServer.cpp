@@ -0,0 +1,311 @@
+/*
+ * Minimal HTTP/1.1 Server - implementation
+ */
+
+#include "HttpServer.h"
+
+#include <esp_timer.h>
+
+static const char* statusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+HttpServer::HttpServer(uint16_t port)
+    : listener(port), routeTable(nullptr), findRoute(nullptr), pathKnown(nullptr),
+      admission(nullptr), sampleSlack(nullptr), stallMonitor(nullptr), stallTask(STALL_TASK_LOOP),
+      powerManager(nullptr), received(0), lastActivity(0), requestStarted(0), connectionRequests(0),
+      extraHeadersLength(0), contentLength(0), lengthSet(false), headSent(false), chunked(false),
+      http11(false), keepAlive(false), detached(false), counters() {
+}
+
+void HttpServer::closeConnection() {
+    connection.stop();
+    received = 0;
+    connectionRequests = 0;
+}
+
+// Forget a connection a handler detached (the handler now owns the socket)
+void HttpServer::releaseConnection() {
+    connection = WiFiClient();
+    received = 0;
+    connectionRequests = 0;
+}
+
+/*
+ * Read what has arrived without blocking and serve one complete request
+ */
+void HttpServer::handleClient() {
+    if (routeTable == nullptr) return;
+
+    // An idle persistent connection gives way to a waiting client
+    bool idle = !connection || !connection.connected() || received == 0;
+    if (idle && listener.hasClient()) {
+        if (connection) closeConnection();
+        connection = listener.available();
+        connection.setNoDelay(true);
+        received = 0;
+        connectionRequests = 0;
+        lastActivity = millis();
+    }
+    if (!connection) return;
+
+    int available = connection.available();
+    if (available > 0) {
+        size_t room = HTTP_RX_BUFFER_SIZE - 1 - received;
+        size_t wanted = ((size_t)available < room) ? (size_t)available : room;
+        int count = connection.read((uint8_t*)rxBuffer + received, wanted);
+        if (count > 0) {
+            // Trickled bytes keep the connection alive, not the request
+            if (received == 0) requestStarted = millis();
+            received += count;
+            lastActivity = millis();
+        }
+    } else if (!connection.connected()) {
+        closeConnection();
+        return;
+    }
+
+    if (received == 0) {
+        if (millis() - lastActivity > HTTP_KEEP_ALIVE_TIMEOUT_MS) closeConnection();
+        return;
+    }
+
+    HttpRequest request;
+    HttpParseStatus status = parseHttpRequest(rxBuffer, received, request);
+    if (status == HTTP_PARSE_INCOMPLETE && request.headerBytes > 0) {
+        // Uploads are handed over as soon as the headers are complete
+        const RouteSpec* route = findRoute(routeTable, request.verb, request.path.data, request.path.length);
+        if (route != nullptr && route->streamsBody) {
+            if (!dispatch(request)) return;   // Deferred, headers stay buffered
+            if (detached) {
+                releaseConnection();
+            } else {
+                closeConnection();
+            }
+            return;
+        }
+    }
+    if (status == HTTP_PARSE_INCOMPLETE) {
+        if (received >= HTTP_RX_BUFFER_SIZE - 1) {
+            counters.badRequests++;
+            keepAlive = false;
+            sendError(413, "Request too large");
+            closeConnection();
+        } else if (millis() - requestStarted > HTTP_REQUEST_TIMEOUT_MS) {
+            keepAlive = false;
+            sendError(408, "Request timeout");
+            closeConnection();
+        }
+        return;
+    }
+    if (status == HTTP_PARSE_BAD_REQUEST) {
+        counters.badRequests++;
+        keepAlive = false;
+        sendError(400, "Malformed request");
+        closeConnection();
+        return;
+    }
+
+    if (!dispatch(request)) return;           // Deferred until after the sampler
+    if (detached) {
+        releaseConnection();
+        return;
+    }
+
+    // Keep any pipelined bytes for the next call
+    if (!keepAlive || !connection.connected()) {
+        closeConnection();
+        return;
+    }
+    size_t used = request.totalBytes;
+    memmove(rxBuffer, rxBuffer + used, received - used);
+    received -= used;
+    requestStarted = millis();
+}
+
+/*
+ * Admit, route, bind typed arguments and run the handler
+ * Returns false when admission control deferred the request.
+ */
+bool HttpServer::dispatch(HttpRequest& request) {
+    const RouteSpec* route = findRoute(routeTable, request.verb, request.path.data, request.path.length);
+    AdmissionDecision decision = { ADMISSION_ADMIT, SHED_GLOBAL_BUDGET, 0 };
+    if (route != nullptr && admission != nullptr) {
+        uint32_t slack = (sampleSlack != nullptr) ? sampleSlack() : UINT32_MAX;
+        decision = admission->admit(route->priority, route->cost, (uint32_t)connection.remoteIP(), millis(), slack);
+        if (decision.verdict == ADMISSION_DEFER) return false;
+    }
+
+    counters.requests++;
+    if (connectionRequests++ > 0) counters.keepAliveReuses++;
+
+    extraHeadersLength = 0;
+    lengthSet = false;
+    headSent = false;
+    chunked = false;
+    http11 = request.minorVersion >= 1;
+    keepAlive = request.keepAlive;
+    detached = false;
+
+    if (route == nullptr) {
+        if (pathKnown(routeTable, request.path.data, request.path.length)) {
+            sendError(405, "Method not allowed");
+        } else {
+            counters.notFound++;
+            sendError(404, "Endpoint not found");
+        }
+        return true;
+    }
+    if (decision.verdict == ADMISSION_SHED) {
+        counters.shed++;
+        sendHeader("Retry-After", String(decision.retryAfterSeconds));
+        send(503, "text/plain", decision.reason == SHED_CLIENT_BUDGET ? "Client over budget" : "Server busy");
+        return true;
+    }
+
+    RequestArgs args;
+    const char* invalid = bindRequestArgs(request, route->params, route->paramCount, args);
+    if (invalid != nullptr) {
+        counters.badRequests++;
+        char message[64];
+        snprintf(message, sizeof(message), "Invalid parameter: %s", invalid);
+        sendError(400, message);
+        return true;
+    }
+
+    if (stallMonitor != nullptr) stallMonitor->beginRequest(stallTask, route->path, (uint32_t)connection.remoteIP());
+    if (powerManager != nullptr) powerManager->acquire(esp_timer_get_time());
+    unsigned long started = micros();
+    route->handler(args);
+    unsigned long elapsed = micros() - started;
+    if (admission != nullptr) admission->complete(route->cost, elapsed);
+    if (powerManager != nullptr) {
+        powerManager->recordRequest(elapsed);
+        powerManager->release(esp_timer_get_time());
+    }
+    if (stallMonitor != nullptr) stallMonitor->endRequest(stallTask);
+
+    if (detached) {
+        return true;
+    } else if (!headSent) {
+        sendError(500, "No response");
+    } else if (chunked) {
+        sendContent("", 0);   // Terminate a stream the handler left open
+    }
+    return true;
+}
+
+WiFiClient HttpServer::detach() {
+    detached = true;
+    return connection;
+}
+
+void HttpServer::respond(WiFiClient& client, int code, const char* contentType, const char* body) {
+    char head[160];
+    size_t length = strlen(body);
+    int headLength = snprintf(head, sizeof(head),
+                              "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                              code, statusText(code), contentType, (unsigned)length);
+    client.write((const uint8_t*)head, headLength);
+    client.write((const uint8_t*)body, length);
+    client.stop();
+}
+
+void HttpServer::sendError(int code, const char* message) {
+    extraHeadersLength = 0;
+    lengthSet = false;
+    headSent = false;
+    chunked = false;
+    send(code, "text/plain", message, strlen(message));
+}
+
+void HttpServer::sendHeader(const char* name, const String& value) {
+    int written = snprintf(extraHeaders + extraHeadersLength, sizeof(extraHeaders) - extraHeadersLength,
+                           "%s: %s\r\n", name, value.c_str());
+    if (written > 0 && extraHeadersLength + written < sizeof(extraHeaders)) {
+        extraHeadersLength += written;
+    }
+}
+
+void HttpServer::setContentLength(size_t length) {
+    contentLength = length;
+    lengthSet = true;
+}
+
+/*
+ * Status line and headers; length HTTP_CONTENT_LENGTH_UNKNOWN starts a
+ * chunked body, or for HTTP/1.0 clients a body delimited by closing
+ */
+void HttpServer::writeHead(int code, const char* contentType, size_t length) {
+    char head[256];
+    int headLength = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n",
+                              code, statusText(code), contentType);
+
+    if (length == HTTP_CONTENT_LENGTH_UNKNOWN) {
+        chunked = http11;
+        if (!chunked) keepAlive = false;
+        if (chunked) {
+            headLength += snprintf(head + headLength, sizeof(head) - headLength,
+                                   "Transfer-Encoding: chunked\r\n");
+        }
+    } else {
+        headLength += snprintf(head + headLength, sizeof(head) - headLength,
+                               "Content-Length: %u\r\n", (unsigned)length);
+    }
+    headLength += snprintf(head + headLength, sizeof(head) - headLength, "Connection: %s\r\n",
+                           keepAlive ? "keep-alive" : "close");
+
+    connection.write((const uint8_t*)head, headLength);
+    if (extraHeadersLength > 0) {
+        connection.write((const uint8_t*)extraHeaders, extraHeadersLength);
+    }
+    connection.write((const uint8_t*)"\r\n", 2);
+    headSent = true;
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body, size_t length) {
+    if (headSent) return;
+    size_t declared = lengthSet ? contentLength : length;
+    writeHead(code, contentType, declared);
+    if (length > 0) sendContent(body, length);
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body) {
+    send(code, contentType, body, strlen(body));
+}
+
+void HttpServer::send(int code, const char* contentType, const String& body) {
+    send(code, contentType, body.c_str(), body.length());
+}
+
+/*
+ * Body bytes, framed as one chunk when streaming; empty data ends the stream
+ */
+void HttpServer::sendContent(const char* data, size_t length) {
+    if (!chunked) {
+        if (length > 0) connection.write((const uint8_t*)data, length);
+        return;
+    }
+    char frame[12];
+    int frameLength = snprintf(frame, sizeof(frame), "%X\r\n", (unsigned)length);
+    connection.write((const uint8_t*)frame, frameLength);
+    if (length > 0) connection.write((const uint8_t*)data, length);
+    connection.write((const uint8_t*)"\r\n", 2);
+    if (length == 0) chunked = false;
+}
+
+void HttpServer::sendContent(const String& text) {
+    sendContent(text.c_str(), text.length());
+}
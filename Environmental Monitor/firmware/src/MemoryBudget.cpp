@@ -0,0 +1,166 @@
+/*
+ * Per-Subsystem Memory Budget - implementation
+ */
+
+#include "MemoryBudget.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = {
+    "history", "http", "json", "logging", "network"
+};
+
+// In front of every pooled block; the size keeps the payload aligned as malloc's
+union BlockHeader {
+    struct {
+        uint32_t size;
+        uint8_t subsystem;
+    } info;
+    max_align_t alignment;
+};
+
+MemoryBudget::MemoryBudget()
+    : heapFloor(0), freeHeap(nullptr), largestBlock(nullptr) {
+    memset(accounts, 0, sizeof(accounts));
+    busy.clear();
+}
+
+const char* MemoryBudget::subsystemName(uint8_t subsystem) {
+    return (subsystem < MEMORY_SUBSYSTEM_COUNT) ? SUBSYSTEM_NAMES[subsystem] : "unknown";
+}
+
+// Held for a few counter updates only
+void MemoryBudget::lock() const {
+    while (busy.test_and_set(std::memory_order_acquire)) {
+    }
+}
+
+void MemoryBudget::unlock() const {
+    busy.clear(std::memory_order_release);
+}
+
+void MemoryBudget::setBudget(MemorySubsystem subsystem, uint32_t bytes) {
+    lock();
+    accounts[subsystem].budget = bytes;
+    unlock();
+}
+
+void MemoryBudget::reserve(MemorySubsystem subsystem, uint32_t bytes) {
+    lock();
+    accounts[subsystem].reserved += bytes;
+    unlock();
+}
+
+void MemoryBudget::setHeapFloor(uint32_t floorBytes, HeapProbe freeHeapProbe, HeapProbe largestBlockProbe) {
+    heapFloor = floorBytes;
+    freeHeap = freeHeapProbe;
+    largestBlock = largestBlockProbe;
+}
+
+bool MemoryBudget::charge(MemorySubsystem subsystem, uint32_t bytes) {
+    bool heapOk = freeHeap == nullptr || freeHeap() >= (size_t)bytes + heapFloor;
+
+    lock();
+    MemoryAccount& account = accounts[subsystem];
+    bool accepted = heapOk && account.inUse <= account.budget && bytes <= account.budget - account.inUse;
+    if (accepted) {
+        account.inUse += bytes;
+        account.allocations++;
+        if (account.inUse > account.highWater) account.highWater = account.inUse;
+    } else {
+        account.refused++;
+    }
+    unlock();
+    return accepted;
+}
+
+void MemoryBudget::refund(MemorySubsystem subsystem, uint32_t bytes) {
+    lock();
+    MemoryAccount& account = accounts[subsystem];
+    account.inUse = (bytes < account.inUse) ? account.inUse - bytes : 0;
+    unlock();
+}
+
+void* MemoryBudget::allocate(MemorySubsystem subsystem, size_t size) {
+    if (subsystem >= MEMORY_SUBSYSTEM_COUNT || size == 0 || size > UINT32_MAX - sizeof(BlockHeader)) return nullptr;
+    uint32_t bytes = (uint32_t)(size + sizeof(BlockHeader));
+    if (!charge(subsystem, bytes)) return nullptr;
+
+    BlockHeader* header = (BlockHeader*)malloc(bytes);
+    if (header == nullptr) {
+        // Within budget but the heap could not provide it (fragmentation)
+        lock();
+        MemoryAccount& account = accounts[subsystem];
+        account.inUse -= bytes;
+        account.allocations--;
+        account.refused++;
+        unlock();
+        return nullptr;
+    }
+    header->info.size = bytes;
+    header->info.subsystem = subsystem;
+    return header + 1;
+}
+
+void* MemoryBudget::reallocate(void* block, size_t size) {
+    if (block == nullptr || size == 0 || size > UINT32_MAX - sizeof(BlockHeader)) return nullptr;
+    BlockHeader* header = (BlockHeader*)block - 1;
+    MemorySubsystem subsystem = (MemorySubsystem)header->info.subsystem;
+    uint32_t before = header->info.size;
+    uint32_t after = (uint32_t)(size + sizeof(BlockHeader));
+
+    // Growth is charged first, shrinking refunded once it has happened
+    if (after > before && !charge(subsystem, after - before)) return nullptr;
+    BlockHeader* moved = (BlockHeader*)realloc(header, after);
+    if (moved == nullptr) {
+        if (after > before) refund(subsystem, after - before);
+        return nullptr;
+    }
+    if (after < before) refund(subsystem, before - after);
+    moved->info.size = after;
+    return moved + 1;
+}
+
+void MemoryBudget::release(void* block) {
+    if (block == nullptr) return;
+    BlockHeader* header = (BlockHeader*)block - 1;
+    refund((MemorySubsystem)header->info.subsystem, header->info.size);
+    free(header);
+}
+
+uint32_t MemoryBudget::available(MemorySubsystem subsystem) const {
+    lock();
+    const MemoryAccount& account = accounts[subsystem];
+    uint32_t room = (account.inUse < account.budget) ? account.budget - account.inUse : 0;
+    unlock();
+
+    if (freeHeap != nullptr) {
+        size_t heap = freeHeap();
+        uint32_t heapRoom = (heap > heapFloor) ? (uint32_t)(heap - heapFloor) : 0;
+        if (heapRoom < room) room = heapRoom;
+    }
+    if (largestBlock != nullptr) {
+        size_t largest = largestBlock();
+        if (largest < room) room = (uint32_t)largest;
+    }
+    return (room > sizeof(BlockHeader)) ? room - (uint32_t)sizeof(BlockHeader) : 0;
+}
+
+void MemoryBudget::noteDegraded(MemorySubsystem subsystem) {
+    lock();
+    accounts[subsystem].degraded++;
+    unlock();
+}
+
+uint32_t MemoryBudget::totalReserved() const {
+    uint32_t total = 0;
+    for (uint8_t subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; subsystem++) total += accounts[subsystem].reserved;
+    return total;
+}
+
+uint32_t MemoryBudget::totalInUse() const {
+    uint32_t total = 0;
+    for (uint8_t subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; subsystem++) total += accounts[subsystem].inUse;
+    return total;
+}
@@ -0,0 +1,256 @@
+/*
+ * Sensor Node Link - implementation
+ */
+
+#include "NodeLink.h"
+#include "HistoryCheckpoint.h"
+
+#include <math.h>
+#include <string.h>
+
+#define NODE_EXPIRY_CHECK_MS 10000
+
+static void putLE16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putLE32(uint8_t* out, uint32_t value) {
+    putLE16(out, (uint16_t)value);
+    putLE16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t getLE16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getLE32(const uint8_t* in) {
+    return (uint32_t)getLE16(in) | ((uint32_t)getLE16(in + 2) << 16);
+}
+
+// Fixed-point x100 with saturation (DHT resolution is 0.1)
+static int16_t toCenti(float value) {
+    float scaled = roundf(value * 100.0f);
+    if (scaled > 32767.0f) return 32767;
+    if (scaled < -32768.0f) return -32768;
+    return (int16_t)scaled;
+}
+
+size_t encodeNodeFrame(const NodeReading& reading, uint16_t ageMs, uint8_t* frame) {
+    frame[0] = NODE_FRAME_MAGIC;
+    frame[1] = reading.session;
+    putLE16(frame + 2, reading.nodeId);
+    putLE32(frame + 4, reading.sequence);
+    putLE16(frame + 8, ageMs);
+    putLE16(frame + 10, (uint16_t)toCenti(reading.temperature));
+    putLE16(frame + 12, (uint16_t)toCenti(reading.humidity));
+    frame[14] = reading.temperatureFlags;
+    frame[15] = reading.humidityFlags;
+    putLE32(frame + 16, checkpointCrc32(frame, 16));
+    return NODE_FRAME_SIZE;
+}
+
+bool decodeNodeFrame(const uint8_t* frame, size_t length, uint64_t receivedAt, NodeReading& reading) {
+    if (length != NODE_FRAME_SIZE || frame[0] != NODE_FRAME_MAGIC) return false;
+    if (getLE32(frame + 16) != checkpointCrc32(frame, 16)) return false;
+
+    reading.session = frame[1];
+    reading.nodeId = getLE16(frame + 2);
+    reading.sequence = getLE32(frame + 4);
+    uint16_t ageMs = getLE16(frame + 8);
+    reading.timestamp = (receivedAt > ageMs) ? receivedAt - ageMs : 0;
+    reading.temperature = (int16_t)getLE16(frame + 10) / 100.0f;
+    reading.humidity = (int16_t)getLE16(frame + 12) / 100.0f;
+    reading.temperatureFlags = frame[14];
+    reading.humidityFlags = frame[15];
+    return true;
+}
+
+NodeAggregator::NodeAggregator() {
+    begin(nullptr, nullptr);
+}
+
+void NodeAggregator::begin(NodeBatchSink batchSink, void* context) {
+    sink = batchSink;
+    sinkContext = context;
+    memset(nodes, 0, sizeof(nodes));
+    batchCount = 0;
+    batchStarted = 0;
+    lastExpiry = 0;
+    memset(&counters, 0, sizeof(counters));
+}
+
+NodeAggregator::NodeState* NodeAggregator::lookup(uint16_t nodeId, uint64_t now) {
+    NodeState* freeSlot = nullptr;
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        if (nodes[i].used && nodes[i].link.nodeId == nodeId) return &nodes[i];
+        if (!nodes[i].used && freeSlot == nullptr) freeSlot = &nodes[i];
+    }
+    if (freeSlot == nullptr) return nullptr;
+
+    memset(freeSlot, 0, sizeof(NodeState));
+    freeSlot->used = true;
+    freeSlot->link.nodeId = nodeId;
+    freeSlot->link.lastSeen = now;
+    return freeSlot;
+}
+
+/*
+ * Sliding-window duplicate check (the anti-replay bitmap of IPsec):
+ * sequences ahead of the highest shift the window, ones inside it are
+ * accepted once, older ones are dropped as stale
+ */
+bool NodeAggregator::admit(NodeState& state, const NodeReading& reading) {
+    NodeLinkStats& link = state.link;
+    bool first = state.window == 0;
+
+    if (!first && reading.session != link.session) {
+        if (reading.session == state.previousSession) {
+            link.stale++;
+            return false;
+        }
+        state.previousSession = link.session;
+        link.restarts++;
+        first = true;
+    }
+    if (first) {
+        link.session = reading.session;
+        link.highestSequence = reading.sequence;
+        state.window = 1;
+        return true;
+    }
+
+    if (reading.sequence > link.highestSequence) {
+        uint32_t shift = reading.sequence - link.highestSequence;
+        state.window = (shift >= NODE_DEDUP_WINDOW) ? 0 : state.window << shift;
+        state.window |= 1;
+        link.lost += shift - 1;
+        link.highestSequence = reading.sequence;
+        return true;
+    }
+
+    uint32_t behind = link.highestSequence - reading.sequence;
+    if (behind >= NODE_DEDUP_WINDOW) {
+        link.stale++;
+        return false;
+    }
+    uint64_t bit = (uint64_t)1 << behind;
+    if (state.window & bit) {
+        link.duplicates++;
+        return false;
+    }
+    state.window |= bit;
+    if (link.lost > 0) link.lost--;            // A reordered frame filled its gap
+    return true;
+}
+
+bool NodeAggregator::accept(const uint8_t* frame, size_t length, uint64_t now) {
+    counters.frames++;
+
+    NodeReading reading;
+    if (!decodeNodeFrame(frame, length, now, reading)) {
+        counters.badFrames++;
+        return false;
+    }
+
+    NodeState* state = lookup(reading.nodeId, now);
+    if (state == nullptr) {
+        counters.rejectedNodes++;
+        return false;
+    }
+    state->link.lastSeen = now;
+    if (!admit(*state, reading)) return false;
+    state->link.accepted++;
+
+    if (batchCount == 0) batchStarted = now;
+    batch[batchCount++] = reading;
+    if (batchCount == NODE_BATCH_SIZE) flush();
+    return true;
+}
+
+void NodeAggregator::flush() {
+    if (batchCount == 0) return;
+    if (sink != nullptr) sink(sinkContext, batch, batchCount);
+    counters.batches++;
+    counters.batchedReadings += batchCount;
+    batchCount = 0;
+}
+
+void NodeAggregator::service(uint64_t now) {
+    if (batchCount > 0 && now - batchStarted >= NODE_BATCH_MAX_AGE_MS) flush();
+
+    if (now - lastExpiry < NODE_EXPIRY_CHECK_MS) return;
+    lastExpiry = now;
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        if (nodes[i].used && now - nodes[i].link.lastSeen > NODE_EXPIRY_MS) nodes[i].used = false;
+    }
+}
+
+uint8_t NodeAggregator::nodeCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        if (nodes[i].used) count++;
+    }
+    return count;
+}
+
+// index counts active nodes only
+const NodeLinkStats* NodeAggregator::node(uint8_t index) const {
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        if (!nodes[i].used) continue;
+        if (index-- == 0) return &nodes[i].link;
+    }
+    return nullptr;
+}
+
+NodeHistory::NodeHistory() {
+    memset(slots, 0, sizeof(slots));
+}
+
+/*
+ * Slot for a node, taking over the one that has been silent longest when
+ * every slot is in use
+ */
+NodeHistory::Slot* NodeHistory::slotFor(uint16_t nodeId) {
+    Slot* freeSlot = nullptr;
+    Slot* oldest = nullptr;
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        Slot& slot = slots[i];
+        if (slot.used && slot.nodeId == nodeId) return &slot;
+        if (!slot.used) {
+            if (freeSlot == nullptr) freeSlot = &slot;
+            continue;
+        }
+        if (oldest == nullptr || slot.readings.newest().timestamp < oldest->readings.newest().timestamp) {
+            oldest = &slot;
+        }
+    }
+
+    Slot* slot = (freeSlot != nullptr) ? freeSlot : oldest;
+    slot->used = true;
+    slot->nodeId = nodeId;
+    slot->readings.clear();
+    return slot;
+}
+
+void NodeHistory::add(const NodeReading* readings, size_t count) {
+    Slot* slot = nullptr;
+    for (size_t i = 0; i < count; i++) {
+        // Batches are mostly runs from one node
+        if (slot == nullptr || slot->nodeId != readings[i].nodeId) slot = slotFor(readings[i].nodeId);
+        slot->readings.push(readings[i]);
+    }
+}
+
+uint8_t NodeHistory::nodeCount() const {
+    uint8_t count = 0;
+    while (count < NODE_MAX_NODES && slots[count].used) count++;
+    return count;
+}
+
+int8_t NodeHistory::find(uint16_t nodeId) const {
+    for (uint8_t i = 0; i < NODE_MAX_NODES; i++) {
+        if (slots[i].used && slots[i].nodeId == nodeId) return (int8_t)i;
+    }
+    return -1;
+}
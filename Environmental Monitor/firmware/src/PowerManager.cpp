@@ -0,0 +1,239 @@
+/*
+ * CPU Clock and WiFi Power-Save Policy - implementation
+ */
+
+#include "PowerManager.h"
+
+#include <Arduino.h>
+#include <esp_idf_version.h>
+#include <esp_wifi.h>
+
+// Clocks and power-save type per mode
+struct PowerModeSettings {
+    uint16_t maxMhz;
+    uint16_t minMhz;
+    wifi_ps_type_t wifiPowerSave;
+    bool lightSleep;
+};
+
+static const PowerModeSettings MODE_SETTINGS[POWER_MODE_COUNT] = {
+    { 240, 240, WIFI_PS_NONE, false },         // performance
+    { 240, 80, WIFI_PS_MIN_MODEM, false },     // balanced
+    { 160, 40, WIFI_PS_MAX_MODEM, true }       // low_power
+};
+
+// ESP32-S3 datasheet, modem-sleep currents (typical, rounded; not measured on this board)
+struct ClockCurrent {
+    uint16_t mhz;
+    float runningMa;                           // One core busy
+    float waitingMa;                           // Both cores idle (WAITI)
+};
+
+static const ClockCurrent CLOCK_CURRENTS[] = {
+    { 40, 21.0f, 13.0f },
+    { 80, 32.0f, 22.0f },
+    { 160, 44.0f, 27.0f },
+    { 240, 58.0f, 32.0f }
+};
+
+#define LIGHT_SLEEP_MA 2.0f                    // Light sleep with the WiFi connection kept
+
+/*
+ * Average radio current and worst-case receive delay per power-save type,
+ * for an access point with a 102.4 ms beacon interval and DTIM 1
+ */
+static float radioCurrentMa(wifi_ps_type_t type) {
+    switch (type) {
+        case WIFI_PS_NONE: return 85.0f;       // Receiver always on
+        case WIFI_PS_MIN_MODEM: return 20.0f;  // Wakes for every DTIM beacon
+        case WIFI_PS_MAX_MODEM: return 8.0f;   // Wakes every listen interval (3 beacons)
+        default: break;
+    }
+    return 0.0f;
+}
+
+static uint16_t wakeLatencyMs(wifi_ps_type_t type) {
+    switch (type) {
+        case WIFI_PS_MIN_MODEM: return 103;
+        case WIFI_PS_MAX_MODEM: return 308;
+        default: break;
+    }
+    return 0;
+}
+
+static const ClockCurrent& clockCurrent(uint16_t mhz) {
+    for (const ClockCurrent& entry : CLOCK_CURRENTS) {
+        if (entry.mhz >= mhz) return entry;
+    }
+    return CLOCK_CURRENTS[sizeof(CLOCK_CURRENTS) / sizeof(CLOCK_CURRENTS[0]) - 1];
+}
+
+PowerManager::PowerManager()
+    : cpuLock(nullptr), sleepLock(nullptr), started(false), dfs(false), lightSleepRefused(false),
+      radioPinned(false), streamAttached(false), configured(POWER_MODE_BALANCED), effective(POWER_MODE_BALANCED), depth(0),
+      lastAccounted(0), busySince(0), modes() {
+}
+
+void PowerManager::begin(uint8_t mode, bool radioAlwaysOn, int64_t now) {
+    if (cpuLock == nullptr) esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "activity", &cpuLock);
+    if (sleepLock == nullptr) esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "activity_awake", &sleepLock);
+
+    radioPinned = radioAlwaysOn;
+    configured = (mode < POWER_MODE_COUNT) ? mode : (uint8_t)POWER_MODE_BALANCED;
+    effective = streamAttached ? (uint8_t)POWER_MODE_PERFORMANCE : configured;
+    lastAccounted = now;
+    started = true;
+    apply();
+}
+
+/*
+ * Configure scaling (or the fallback clock) and the radio for the effective mode
+ */
+void PowerManager::apply() {
+    if (!started) return;
+    const PowerModeSettings& settings = MODE_SETTINGS[effective];
+
+    wifi_mode_t wifiMode = WIFI_MODE_NULL;
+    if (esp_wifi_get_mode(&wifiMode) == ESP_OK && wifiMode != WIFI_MODE_NULL) {
+        esp_wifi_set_ps(radioPinned ? WIFI_PS_NONE : settings.wifiPowerSave);
+    }
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32s3_t config = {};
+#endif
+    config.max_freq_mhz = settings.maxMhz;
+    config.min_freq_mhz = settings.minMhz;
+    config.light_sleep_enable = settings.lightSleep;
+    esp_err_t result = esp_pm_configure(&config);
+    if (result != ESP_OK && config.light_sleep_enable) {
+        // Light sleep needs tickless idle; scale the clock without it
+        config.light_sleep_enable = false;
+        result = esp_pm_configure(&config);
+        lightSleepRefused = result == ESP_OK;
+    }
+    dfs = result == ESP_OK && cpuLock != nullptr;
+
+    if (!dfs) {
+        uint16_t idle = (settings.minMhz < POWER_FALLBACK_MIN_MHZ) ? POWER_FALLBACK_MIN_MHZ : settings.minMhz;
+        setCpuFrequencyMhz(depth > 0 ? settings.maxMhz : idle);
+    }
+}
+
+/*
+ * Charge the time since the last call to the effective mode
+ */
+void PowerManager::account(int64_t now) {
+    PowerModeStats& stats = modes[effective];
+    stats.residencyMicros += (uint64_t)(now - lastAccounted);
+    lastAccounted = now;
+    if (depth > 0) {
+        stats.busyMicros += (uint64_t)(now - busySince);
+        busySince = now;
+    }
+}
+
+void PowerManager::setMode(uint8_t mode, int64_t now) {
+    if (mode >= POWER_MODE_COUNT || mode == configured) return;
+    account(now);
+    configured = mode;
+    effective = streamAttached ? (uint8_t)POWER_MODE_PERFORMANCE : configured;
+    apply();
+}
+
+void PowerManager::setStreaming(bool attached, int64_t now) {
+    if (attached == streamAttached) return;
+    account(now);
+    streamAttached = attached;
+    effective = streamAttached ? (uint8_t)POWER_MODE_PERFORMANCE : configured;
+    apply();
+}
+
+void PowerManager::acquire(int64_t now) {
+    if (depth++ > 0) return;
+    busySince = now;
+    if (!started) return;
+    if (dfs) {
+        esp_pm_lock_acquire(cpuLock);
+        esp_pm_lock_acquire(sleepLock);
+    } else if (MODE_SETTINGS[effective].minMhz != MODE_SETTINGS[effective].maxMhz) {
+        setCpuFrequencyMhz(MODE_SETTINGS[effective].maxMhz);
+    }
+}
+
+void PowerManager::release(int64_t now) {
+    if (depth == 0 || --depth > 0) return;
+    modes[effective].busyMicros += (uint64_t)(now - busySince);
+    if (!started) return;
+    if (dfs) {
+        esp_pm_lock_release(sleepLock);
+        esp_pm_lock_release(cpuLock);
+    } else if (MODE_SETTINGS[effective].minMhz != MODE_SETTINGS[effective].maxMhz) {
+        uint16_t idle = MODE_SETTINGS[effective].minMhz;
+        setCpuFrequencyMhz(idle < POWER_FALLBACK_MIN_MHZ ? POWER_FALLBACK_MIN_MHZ : idle);
+    }
+}
+
+/*
+ * The SDK locks count their holders and may be taken from any task; the
+ * fallback clock switch may not, so other tasks get the top clock only
+ * with scaling
+ */
+bool PowerManager::acquireShared() {
+    if (!started || !dfs) return false;
+    esp_pm_lock_acquire(cpuLock);
+    esp_pm_lock_acquire(sleepLock);
+    return true;
+}
+
+void PowerManager::releaseShared() {
+    esp_pm_lock_release(sleepLock);
+    esp_pm_lock_release(cpuLock);
+}
+
+void PowerManager::recordRequest(uint32_t micros) {
+    PowerModeStats& stats = modes[effective];
+    stats.requests++;
+    stats.requestMicros += micros;
+    if (micros > stats.maxRequestMicros) stats.maxRequestMicros = micros;
+}
+
+PowerModeStats PowerManager::stats(uint8_t mode, int64_t now) const {
+    PowerModeStats result = modes[mode];
+    if (mode == effective && started) {
+        result.residencyMicros += (uint64_t)(now - lastAccounted);
+        if (depth > 0) result.busyMicros += (uint64_t)(now - busySince);
+    }
+    return result;
+}
+
+PowerModeProfile PowerManager::profile(uint8_t mode) const {
+    const PowerModeSettings& settings = MODE_SETTINGS[mode];
+    PowerModeProfile result;
+    result.maxMhz = settings.maxMhz;
+    result.minMhz = settings.minMhz;
+    if (!dfs && result.minMhz < POWER_FALLBACK_MIN_MHZ) result.minMhz = POWER_FALLBACK_MIN_MHZ;
+    result.lightSleep = settings.lightSleep && dfs && !lightSleepRefused;
+
+    wifi_ps_type_t powerSave = radioPinned ? WIFI_PS_NONE : settings.wifiPowerSave;
+    result.wifiPowerSave = (uint8_t)powerSave;
+    result.activeMa = clockCurrent(result.maxMhz).runningMa;
+    result.idleMa = result.lightSleep ? LIGHT_SLEEP_MA : clockCurrent(result.minMhz).waitingMa;
+    result.radioMa = radioCurrentMa(powerSave);
+    result.wakeLatencyMs = wakeLatencyMs(powerSave);
+    return result;
+}
+
+float PowerManager::estimatedCurrentMa(uint8_t mode, int64_t now) const {
+    PowerModeProfile figures = profile(mode);
+    PowerModeStats measured = stats(mode, now);
+
+    // Never entered: assume the sampler's share of a 1 s interval (a few ms)
+    float duty = 0.01f;
+    if (measured.residencyMicros > 0) {
+        duty = (float)measured.busyMicros / (float)measured.residencyMicros;
+    }
+    if (duty > 1.0f) duty = 1.0f;
+    return duty * figures.activeMa + (1.0f - duty) * figures.idleMa + figures.radioMa;
+}
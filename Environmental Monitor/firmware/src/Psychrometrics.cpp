@@ -0,0 +1,114 @@
+/*
+ * Psychrometric Calculations - implementation
+ * See Psychrometrics.h for the formulas used.
+ */
+
+#include "Psychrometrics.h"
+
+#include <math.h>
+
+#define SVP_TABLE_MIN_C   -40                  // First table entry temperature
+#define SVP_TABLE_SIZE    121                  // -40..80 °C in 1 °C steps
+
+// Saturation vapor pressure (hPa), Buck: 6.1121 * exp((18.678 - T/234.5) * (T / (257.14 + T)))
+static const float SVP_TABLE[SVP_TABLE_SIZE] = {
+    0.1898f, 0.2104f, 0.2330f, 0.2578f, 0.2850f, 0.3147f, 0.3472f, 0.3827f,
+    0.4215f, 0.4638f, 0.5099f, 0.5601f, 0.6147f, 0.6740f, 0.7384f, 0.8084f,
+    0.8842f, 0.9664f, 1.0554f, 1.1517f, 1.2558f, 1.3683f, 1.4897f, 1.6207f,
+    1.7620f, 1.9141f, 2.0779f, 2.2541f, 2.4435f, 2.6471f, 2.8656f, 3.1001f,
+    3.3515f, 3.6210f, 3.9095f, 4.2184f, 4.5488f, 4.9020f, 5.2793f, 5.6822f,
+    6.1121f, 6.5706f, 7.0594f, 7.5801f, 8.1345f, 8.7244f, 9.3519f, 10.0188f,
+    10.7275f, 11.4800f, 12.2786f, 13.1258f, 14.0241f, 14.9760f, 15.9843f, 17.0517f,
+    18.1813f, 19.3760f, 20.6391f, 21.9737f, 23.3834f, 24.8716f, 26.4420f, 28.0985f,
+    29.8449f, 31.6853f, 33.6240f, 35.6654f, 37.8139f, 40.0742f, 42.4513f, 44.9500f,
+    47.5755f, 50.3333f, 53.2287f, 56.2675f, 59.4555f, 62.7988f, 66.3036f, 69.9764f,
+    73.8236f, 77.8522f, 82.0691f, 86.4815f, 91.0970f, 95.9230f, 100.9674f, 106.2384f,
+    111.7441f, 117.4931f, 123.4940f, 129.7559f, 136.2880f, 143.0996f, 150.2004f, 157.6004f,
+    165.3097f, 173.3386f, 181.6979f, 190.3985f, 199.4515f, 208.8683f, 218.6606f, 228.8404f,
+    239.4200f, 250.4117f, 261.8284f, 273.6831f, 285.9891f, 298.7600f, 312.0098f, 325.7525f,
+    340.0027f, 354.7751f, 370.0846f, 385.9468f, 402.3770f, 419.3914f, 437.0061f, 455.2376f,
+    474.1027f,
+};
+
+/*
+ * Table lookup with linear interpolation (error < 0.1% over the range)
+ */
+float saturationVaporPressure(float temperatureC) {
+    float position = temperatureC - SVP_TABLE_MIN_C;
+    if (position <= 0.0f) return SVP_TABLE[0];
+    if (position >= SVP_TABLE_SIZE - 1) return SVP_TABLE[SVP_TABLE_SIZE - 1];
+    
+    int index = (int)position;
+    float fraction = position - index;
+    return SVP_TABLE[index] + (SVP_TABLE[index + 1] - SVP_TABLE[index]) * fraction;
+}
+
+/*
+ * Temperature at which the given vapor pressure saturates (inverse table lookup)
+ */
+static float dewPointFromVaporPressure(float vaporPressure) {
+    if (vaporPressure <= SVP_TABLE[0]) return SVP_TABLE_MIN_C;
+    if (vaporPressure >= SVP_TABLE[SVP_TABLE_SIZE - 1]) return SVP_TABLE_MIN_C + SVP_TABLE_SIZE - 1;
+    
+    // Binary search for the bracketing entries (table is monotonic)
+    int low = 0;
+    int high = SVP_TABLE_SIZE - 1;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (SVP_TABLE[mid] <= vaporPressure) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    
+    float fraction = (vaporPressure - SVP_TABLE[low]) / (SVP_TABLE[high] - SVP_TABLE[low]);
+    return SVP_TABLE_MIN_C + low + fraction;
+}
+
+/*
+ * NWS heat index (Rothfusz regression with the NWS low/high humidity adjustments)
+ */
+static float heatIndexCelsius(float temperatureC, float relativeHumidity) {
+    float t = temperatureC * 1.8f + 32.0f;
+    float rh = relativeHumidity;
+    
+    // Steadman's simple formula, used when the result is below 80 °F
+    float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + rh * 0.094f);
+    
+    if ((hi + t) * 0.5f >= 80.0f) {
+        hi = -42.379f + 2.04901523f * t + 10.14333127f * rh
+             - 0.22475541f * t * rh - 0.00683783f * t * t
+             - 0.05481717f * rh * rh + 0.00122874f * t * t * rh
+             + 0.00085282f * t * rh * rh - 0.00000199f * t * t * rh * rh;
+        
+        if (rh < 13.0f && t >= 80.0f && t <= 112.0f) {
+            hi -= ((13.0f - rh) * 0.25f) * sqrtf((17.0f - fabsf(t - 95.0f)) / 17.0f);
+        } else if (rh > 85.0f && t >= 80.0f && t <= 87.0f) {
+            hi += ((rh - 85.0f) * 0.1f) * ((87.0f - t) * 0.2f);
+        }
+    }
+    
+    return (hi - 32.0f) / 1.8f;
+}
+
+/*
+ * Compute all derived values for one reading
+ */
+PsychrometricValues computePsychrometrics(float temperatureC, float relativeHumidity) {
+    PsychrometricValues values;
+    
+    float rh = relativeHumidity;
+    if (rh < 0.0f) rh = 0.0f;
+    if (rh > 100.0f) rh = 100.0f;
+    
+    float saturation = saturationVaporPressure(temperatureC);     // hPa
+    float vapor = saturation * rh * 0.01f;                         // hPa
+    
+    values.dewPoint = (vapor > 0.0f) ? dewPointFromVaporPressure(vapor) : SVP_TABLE_MIN_C;
+    values.heatIndex = heatIndexCelsius(temperatureC, rh);
+    values.absoluteHumidity = 216.7f * vapor / (temperatureC + 273.15f);
+    values.vaporPressureDeficit = (saturation - vapor) * 0.1f;
+    
+    return values;
+}
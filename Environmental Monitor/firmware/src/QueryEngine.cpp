@@ -0,0 +1,197 @@
+/*
+ * Bucketed Aggregation Queries - implementation
+ */
+
+#include "QueryEngine.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+
+static const char* const SERIES_NAMES[QUERY_SERIES_COUNT] = {
+    "temperature", "humidity", "dew_point", "heat_index", "absolute_humidity", "vpd"
+};
+
+static const char* const AGGREGATION_NAMES[QUERY_AGG_TOTAL] = {
+    "mean", "min", "max", "count", "sum", "first", "last"
+};
+
+const char* querySeriesName(uint8_t series) {
+    return (series < QUERY_SERIES_COUNT) ? SERIES_NAMES[series] : "";
+}
+
+const char* queryAggregationName(uint8_t aggregation) {
+    return (aggregation < QUERY_AGG_TOTAL) ? AGGREGATION_NAMES[aggregation] : "";
+}
+
+float querySeriesValue(const SensorReading& reading, uint8_t series) {
+    switch (series) {
+        case QUERY_SERIES_TEMPERATURE:       return reading.temperature;
+        case QUERY_SERIES_HUMIDITY:          return reading.humidity;
+        case QUERY_SERIES_DEW_POINT:         return reading.dewPoint;
+        case QUERY_SERIES_HEAT_INDEX:        return reading.heatIndex;
+        case QUERY_SERIES_ABSOLUTE_HUMIDITY: return reading.absoluteHumidity;
+        case QUERY_SERIES_VPD:               return reading.vaporPressureDeficit;
+        default:                             return 0.0f;
+    }
+}
+
+/*
+ * Match each comma-separated token against a name table
+ */
+static bool parseNameList(const char* text, const char* const* names, uint8_t nameCount, uint8_t* mask) {
+    *mask = 0;
+    if (text == nullptr || *text == '\0') return false;
+
+    const char* token = text;
+    while (true) {
+        const char* end = strchr(token, ',');
+        size_t length = end ? (size_t)(end - token) : strlen(token);
+
+        bool matched = false;
+        for (uint8_t i = 0; i < nameCount; i++) {
+            if (strlen(names[i]) == length && strncmp(names[i], token, length) == 0) {
+                *mask |= (uint8_t)(1u << i);
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) return false;
+
+        if (!end) break;
+        token = end + 1;
+    }
+    return true;
+}
+
+bool parseSeriesList(const char* text, uint8_t* mask) {
+    return parseNameList(text, SERIES_NAMES, QUERY_SERIES_COUNT, mask);
+}
+
+bool parseAggregationList(const char* text, uint8_t* mask) {
+    return parseNameList(text, AGGREGATION_NAMES, QUERY_AGG_TOTAL, mask);
+}
+
+bool parseBucketDuration(const char* text, unsigned long* bucketMs) {
+    // Digits only: strtoul would also take a sign or leading spaces
+    if (text == nullptr || *text < '0' || *text > '9') return false;
+
+    char* end = nullptr;
+    errno = 0;
+    unsigned long value = strtoul(text, &end, 10);
+    if (end == text || value == 0 || errno == ERANGE) return false;
+
+    unsigned long unit = 1000;
+    if (*end != '\0') {
+        switch (*end) {
+            case 's': unit = 1000; break;
+            case 'm': unit = 60000; break;
+            case 'h': unit = 3600000; break;
+            case 'd': unit = 86400000; break;
+            default:  return false;
+        }
+        if (end[1] != '\0') return false;
+    }
+
+    // unsigned long is 32 bits on the ESP32; a wrapped product could be 0 and divide by zero
+    if (value > ULONG_MAX / unit) return false;
+    *bucketMs = value * unit;
+    return true;
+}
+
+float bucketAggregationValue(const BucketAccumulator& accumulator, uint8_t aggregation) {
+    switch (aggregation) {
+        case QUERY_AGG_MEAN:  return accumulator.count ? accumulator.sum / accumulator.count : 0.0f;
+        case QUERY_AGG_MIN:   return accumulator.min;
+        case QUERY_AGG_MAX:   return accumulator.max;
+        case QUERY_AGG_COUNT: return (float)accumulator.count;
+        case QUERY_AGG_SUM:   return accumulator.sum;
+        case QUERY_AGG_FIRST: return accumulator.first;
+        case QUERY_AGG_LAST:  return accumulator.last;
+        default:              return 0.0f;
+    }
+}
+
+BucketAggregator::BucketAggregator(const QuerySpec& querySpec, BucketCallback bucketCallback, void* callbackContext)
+    : spec(querySpec), callback(bucketCallback), context(callbackContext),
+      bucketStart(0), bucketOpen(false), emitted(0), scanned(0) {
+    resetBucket();
+}
+
+void BucketAggregator::resetBucket() {
+    for (uint8_t i = 0; i < QUERY_SERIES_COUNT; i++) {
+        accumulators[i].sum = 0.0f;
+        accumulators[i].min = 0.0f;
+        accumulators[i].max = 0.0f;
+        accumulators[i].first = 0.0f;
+        accumulators[i].last = 0.0f;
+        accumulators[i].count = 0;
+    }
+}
+
+void BucketAggregator::emitBucket() {
+    if (!bucketOpen) return;
+    callback(bucketStart, accumulators, spec, context);
+    emitted++;
+    bucketOpen = false;
+    resetBucket();
+}
+
+void BucketAggregator::add(const SensorReading& reading) {
+    scanned++;
+    if (!reading.isValid) return;
+
+    float values[QUERY_SERIES_COUNT];
+    for (uint8_t series = 0; series < QUERY_SERIES_COUNT; series++) {
+        values[series] = querySeriesValue(reading, series);
+    }
+    addSample(reading.timestamp, values);
+}
+
+void BucketAggregator::add(const StoredReading& record) {
+    scanned++;
+    if (!FlashHistory::recordValid(record)) return;
+
+    const float values[QUERY_SERIES_COUNT] = {
+        record.temperature, record.humidity, record.dewPoint,
+        record.heatIndex, record.absoluteHumidity, record.vaporPressureDeficit
+    };
+    addSample(storedTimestamp(record), values);
+}
+
+/*
+ * Accumulate one sample, closing the current bucket when time moves past it
+ */
+void BucketAggregator::addSample(uint64_t timestamp, const float* values) {
+    if (timestamp < spec.fromMs || timestamp > spec.toMs || spec.bucketMs == 0) return;
+
+    uint64_t start = timestamp - (timestamp % spec.bucketMs);
+    if (bucketOpen && start != bucketStart) {
+        emitBucket();
+    }
+    bucketStart = start;
+    bucketOpen = true;
+
+    for (uint8_t series = 0; series < QUERY_SERIES_COUNT; series++) {
+        if (!(spec.seriesMask & (1u << series))) continue;
+
+        float value = values[series];
+        BucketAccumulator& accumulator = accumulators[series];
+        if (accumulator.count == 0) {
+            accumulator.min = value;
+            accumulator.max = value;
+            accumulator.first = value;
+        } else {
+            if (value < accumulator.min) accumulator.min = value;
+            if (value > accumulator.max) accumulator.max = value;
+        }
+        accumulator.sum += value;
+        accumulator.last = value;
+        accumulator.count++;
+    }
+}
+
+void BucketAggregator::finish() {
+    emitBucket();
+}
@@ -0,0 +1,183 @@
+/*
+ * Spectral Analysis of Temperature History - implementation
+ */
+
+#include "SpectralAnalyzer.h"
+
+#include <math.h>
+
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define SPECTRAL_USE_ESP_DSP 1
+#endif
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+SpectralAnalyzer::SpectralAnalyzer()
+    : windowSum(0.0f), ready(false) {
+}
+
+/*
+ * Build the Hann window and the twiddle factors W_N^k for k < N/2
+ */
+bool SpectralAnalyzer::begin() {
+    windowSum = 0.0f;
+    for (size_t i = 0; i < SPECTRUM_SIZE; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (SPECTRUM_SIZE - 1));
+        windowSum += window[i];
+    }
+    for (size_t k = 0; k < SPECTRUM_SIZE / 2; k++) {
+        twiddleCos[k] = cosf(2.0f * (float)M_PI * k / SPECTRUM_SIZE);
+        twiddleSin[k] = sinf(2.0f * (float)M_PI * k / SPECTRUM_SIZE);
+    }
+
+#ifdef SPECTRAL_USE_ESP_DSP
+    // esp-dsp keeps its own twiddle table for the complex kernel
+    if (dsps_fft2r_init_fc32(NULL, SPECTRUM_SIZE / 2) != ESP_OK) {
+        return false;
+    }
+#endif
+
+    ready = true;
+    return true;
+}
+
+const char* SpectralAnalyzer::backend() const {
+#ifdef SPECTRAL_USE_ESP_DSP
+    return "esp-dsp";
+#else
+    return "scalar";
+#endif
+}
+
+/*
+ * In-place complex FFT of interleaved re/im data, output in natural order
+ */
+void SpectralAnalyzer::complexFFT(float* data, size_t points) {
+#ifdef SPECTRAL_USE_ESP_DSP
+    dsps_fft2r_fc32(data, points);
+    dsps_bit_rev_fc32(data, points);
+#else
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < points; i++) {
+        size_t bit = points >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float tr = data[2 * i];
+            float ti = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+
+    // Iterative radix-2 butterflies; W_len^k is W_N^(k * N / len)
+    for (size_t len = 2; len <= points; len <<= 1) {
+        size_t half = len >> 1;
+        size_t twiddleStep = SPECTRUM_SIZE / len;
+        for (size_t start = 0; start < points; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = twiddleCos[k * twiddleStep];
+                float wi = -twiddleSin[k * twiddleStep];
+                float* a = &data[2 * (start + k)];
+                float* b = &data[2 * (start + k + half)];
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+#endif
+}
+
+/*
+ * Window, transform and locate the dominant non-DC peak
+ */
+SpectralResult SpectralAnalyzer::analyze(const float* samples, float samplePeriodSeconds) {
+    SpectralResult result = {};
+    result.samplePeriodSeconds = samplePeriodSeconds;
+    if (!ready || samplePeriodSeconds <= 0.0f) return result;
+
+    // Remove the linear trend so slow drift does not leak into low bins
+    float sumX = 0.0f, sumY = 0.0f, sumXY = 0.0f, sumXX = 0.0f;
+    for (size_t i = 0; i < SPECTRUM_SIZE; i++) {
+        sumX += i;
+        sumY += samples[i];
+        sumXY += i * samples[i];
+        sumXX += (float)i * i;
+    }
+    float n = (float)SPECTRUM_SIZE;
+    float slope = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+    float intercept = (sumY - slope * sumX) / n;
+
+    // Pack even/odd samples as real/imag parts of an N/2-point complex input
+    for (size_t i = 0; i < SPECTRUM_SIZE; i++) {
+        buffer[i] = (samples[i] - (intercept + slope * i)) * window[i];
+    }
+
+    const size_t points = SPECTRUM_SIZE / 2;
+    complexFFT(buffer, points);
+
+    // Split step: recover X[k] of the real signal from Z[k] and Z[M-k]
+    float scale = 2.0f / windowSum;
+    amplitude[0] = 0.0f;
+    for (size_t k = 1; k < points; k++) {
+        float a = buffer[2 * k];
+        float b = buffer[2 * k + 1];
+        float c = buffer[2 * (points - k)];
+        float d = buffer[2 * (points - k) + 1];
+
+        float evenRe = 0.5f * (a + c);
+        float evenIm = 0.5f * (b - d);
+        float oddRe = 0.5f * (b + d);
+        float oddIm = -0.5f * (a - c);
+
+        float wr = twiddleCos[k];
+        float wi = -twiddleSin[k];
+        float re = evenRe + wr * oddRe - wi * oddIm;
+        float im = evenIm + wr * oddIm + wi * oddRe;
+
+        amplitude[k] = sqrtf(re * re + im * im) * scale;
+    }
+
+    // Dominant peak, skipping bin 1 which is dominated by window leakage of the trend
+    size_t peak = 2;
+    float totalPower = 0.0f;
+    for (size_t k = 2; k < points; k++) {
+        totalPower += amplitude[k] * amplitude[k];
+        if (amplitude[k] > amplitude[peak]) peak = k;
+    }
+
+    // Parabolic interpolation between neighbouring bins
+    float offset = 0.0f;
+    if (peak + 1 < points) {
+        float left = amplitude[peak - 1];
+        float center = amplitude[peak];
+        float right = amplitude[peak + 1];
+        float denominator = left - 2.0f * center + right;
+        if (denominator != 0.0f) {
+            offset = 0.5f * (left - right) / denominator;
+        }
+    }
+
+    float binHz = 1.0f / (SPECTRUM_SIZE * samplePeriodSeconds);
+    float meanPower = totalPower / (points - 2);
+
+    result.valid = true;
+    result.dominantFrequencyHz = (peak + offset) * binHz;
+    result.dominantPeriodSeconds = 1.0f / result.dominantFrequencyHz;
+    result.dominantAmplitude = amplitude[peak];
+    result.peakToMeanRatio = (meanPower > 0.0f) ? (amplitude[peak] * amplitude[peak]) / meanPower : 0.0f;
+    return result;
+}
@@ -0,0 +1,233 @@
+/*
+ * Loop and Task Stall Monitor - implementation
+ */
+
+#include "StallMonitor.h"
+#include "HistoryCheckpoint.h"
+
+#include <string.h>
+
+// Longest acceptable gap between progress points per stage (ms)
+static const uint32_t STAGE_THRESHOLD_MS[STALL_STAGE_COUNT] = {
+    100,        // idle: loop() must come back around (delay(10) plus preemption)
+    300,        // sampler: DHT read, anomaly/forecast updates, checkpoint and flash writes
+    250,        // http: one stretch of a handler without progress (writes to a slow client)
+    50,         // node_link: draining a bounded number of frames
+    250,        // ota: one sector of patch output, including the erase
+    100,        // spectrum: one FFT over the history window
+    500         // tls: building a /data body on the HTTPS task
+};
+
+static const char* const STAGE_NAMES[STALL_STAGE_COUNT] = {
+    "idle", "sampler", "http", "node_link", "ota", "spectrum", "tls"
+};
+
+static const char* const TASK_NAMES[STALL_TASK_COUNT] = {
+    "loop", "tls"
+};
+
+StallMonitor::StallMonitor() : journal(nullptr) {
+    memset(stages, 0, sizeof(stages));
+    appending.clear();
+}
+
+uint32_t StallMonitor::thresholdMs(StallTask task, StallStage stage) {
+    if (stage >= STALL_STAGE_COUNT) return 0;
+    // Only the loop is expected to come back; an idle server task is just waiting
+    if (stage == STALL_STAGE_IDLE && task != STALL_TASK_LOOP) return 0;
+    return STAGE_THRESHOLD_MS[stage];
+}
+
+const char* StallMonitor::stageName(uint8_t stage) {
+    return (stage < STALL_STAGE_COUNT) ? STAGE_NAMES[stage] : "unknown";
+}
+
+const char* StallMonitor::taskName(uint8_t task) {
+    return (task < STALL_TASK_COUNT) ? TASK_NAMES[task] : "unknown";
+}
+
+uint32_t StallMonitor::headerCrc(const StallJournal& journal) {
+    return checkpointCrc32(&journal, offsetof(StallJournal, crc));
+}
+
+uint32_t StallMonitor::recordCrc(const StallRecord& record) {
+    return checkpointCrc32(&record, offsetof(StallRecord, crc));
+}
+
+void StallMonitor::resetJournal() {
+    memset(journal, 0, sizeof(StallJournal));
+    journal->magic = STALL_JOURNAL_MAGIC;
+    journal->version = STALL_JOURNAL_VERSION;
+    journal->recordSize = sizeof(StallRecord);
+}
+
+uint8_t StallMonitor::begin(StallJournal* storage, bool warmReset, bool abnormalReset, uint8_t resetReason, int64_t now) {
+    journal = storage;
+    memset(stages, 0, sizeof(stages));
+
+    bool valid = warmReset &&
+                 journal->magic == STALL_JOURNAL_MAGIC &&
+                 journal->version == STALL_JOURNAL_VERSION &&
+                 journal->recordSize == sizeof(StallRecord) &&
+                 journal->head < STALL_JOURNAL_SIZE &&
+                 journal->count <= STALL_JOURNAL_SIZE &&
+                 journal->crc == headerCrc(*journal);
+
+    uint8_t added = 0;
+    if (!valid) {
+        resetJournal();
+    } else if (abnormalReset) {
+        // Whatever a task was in the middle of when the board went down
+        for (uint8_t task = 0; task < STALL_TASK_COUNT; task++) {
+            StallTaskState& state = journal->tasks[task];
+            state.endpoint[STALL_ENDPOINT_LENGTH - 1] = '\0';
+            if (state.stage >= STALL_STAGE_COUNT) continue;
+            if (state.stage == STALL_STAGE_IDLE && state.hungMs == 0) continue;
+
+            uint8_t flags = STALL_FLAG_FATAL | (state.hungMs ? STALL_FLAG_HUNG : 0);
+            append(state, (StallTask)task, state.stage, state.hungMs, flags, 0, resetReason);
+            added++;
+        }
+    }
+
+    journal->boots++;
+    journal->crc = headerCrc(*journal);
+
+    memset(journal->tasks, 0, sizeof(journal->tasks));
+    for (uint8_t task = 0; task < STALL_TASK_COUNT; task++) {
+        journal->tasks[task].lastProgress = (uint32_t)now;
+    }
+    return added;
+}
+
+/*
+ * Charge the time since the last progress point to the stage that was
+ * running, and record it if it was too long
+ */
+void StallMonitor::mark(StallTaskState& state, StallTask task, int64_t now) {
+    uint32_t gap = (uint32_t)now - state.lastProgress;
+    state.lastProgress = (uint32_t)now;
+
+    uint8_t stage = state.stage;
+    uint32_t threshold = thresholdMs(task, (StallStage)stage);
+    if (threshold != 0) {
+        StallStageStats& stats = stages[stage];
+        if (gap > stats.maxGapMicros) stats.maxGapMicros = gap;
+        if (gap >= threshold * 1000) {
+            stats.stalls++;
+            append(state, task, stage, gap / 1000, state.hungMs ? STALL_FLAG_HUNG : 0, (uint32_t)(now / 1000), 0);
+        }
+    }
+    state.hungMs = 0;
+}
+
+void StallMonitor::append(const StallTaskState& state, StallTask task, uint8_t stage, uint32_t durationMs,
+                          uint8_t flags, uint32_t uptimeMs, uint8_t resetReason) {
+    while (appending.test_and_set(std::memory_order_acquire)) {
+    }
+
+    StallRecord& record = journal->records[journal->head];
+    memset(&record, 0, sizeof(record));
+    record.boot = journal->boots;
+    record.uptimeMs = uptimeMs;
+    record.durationMs = durationMs;
+    record.client = state.client;
+    record.task = task;
+    record.stage = stage;
+    record.flags = flags;
+    record.resetReason = resetReason;
+    memcpy(record.endpoint, state.endpoint, STALL_ENDPOINT_LENGTH);
+    record.endpoint[STALL_ENDPOINT_LENGTH - 1] = '\0';
+    record.crc = recordCrc(record);
+
+    journal->head = (journal->head + 1) % STALL_JOURNAL_SIZE;
+    if (journal->count < STALL_JOURNAL_SIZE) journal->count++;
+    journal->crc = headerCrc(*journal);
+
+    appending.clear(std::memory_order_release);
+}
+
+void StallMonitor::enter(StallTask task, StallStage stage, int64_t now) {
+    if (journal == nullptr) return;
+    StallTaskState& state = journal->tasks[task];
+    mark(state, task, now);
+
+    // Past the nesting limit the outer stage is lost, but depth stays balanced
+    if (state.depth < STALL_NESTING) state.stack[state.depth] = state.stage;
+    state.depth++;
+    state.stage = stage;
+    stages[stage].entries++;
+}
+
+void StallMonitor::leave(StallTask task, int64_t now) {
+    if (journal == nullptr) return;
+    StallTaskState& state = journal->tasks[task];
+    mark(state, task, now);
+
+    if (state.depth == 0) return;
+    state.depth--;
+    state.stage = (state.depth < STALL_NESTING) ? state.stack[state.depth] : (uint8_t)STALL_STAGE_IDLE;
+}
+
+void StallMonitor::progress(StallTask task, int64_t now) {
+    if (journal == nullptr) return;
+    mark(journal->tasks[task], task, now);
+}
+
+void StallMonitor::beginRequest(StallTask task, const char* endpoint, uint32_t client) {
+    if (journal == nullptr) return;
+    StallTaskState& state = journal->tasks[task];
+    strncpy(state.endpoint, endpoint, STALL_ENDPOINT_LENGTH - 1);
+    state.endpoint[STALL_ENDPOINT_LENGTH - 1] = '\0';
+    state.client = client;
+}
+
+void StallMonitor::endRequest(StallTask task) {
+    if (journal == nullptr) return;
+    StallTaskState& state = journal->tasks[task];
+    state.endpoint[0] = '\0';
+    state.client = 0;
+}
+
+/*
+ * Runs beside the monitored tasks and only writes hungMs. If the task
+ * made progress while the gap was being computed, the mark is withdrawn.
+ */
+bool StallMonitor::watch(int64_t now) {
+    if (journal == nullptr) return false;
+
+    bool newlyHung = false;
+    for (uint8_t task = 0; task < STALL_TASK_COUNT; task++) {
+        StallTaskState& state = journal->tasks[task];
+        if (thresholdMs((StallTask)task, (StallStage)state.stage) == 0) continue;
+
+        uint32_t seen = state.lastProgress;
+        uint32_t gap = (uint32_t)now - seen;
+        if (gap < STALL_HANG_MS * 1000UL) continue;
+
+        bool first = state.hungMs == 0;
+        state.hungMs = gap / 1000;
+        if (state.lastProgress != seen) {
+            state.hungMs = 0;
+        } else if (first) {
+            newlyHung = true;
+        }
+    }
+    return newlyHung;
+}
+
+const StallRecord* StallMonitor::record(uint8_t age) const {
+    if (journal == nullptr || age >= journal->count) return nullptr;
+    const StallRecord& record = journal->records[(journal->head + STALL_JOURNAL_SIZE - 1 - age) % STALL_JOURNAL_SIZE];
+    return (record.crc == recordCrc(record)) ? &record : nullptr;
+}
+
+const StallTaskState* StallMonitor::taskState(StallTask task) const {
+    return (journal != nullptr && task < STALL_TASK_COUNT) ? &journal->tasks[task] : nullptr;
+}
+
+uint32_t StallMonitor::stallTotal() const {
+    uint32_t total = 0;
+    for (uint8_t stage = 0; stage < STALL_STAGE_COUNT; stage++) total += stages[stage].stalls;
+    return total;
+}
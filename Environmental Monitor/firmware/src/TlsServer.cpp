@@ -0,0 +1,159 @@
+/*
+ * TLS Listener for /data - implementation
+ */
+
+#include "TlsServer.h"
+
+#include <string.h>
+
+#if defined(__has_include)
+#if __has_include(<esp_https_server.h>)
+#include <esp_https_server.h>
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#define TLS_SERVER_AVAILABLE 1
+
+// user_cb exists since IDF 4.4, but its user_cb_state (and so
+// HTTPD_SSL_USER_CB_SESS_CREATE) only since IDF 5.0; older cores get no handshake stats
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define TLS_SESSION_CALLBACK 1
+#endif
+#endif
+#endif
+
+// user_cb carries no context pointer, so the callbacks find the server here
+static TlsServer* activeServer = nullptr;
+
+TlsServer::TlsServer()
+    : handle(nullptr), powerManager(nullptr), routeCount(0), counters() {
+}
+
+bool TlsServer::on(const char* path, const char* contentType, TlsBodyProvider provider) {
+    if (handle != nullptr || routeCount >= TLS_MAX_ROUTES) return false;
+    routes[routeCount].path = path;
+    routes[routeCount].contentType = contentType;
+    routes[routeCount].provider = provider;
+    routeCount++;
+    return true;
+}
+
+bool TlsServer::sessionTickets() const {
+#ifdef CONFIG_ESP_TLS_SERVER_SESSION_TICKETS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TlsServer::handshakeStatsAvailable() const {
+#ifdef TLS_SESSION_CALLBACK
+    return true;
+#else
+    return false;
+#endif
+}
+
+float TlsServer::averageSendMicros() const {
+    return (counters.requests > 0) ? (float)counters.sendMicros / counters.requests : 0.0f;
+}
+
+/*
+ * Start esp_https_server with a bounded session pool and session tickets
+ * The server task is pinned to core 0 so handshakes never run on the
+ * Arduino loop core that owns the sampler.
+ */
+bool TlsServer::begin(const char* certPem, const char* keyPem) {
+#ifdef TLS_SERVER_AVAILABLE
+    if (handle != nullptr) return true;
+    if (certPem == nullptr || strstr(certPem, "BEGIN CERTIFICATE") == nullptr ||
+        keyPem == nullptr || strstr(keyPem, "PRIVATE KEY") == nullptr) {
+        return false;   // Credentials not provisioned
+    }
+
+    httpd_ssl_config_t config = HTTPD_SSL_CONFIG_DEFAULT();
+    config.servercert = (const uint8_t*)certPem;
+    config.servercert_len = strlen(certPem) + 1;
+    config.prvtkey_pem = (const uint8_t*)keyPem;
+    config.prvtkey_len = strlen(keyPem) + 1;
+    config.port_secure = TLS_SERVER_PORT;
+    config.httpd.max_open_sockets = TLS_MAX_SESSIONS;
+    config.httpd.lru_purge_enable = true;
+    config.httpd.max_uri_handlers = TLS_MAX_ROUTES;
+    config.httpd.core_id = 0;
+    config.httpd.stack_size = 10240;
+#ifdef CONFIG_ESP_TLS_SERVER_SESSION_TICKETS
+    config.session_tickets = true;
+#endif
+#ifdef TLS_SESSION_CALLBACK
+    config.user_cb = sessionCallback;
+#endif
+
+    activeServer = this;
+    httpd_handle_t server = nullptr;
+    if (httpd_ssl_start(&server, &config) != ESP_OK) {
+        activeServer = nullptr;
+        return false;
+    }
+
+    for (size_t i = 0; i < routeCount; i++) {
+        httpd_uri_t uri = {};
+        uri.uri = routes[i].path;
+        uri.method = HTTP_GET;
+        uri.handler = handleRequest;
+        uri.user_ctx = &routes[i];
+        httpd_register_uri_handler(server, &uri);
+    }
+
+    handle = server;
+    return true;
+#else
+    (void)certPem;
+    (void)keyPem;
+    return false;
+#endif
+}
+
+/*
+ * Build the body, then time the encrypt-and-send of the response
+ */
+int TlsServer::handleRequest(struct httpd_req* request) {
+#ifdef TLS_SERVER_AVAILABLE
+    PowerManager* power = (activeServer != nullptr) ? activeServer->powerManager : nullptr;
+    bool clockHeld = power != nullptr && power->acquireShared();
+
+    const Route* route = (const Route*)request->user_ctx;
+    String body;
+    route->provider(body);
+
+    httpd_resp_set_type(request, route->contentType);
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = httpd_resp_send(request, body.c_str(), body.length());
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    if (activeServer != nullptr) {
+        activeServer->counters.requests++;
+        activeServer->counters.bytesSent += body.length();
+        activeServer->counters.sendMicros += elapsed;
+    }
+    if (clockHeld) power->releaseShared();
+    return err;
+#else
+    (void)request;
+    return -1;
+#endif
+}
+
+/*
+ * Count established sessions
+ * The callback cannot tell a resumed handshake from a full one: mbedTLS
+ * keeps no flag for it, and the session start time it restores from a
+ * ticket only bounds the answer, so no resumption count is kept.
+ */
+void TlsServer::sessionCallback(struct esp_https_server_user_cb_arg* arg) {
+#ifdef TLS_SESSION_CALLBACK
+    if (activeServer == nullptr || arg->user_cb_state != HTTPD_SSL_USER_CB_SESS_CREATE) return;
+    activeServer->counters.handshakes++;
+#else
+    (void)arg;
+#endif
+}
@@ -9,7 +9,7 @@
  * 
  * Libraries Used:
  * - WiFi (built-in)
- * - WebServer (built-in)
+ * - WiFiServer (built-in), wrapped by HttpServer
  * - DHT sensor library (include in platformio.ini)
  * 
  * Author: IoT Dashboard Developer
@@ -18,10 +18,39 @@
 
 // Include required libraries
 #include <WiFi.h>
-#include <WebServer.h>
 #include <DHT.h>
 #include <ArduinoJson.h>
 #include <time.h>
+#include <sys/time.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "SensorReading.h"
+#include "AnomalyDetector.h"
+#include "Psychrometrics.h"
+#include "SpectralAnalyzer.h"
+#include "Forecaster.h"
+#include "QueryEngine.h"
+#include "Histogram.h"
+#include "DeviceConfig.h"
+#include "HistoryCheckpoint.h"
+#include "TimeSeriesRing.h"
+#include "FlashHistory.h"
+#include "SeqLock.h"
+#include "TlsServer.h"
+#include "HttpServer.h"
+#include "AdmissionControl.h"
+#include "TlsCredentials.h"
+#include "DeltaOta.h"
+#include "NodeLink.h"
+#include "EspNowTransport.h"
+#include "StallMonitor.h"
+#include "PowerManager.h"
+#include "EventStream.h"
+#include "MemoryBudget.h"
 
 // WiFi Configuration - Update these with your network details
 const char* ssid = "YOUR_WIFI_SSID";           // Replace with your WiFi network name
@@ -35,26 +64,295 @@ const char* password = "YOUR_WIFI_PASSWORD";   // Replace with your WiFi passwor
 DHT dht(DHT_PIN, DHT_TYPE);
 
 // Initialize web server on port 80
-WebServer server(80);
-
-// Historical data storage - circular buffer for time-series data
-struct SensorReading {
-    float temperature;
-    float humidity;
-    unsigned long timestamp;
-    bool isValid;
+HttpServer server(80);
+
+// Per-route budgets, priority classes and per-client limits for the web server
+AdmissionController admission;
+
+// HTTPS listener for /data (runs on its own task, enabled when credentials are set)
+TlsServer secureServer;
+
+// Firmware delta being applied to the inactive app slot (pumped from loop())
+DeltaOtaSession otaSession;
+
+// Node link (deviceConfig.linkRole): nodes send frames, a gateway collects them
+#define NODE_FRAMES_PER_LOOP 16                // Frames drained per loop() pass
+#define NODE_EXIT_PIN 0                        // BOOT button (held at reset it selects the ROM loader instead)
+#define NODE_EXIT_WINDOW_MS 3000               // After reset, a node watches the button this long
+#define NODE_EXIT_HOLD_MS 1000                 // Held this long, the node role is cleared
+EspNowTransport nodeTransport;
+NodeAggregator nodeAggregator;
+NodeHistory nodeHistory;
+uint16_t linkNodeId = 0;
+uint8_t linkSession = 0;                       // Random per boot, lets the gateway spot restarts
+
+// Stall monitor; the journal (records and live task state) survives a warm
+// reset so the stall that triggered a watchdog reset can be reported after it
+StallMonitor stallMonitor;
+__NOINIT_ATTR StallJournal stallJournal;
+esp_timer_handle_t stallWatchTimer = nullptr;
+
+// CPU clock and WiFi power-save policy (deviceConfig.powerMode); readings
+// pushed to /events clients, which switch it to low latency while attached
+PowerManager powerManager;
+EventStream eventStream;
+
+// RAM ledger per subsystem: static buffers are declared at boot, JSON
+// documents and serialized response bodies come from budgeted pools
+#define JSON_POOL_BYTES 32768                  // JSON documents alive at once (loop and HTTPS task)
+#define HTTP_POOL_BYTES 32768                  // Serialized response bodies
+#define HEAP_FLOOR_BYTES 32768                 // Kept free for WiFi, lwIP and TLS sessions
+#define DATA_DOCUMENT_BASE_BYTES 512           // /data document without its history page
+#define DATA_READING_BYTES (JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(10) + 32)  // Per history reading (ISO timestamp copied in)
+MemoryBudget memoryBudget;
+MemoryPoolAllocator jsonPool(&memoryBudget, MEMORY_JSON);
+typedef BasicJsonDocument<MemoryPoolAllocator> PooledJsonDocument;
+
+#define MAX_READINGS 1024                      // History ring capacity, a power of two (runtime size is deviceConfig.historySize)
+#define HISTORY_COPY_CHUNK 16                  // Readings copied out per seqlock read
+
+// The ring and its checkpoint header live in no-init RAM so a warm reboot
+// (watchdog, panic, OTA restart) can resume the history instead of clearing it
+__NOINIT_ATTR TimeSeriesRing<SensorReading, MAX_READINGS> readings;
+__NOINIT_ATTR HistoryCheckpoint historyCheckpoint;
+
+// History clock: 64-bit uptime plus an offset that keeps recovered timestamps
+// monotonic. 32-bit millis() would wrap after ~49.7 days of accumulated uptime.
+uint64_t historyTimeOffset = 0;
+
+// Sequence number of the next reading (continues across reboots)
+uint32_t nextSequence = 1;
+
+// Publishes ring updates to readers; the sampler never waits on it
+SeqLock historyLock;
+
+// Consistent view of the ring at one point in time
+struct HistoryView {
+    int count;
+    uint16_t size;
+    uint32_t firstSequence;
 };
 
-#define MAX_READINGS 1000                      // Maximum number of historical readings to store
-SensorReading readings[MAX_READINGS];
-int currentIndex = 0;
-int readingCount = 0;
+// Persisted history in the "history" flash partition, read in place via mmap
+#define FLASH_HISTORY_PARTITION "history"
+FlashHistory flashHistory;
+
+// Boot-time recovery report
+bool historyRecovered = false;
+int recoveredReadings = 0;
+unsigned long recoveryValidationMicros = 0;
 
 // Timing configuration
 unsigned long lastReading = 0;
 const unsigned long READING_INTERVAL = 1000;   // Read sensor every 1 second
 const unsigned long WIFI_TIMEOUT = 10000;      // WiFi connection timeout
 
+// Runtime configuration - the constants above are defaults, overridden from NVS
+const DeviceConfig DEFAULT_DEVICE_CONFIG = {
+    DEVICE_CONFIG_VERSION,
+    READING_INTERVAL,
+    MAX_READINGS,
+    100,        // /data history limit
+    DHT_PIN,
+    DHT_TYPE,
+    LINK_ROLE_STANDALONE,
+    1,          // Node link channel
+    0,          // Node id from the MAC address
+    POWER_MODE_BALANCED
+};
+DeviceConfig deviceConfig = DEFAULT_DEVICE_CONFIG;
+
+// Anomaly detection tuning (DHT22: 0.1 unit resolution)
+const AnomalyConfig TEMPERATURE_ANOMALY_CONFIG = {
+    0.05f,      // ewmaAlpha
+    4.0f,       // zThreshold
+    0.5f,       // cusumSlack
+    8.0f,       // cusumThreshold
+    0.1f,       // minStdDev
+    0.1f,       // resolution
+    3600,       // stuckSeconds (a still room holds one value for many minutes)
+    1.0f,       // maxRatePerSecond (°C/s)
+    30          // warmupSamples
+};
+const AnomalyConfig HUMIDITY_ANOMALY_CONFIG = {
+    0.05f,      // ewmaAlpha
+    4.0f,       // zThreshold
+    0.5f,       // cusumSlack
+    8.0f,       // cusumThreshold
+    0.3f,       // minStdDev
+    0.1f,       // resolution
+    1800,       // stuckSeconds (humidity noise spans several steps)
+    5.0f,       // maxRatePerSecond (%RH/s)
+    30          // warmupSamples
+};
+
+// Streaming anomaly detectors and event log
+SeriesAnomalyDetector temperatureDetector(TEMPERATURE_ANOMALY_CONFIG);
+SeriesAnomalyDetector humidityDetector(HUMIDITY_ANOMALY_CONFIG);
+AnomalyEventLog anomalyLog;
+
+// Spectral analysis of the temperature history (HVAC cycle detection)
+#define SPECTRUM_MAX_PERIOD_SECONDS 900        // Longest cycle looked for (HVAC short-cycling runs 5-15 min)
+const unsigned long SPECTRUM_UPDATE_INTERVAL = 30000;   // Recompute every 30 seconds
+SpectralAnalyzer spectralAnalyzer;
+SpectralResult spectralResult = {};
+float spectrumInput[SPECTRUM_SIZE];
+unsigned long lastSpectrumUpdate = 0;
+const char* spectrumStatus = "collecting";     // "ok", "collecting" or "disabled: history too short"
+unsigned long spectrumRuns = 0;
+uint32_t lastSpectrumCycles = 0;
+unsigned long lastSpectrumMicros = 0;
+
+// Short-horizon forecasting (Holt level + trend damped over 5 minutes)
+HoltForecaster temperatureForecaster(0.05f, 0.005f, 0.02f, 300.0f);
+HoltForecaster humidityForecaster(0.05f, 0.005f, 0.02f, 300.0f);
+ForecastPoint temperatureForecast[FORECAST_HORIZON_COUNT];
+ForecastPoint humidityForecast[FORECAST_HORIZON_COUNT];
+ForecastAccuracy temperatureAccuracy;
+ForecastAccuracy humidityAccuracy;
+unsigned long lastForecastSnapshot = 0;
+const unsigned long FORECAST_SNAPSHOT_INTERVAL = 60000;  // Accuracy snapshots once per minute
+
+// Predictive alert thresholds - alerts fire when a forecast crosses them
+const float TEMPERATURE_ALERT_HIGH = 30.0f;
+const float TEMPERATURE_ALERT_LOW = 15.0f;
+const float HUMIDITY_ALERT_HIGH = 70.0f;
+const float HUMIDITY_ALERT_LOW = 30.0f;
+
+// Value histograms per series (indexed by QuerySeries) and rollup period
+const HistogramConfig DEFAULT_HISTOGRAM_CONFIG[QUERY_SERIES_COUNT] = {
+    { -10.0f, 1.0f, 60 },      // temperature: -10..50 °C
+    { 0.0f, 2.0f, 50 },        // humidity: 0..100 %
+    { -20.0f, 1.0f, 60 },      // dew_point: -20..40 °C
+    { 0.0f, 1.0f, 60 },        // heat_index: 0..60 °C
+    { 0.0f, 0.5f, 60 },        // absolute_humidity: 0..30 g/m³
+    { 0.0f, 0.1f, 40 }         // vpd: 0..4 kPa
+};
+SeriesHistograms seriesHistograms[QUERY_SERIES_COUNT];
+
+// Route handlers (defined below)
+void handleGetData(const RequestArgs& args);
+void handleHealthCheck(const RequestArgs& args);
+void handleStatus(const RequestArgs& args);
+void handleGetAnomalies(const RequestArgs& args);
+void handleGetSpectrum(const RequestArgs& args);
+void handleGetForecast(const RequestArgs& args);
+void handleQuery(const RequestArgs& args);
+void handleExportCSV(const RequestArgs& args);
+void handleExportNDJSON(const RequestArgs& args);
+void handleGetConfig(const RequestArgs& args);
+void handleSetConfig(const RequestArgs& args);
+void handleGetHistogram(const RequestArgs& args);
+void handleConfigureHistogram(const RequestArgs& args);
+void handleDeltaUpdate(const RequestArgs& args);
+void handleOtaStatus(const RequestArgs& args);
+void handleGetNodes(const RequestArgs& args);
+void handleGetStalls(const RequestArgs& args);
+void handleEvents(const RequestArgs& args);
+void handleRoot(const RequestArgs& args);
+
+// Query parameter schemas; the enums index the typed arguments
+enum SpectrumParam { SPECTRUM_ARG_BINS };
+constexpr ParamSpec SPECTRUM_PARAMS[] = {
+    { "bins", PARAM_TEXT }
+};
+
+enum QueryParam { QUERY_ARG_SERIES, QUERY_ARG_AGG, QUERY_ARG_BUCKET, QUERY_ARG_FROM, QUERY_ARG_TO };
+constexpr ParamSpec QUERY_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "agg", PARAM_TEXT },
+    { "bucket", PARAM_TEXT },
+    { "from", PARAM_UINT64 },
+    { "to", PARAM_UINT64 }
+};
+
+enum ExportParam { EXPORT_ARG_FROM_SEQ, EXPORT_ARG_TO_SEQ };
+constexpr ParamSpec EXPORT_PARAMS[] = {
+    { "from_seq", PARAM_UINT },
+    { "to_seq", PARAM_UINT }
+};
+
+enum HistogramParam { HISTOGRAM_ARG_SERIES, HISTOGRAM_ARG_PERIOD };
+constexpr ParamSpec HISTOGRAM_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "period", PARAM_TEXT }
+};
+
+enum NodesParam { NODES_ARG_NODE, NODES_ARG_LIMIT };
+constexpr ParamSpec NODES_PARAMS[] = {
+    { "node", PARAM_UINT },
+    { "limit", PARAM_UINT }
+};
+
+enum HistogramConfigParam { LAYOUT_ARG_SERIES, LAYOUT_ARG_MIN, LAYOUT_ARG_WIDTH, LAYOUT_ARG_BINS };
+constexpr ParamSpec HISTOGRAM_CONFIG_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "min", PARAM_FLOAT },
+    { "width", PARAM_FLOAT },
+    { "bins", PARAM_UINT }
+};
+
+#define ROUTE_PARAMS(schema) schema, (uint8_t)(sizeof(schema) / sizeof(schema[0]))
+
+/*
+ * HTTP routes - hashed into a collision-free table at compile time
+ * Each route carries its admission class and cost (expected loop time in
+ * ms): health > current values > history and exports.
+ */
+constexpr RouteSpec ROUTES[] = {
+    // Main data endpoint - returns current and historical sensor readings
+    { "/data", HTTP_VERB_GET, handleGetData, nullptr, 0, PRIORITY_CURRENT, 15, false },
+    
+    // Health check endpoint
+    { "/health", HTTP_VERB_GET, handleHealthCheck, nullptr, 0, PRIORITY_HEALTH, 1, false },
+    
+    // ESP32 status endpoint
+    { "/status", HTTP_VERB_GET, handleStatus, nullptr, 0, PRIORITY_HEALTH, 3, false },
+    
+    // Anomaly detector state and event log
+    { "/anomalies", HTTP_VERB_GET, handleGetAnomalies, nullptr, 0, PRIORITY_CURRENT, 5, false },
+    
+    // Dominant temperature oscillation (HVAC cycling)
+    { "/spectrum", HTTP_VERB_GET, handleGetSpectrum, ROUTE_PARAMS(SPECTRUM_PARAMS), PRIORITY_CURRENT, 3, false },
+    
+    // Short-horizon forecasts and predictive alerts
+    { "/forecast", HTTP_VERB_GET, handleGetForecast, nullptr, 0, PRIORITY_CURRENT, 3, false },
+    
+    // Generic bucketed aggregation over the history
+    { "/query", HTTP_VERB_GET, handleQuery, ROUTE_PARAMS(QUERY_PARAMS), PRIORITY_HISTORY, 40, false },
+    
+    // Full history bulk export (resumable by sequence range)
+    { "/export.csv", HTTP_VERB_GET, handleExportCSV, ROUTE_PARAMS(EXPORT_PARAMS), PRIORITY_HISTORY, 100, false },
+    { "/export.ndjson", HTTP_VERB_GET, handleExportNDJSON, ROUTE_PARAMS(EXPORT_PARAMS), PRIORITY_HISTORY, 100, false },
+    
+    // Runtime configuration stored in NVS
+    { "/config", HTTP_VERB_GET, handleGetConfig, nullptr, 0, PRIORITY_CURRENT, 2, false },
+    { "/config", HTTP_VERB_POST, handleSetConfig, nullptr, 0, PRIORITY_CURRENT, 2, false },
+    
+    // Value distributions per series and rollup period
+    { "/histogram", HTTP_VERB_GET, handleGetHistogram, ROUTE_PARAMS(HISTOGRAM_PARAMS), PRIORITY_HISTORY, 5, false },
+    { "/histogram/config", HTTP_VERB_POST, handleConfigureHistogram, ROUTE_PARAMS(HISTOGRAM_CONFIG_PARAMS), PRIORITY_CURRENT, 2, false },
+    
+    // Compressed firmware delta, applied while it downloads
+    { "/ota/delta", HTTP_VERB_POST, handleDeltaUpdate, nullptr, 0, PRIORITY_CURRENT, 1, true },
+    { "/ota/status", HTTP_VERB_GET, handleOtaStatus, nullptr, 0, PRIORITY_HEALTH, 1, false },
+    
+    // Readings collected from sensor nodes (gateway mode)
+    { "/nodes", HTTP_VERB_GET, handleGetNodes, ROUTE_PARAMS(NODES_PARAMS), PRIORITY_HISTORY, 10, false },
+    
+    // Loop stage latencies and the stall journal (kept across resets)
+    { "/stalls", HTTP_VERB_GET, handleGetStalls, nullptr, 0, PRIORITY_HEALTH, 3, false },
+    
+    // Readings pushed as server-sent events (low-latency power mode while attached)
+    { "/events", HTTP_VERB_GET, handleEvents, nullptr, 0, PRIORITY_CURRENT, 1, false },
+    
+    // Simple test page
+    { "/", HTTP_VERB_GET, handleRoot, nullptr, 0, PRIORITY_HEALTH, 1, false }
+};
+
+constexpr auto ROUTE_TABLE = makeRouteTable(ROUTES);
+static_assert(ROUTE_TABLE.valid(), "no collision-free seed for the route table");
+
 /*
  * Setup function - runs once when ESP32 starts
  */
@@ -63,25 +361,79 @@ void setup() {
     Serial.begin(115200);
     Serial.println("\n=== ESP32-S3 Environmental Monitor Starting ===");
     
+    // Load runtime configuration from NVS
+    if (loadDeviceConfig(deviceConfig, DEFAULT_DEVICE_CONFIG, MAX_READINGS)) {
+        Serial.println("Configuration loaded from NVS");
+    } else {
+        Serial.println("Using default configuration");
+    }
+    
     // Initialize DHT sensor
+    dht = DHT(deviceConfig.dhtPin, deviceConfig.dhtType);
     dht.begin();
     Serial.println("DHT sensor initialized");
     
-    // Connect to WiFi
-    connectToWiFi();
+    // A node has no web server to change its configuration back
+    checkNodeExit();
     
-    // Configure time synchronization (for proper timestamps)
-    configureTime();
+    if (deviceConfig.linkRole == LINK_ROLE_NODE) {
+        // Node: no association or servers, readings go to the gateway
+        beginNodeLink();
+    } else {
+        // Connect to WiFi
+        connectToWiFi();
+        
+        // Configure time synchronization (for proper timestamps)
+        configureTime();
+        
+        // Start the web server with the compile-time route table
+        server.begin(ROUTE_TABLE);
+        server.setAdmission(&admission, sampleSlackMs);
+        server.setStallMonitor(&stallMonitor, STALL_TASK_LOOP);
+        server.setPowerManager(&powerManager);
+        Serial.println("Web server started on port 80");
+        
+        // Start the HTTPS listener
+        secureServer.setPowerManager(&powerManager);
+        secureServer.on("/data", "application/json", provideSecureData);
+        if (secureServer.begin(TLS_SERVER_CERT_PEM, TLS_SERVER_KEY_PEM)) {
+            Serial.printf("HTTPS server started on port %d\n", TLS_SERVER_PORT);
+        } else {
+            Serial.println("HTTPS server disabled (no credentials or TLS unavailable)");
+        }
+        
+        if (deviceConfig.linkRole == LINK_ROLE_GATEWAY) {
+            beginNodeLink();
+        }
+    }
     
-    // Setup HTTP server routes
-    setupServerRoutes();
+    // Clock scaling and WiFi power save, once the radio is up
+    beginPowerManagement();
     
-    // Start the web server
-    server.begin();
-    Serial.println("Web server started on port 80");
+    // Memory pools and the static buffers of each subsystem
+    beginMemoryBudget();
     
     // Initialize historical data buffer
     initializeReadingsBuffer();
+    initializeFlashHistory();
+    
+    // Apply default histogram layouts
+    for (int i = 0; i < QUERY_SERIES_COUNT; i++) {
+        seriesHistograms[i].configure(DEFAULT_HISTOGRAM_CONFIG[i]);
+    }
+    
+    // Prepare FFT tables for spectral analysis
+    if (!spectralAnalyzer.begin()) {
+        Serial.println("Spectral analyzer initialization failed");
+    }
+    
+    // Keep this image if it was just installed by a delta update
+    if (DeltaOtaSession::confirmRunningImage()) {
+        Serial.println("Running image confirmed after update");
+    }
+    
+    // Start stall monitoring last, so setup time is not charged to the loop
+    beginStallMonitor();
     
     Serial.println("=== Setup Complete - Monitor Ready ===");
 }
@@ -90,20 +442,272 @@ void setup() {
  * Main loop function - runs continuously
  */
 void loop() {
+    // Read sensor data at specified intervals (always ahead of requests)
+    serviceSampler();
+    
     // Handle incoming HTTP requests
+    stallEnter(STALL_STAGE_HTTP);
     server.handleClient();
     
-    // Read sensor data at specified intervals
+    // Event streams: keep-alives, closed clients, low latency while any is attached
+    eventStream.service(millis());
+    powerManager.setStreaming(eventStream.clientCount() > 0, esp_timer_get_time());
+    stallLeave();
+    
+    // Collect frames from sensor nodes (gateway mode)
+    stallEnter(STALL_STAGE_NODE_LINK);
+    serviceNodeLink();
+    stallLeave();
+    
+    // Advance a firmware update by one bounded step
+    stallEnter(STALL_STAGE_OTA);
+    otaSession.service();
+    stallLeave();
+    if (otaSession.rebootDue()) {
+        Serial.println("Restarting into the updated firmware");
+        ESP.restart();
+    }
+    
+    // Refresh the spectrum on its own schedule, never per request
     unsigned long currentTime = millis();
-    if (currentTime - lastReading >= READING_INTERVAL) {
-        readAndStoreSensorData();
-        lastReading = currentTime;
+    if (currentTime - lastSpectrumUpdate >= SPECTRUM_UPDATE_INTERVAL) {
+        stallEnter(STALL_STAGE_SPECTRUM);
+        updateSpectrum();
+        stallLeave();
+        lastSpectrumUpdate = currentTime;
     }
     
     // Small delay to prevent watchdog issues
     delay(10);
 }
 
+/*
+ * Take a reading if one is due
+ * Also called from long-running handlers so sampling is never delayed;
+ * each call counts as progress for the stall monitor.
+ */
+void serviceSampler() {
+    unsigned long currentTime = millis();
+    if (currentTime - lastReading >= deviceConfig.readingIntervalMs) {
+        stallEnter(STALL_STAGE_SAMPLER);
+        powerManager.acquire(esp_timer_get_time());
+        readAndStoreSensorData();
+        lastReading = currentTime;
+        powerManager.release(esp_timer_get_time());
+        stallLeave();
+    } else {
+        stallMonitor.progress(STALL_TASK_LOOP, esp_timer_get_time());
+    }
+}
+
+/*
+ * Loop task stages for the stall monitor
+ */
+void stallEnter(StallStage stage) {
+    stallMonitor.enter(STALL_TASK_LOOP, stage, esp_timer_get_time());
+}
+
+void stallLeave() {
+    stallMonitor.leave(STALL_TASK_LOOP, esp_timer_get_time());
+}
+
+/*
+ * Adopt the stall journal left in no-init RAM and start the watcher
+ * After a panic or watchdog reset, the stage and request each task was in
+ * become fatal records.
+ */
+void beginStallMonitor() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool abnormal = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                    reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT;
+    uint8_t fatal = stallMonitor.begin(&stallJournal, reason != ESP_RST_POWERON, abnormal, (uint8_t)reason,
+                                       esp_timer_get_time());
+    for (uint8_t i = 0; i < fatal; i++) {
+        const StallRecord* record = stallMonitor.record(i);
+        if (record == nullptr) continue;
+        Serial.printf("Reset during a stall: task %s, stage %s, endpoint '%s' (stuck %lu ms, reset reason %d)\n",
+                      StallMonitor::taskName(record->task), StallMonitor::stageName(record->stage),
+                      record->endpoint, (unsigned long)record->durationMs, (int)reason);
+    }
+    
+    const esp_timer_create_args_t timerArgs = { watchStalls, nullptr, ESP_TIMER_TASK, "stall_watch" };
+    if (esp_timer_create(&timerArgs, &stallWatchTimer) == ESP_OK) {
+        esp_timer_start_periodic(stallWatchTimer, STALL_WATCH_INTERVAL_MS * 1000ULL);
+    }
+    Serial.printf("Stall monitor started (boot %lu, %u stalls in journal)\n",
+                  (unsigned long)stallMonitor.boot(), stallMonitor.recordCount());
+}
+
+/*
+ * Timer callback (esp_timer task): notes tasks stuck past STALL_HANG_MS
+ * so the duration survives if the watchdog resets the board
+ */
+void watchStalls(void* argument) {
+    if (!stallMonitor.watch(esp_timer_get_time())) return;
+    for (uint8_t task = 0; task < STALL_TASK_COUNT; task++) {
+        const StallTaskState* state = stallMonitor.taskState((StallTask)task);
+        if (state->hungMs == 0) continue;
+        Serial.printf("Stall: task %s stuck in %s for %lu ms (endpoint '%s')\n", StallMonitor::taskName(task),
+                      StallMonitor::stageName(state->stage), (unsigned long)state->hungMs, state->endpoint);
+    }
+}
+
+/*
+ * Apply the configured power mode
+ * A gateway keeps the radio listening in every mode, since ESP-NOW frames
+ * from nodes are only received while it is on.
+ */
+void beginPowerManagement() {
+    powerManager.begin(deviceConfig.powerMode, deviceConfig.linkRole == LINK_ROLE_GATEWAY, esp_timer_get_time());
+    Serial.printf("Power mode %s (%s), CPU at %lu MHz\n", powerModeName(powerManager.mode()),
+                  powerManager.scalingActive() ? "frequency scaling" : "fixed clocks",
+                  (unsigned long)getCpuFrequencyMhz());
+}
+
+/*
+ * Time left before the next sample is due (admission control defers any
+ * request that would not finish by then)
+ */
+uint32_t sampleSlackMs() {
+    unsigned long sinceLast = millis() - lastReading;
+    return (sinceLast >= deviceConfig.readingIntervalMs) ? 0 : deviceConfig.readingIntervalMs - sinceLast;
+}
+
+/*
+ * Way back from the node role: press BOOT within NODE_EXIT_WINDOW_MS of a
+ * reset and hold it for NODE_EXIT_HOLD_MS; the role is saved as standalone
+ * and the device starts WiFi and the web server. Also available on the
+ * serial console by sending "standalone" in that window.
+ */
+void checkNodeExit() {
+    if (deviceConfig.linkRole != LINK_ROLE_NODE) return;
+    
+    pinMode(NODE_EXIT_PIN, INPUT_PULLUP);
+    Serial.printf("Node role: hold BOOT or send \"standalone\" within %d s to leave it\n", NODE_EXIT_WINDOW_MS / 1000);
+    
+    char line[16];
+    size_t length = 0;
+    bool leave = false;
+    unsigned long start = millis();
+    unsigned long pressedAt = 0;
+    while (!leave && millis() - start < NODE_EXIT_WINDOW_MS + NODE_EXIT_HOLD_MS) {
+        if (digitalRead(NODE_EXIT_PIN) == LOW) {
+            if (pressedAt == 0) pressedAt = millis();
+            leave = millis() - pressedAt >= NODE_EXIT_HOLD_MS;
+        } else {
+            pressedAt = 0;
+            if (millis() - start >= NODE_EXIT_WINDOW_MS) break;
+        }
+        
+        while (Serial.available() > 0) {
+            char c = (char)Serial.read();
+            if (c == '\r' || c == '\n') {
+                line[length] = '\0';
+                leave = leave || strcmp(line, "standalone") == 0;
+                length = 0;
+            } else if (length < sizeof(line) - 1) {
+                line[length++] = c;
+            }
+        }
+        delay(10);
+    }
+    if (!leave) return;
+    
+    deviceConfig.linkRole = LINK_ROLE_STANDALONE;
+    if (saveDeviceConfig(deviceConfig)) {
+        Serial.println("Node role cleared, starting standalone");
+    } else {
+        Serial.println("Node role cleared for this boot (saving the configuration failed)");
+    }
+}
+
+/*
+ * Start the node link for the configured role
+ * A gateway stays on its access point's channel; a node tunes to the
+ * configured one, which must match it.
+ */
+void beginNodeLink() {
+    uint8_t mac[6];
+    WiFi.mode(WIFI_STA);
+    WiFi.macAddress(mac);
+    linkNodeId = deviceConfig.nodeId ? deviceConfig.nodeId : (uint16_t)((mac[4] << 8) | mac[5]);
+    linkSession = (uint8_t)esp_random();
+    nodeAggregator.begin(storeNodeBatch, nullptr);
+    
+    bool gateway = deviceConfig.linkRole == LINK_ROLE_GATEWAY;
+    if (nodeTransport.begin(gateway ? 0 : deviceConfig.linkChannel)) {
+        Serial.printf("Node link started as %s (node id %u, channel %d)\n", linkRoleName(deviceConfig.linkRole),
+                      linkNodeId, gateway ? WiFi.channel() : deviceConfig.linkChannel);
+    } else {
+        Serial.println("Node link failed to start");
+    }
+}
+
+/*
+ * Gateway: drain a bounded number of received frames into the aggregator
+ */
+void serviceNodeLink() {
+    if (deviceConfig.linkRole != LINK_ROLE_GATEWAY || !nodeTransport.running()) return;
+    
+    uint8_t frame[NODE_FRAME_SIZE];
+    size_t length = 0;
+    for (int i = 0; i < NODE_FRAMES_PER_LOOP && nodeTransport.receive(frame, length); i++) {
+        nodeAggregator.accept(frame, length, historyMillis());
+    }
+    nodeAggregator.service(historyMillis());
+}
+
+/*
+ * Batches of new node readings land in the per-node histories and, keyed
+ * by node id, in the flash log under the next local sequence (see
+ * FlashHistory.h), so they are exported with the gateway's own history
+ */
+void storeNodeBatch(void* context, const NodeReading* readings, size_t count) {
+    nodeHistory.add(readings, count);
+    if (!flashHistory.ready()) return;
+    
+    for (size_t i = 0; i < count; i++) {
+        const NodeReading& node = readings[i];
+        if (node.nodeId == 0) continue;         // Node id 0 is this monitor in the log
+        
+        SensorReading reading = {};
+        reading.sequence = nextSequence;
+        // Frames arrive late and batched; the log stays in time order
+        reading.timestamp = std::max(node.timestamp, flashHistory.lastTimestamp());
+        reading.temperature = node.temperature;
+        reading.humidity = node.humidity;
+        reading.isValid = true;
+        reading.temperatureFlags = node.temperatureFlags;
+        reading.humidityFlags = node.humidityFlags;
+        PsychrometricValues derived = computePsychrometrics(node.temperature, node.humidity);
+        reading.dewPoint = derived.dewPoint;
+        reading.heatIndex = derived.heatIndex;
+        reading.absoluteHumidity = derived.absoluteHumidity;
+        reading.vaporPressureDeficit = derived.vaporPressureDeficit;
+        flashHistory.append(reading, node.nodeId);
+        
+        // Appends can erase a sector each; keep the local sampling on schedule
+        serviceSampler();
+    }
+}
+
+/*
+ * Node: send a stored reading to the gateway as one frame
+ */
+void sendNodeReading(const SensorReading& reading) {
+    NodeReading outgoing = {};
+    outgoing.nodeId = linkNodeId;
+    outgoing.session = linkSession;
+    outgoing.sequence = reading.sequence;
+    outgoing.temperature = reading.temperature;
+    outgoing.humidity = reading.humidity;
+    outgoing.temperatureFlags = reading.temperatureFlags;
+    outgoing.humidityFlags = reading.humidityFlags;
+    
+    uint8_t frame[NODE_FRAME_SIZE];
+    nodeTransport.send(frame, encodeNodeFrame(outgoing, 0, frame));
+}
+
 /*
  * Connect to WiFi network with timeout and reconnection logic
  */
@@ -150,86 +754,200 @@ void configureTime() {
 }
 
 /*
- * Setup HTTP server routes and their handlers
+ * Serve a simple test page
  */
-void setupServerRoutes() {
-    // Main data endpoint - returns current and historical sensor readings
-    server.on("/data", HTTP_GET, handleGetData);
-    
-    // Health check endpoint
-    server.on("/health", HTTP_GET, handleHealthCheck);
-    
-    // ESP32 status endpoint
-    server.on("/status", HTTP_GET, handleStatus);
-    
-    // Serve a simple test page
-    server.on("/", HTTP_GET, []() {
-        server.send(200, "text/html", 
-            "<h1>ESP32-S3 Environmental Monitor</h1>"
-            "<p>Endpoints available:</p>"
-            "<ul>"
-            "<li><a href='/data'>/data</a> - Current and historical sensor readings</li>"
-            "<li><a href='/health'>/health</a> - Health check</li>"
-            "<li><a href='/status'>/status</a> - ESP32 status</li>"
-            "</ul>");
-    });
+void handleRoot(const RequestArgs& args) {
+    server.send(200, "text/html", 
+        "<h1>ESP32-S3 Environmental Monitor</h1>"
+        "<p>Endpoints available:</p>"
+        "<ul>"
+        "<li><a href='/data'>/data</a> - Current and historical sensor readings</li>"
+        "<li><a href='/health'>/health</a> - Health check</li>"
+        "<li><a href='/status'>/status</a> - ESP32 status</li>"
+        "<li><a href='/anomalies'>/anomalies</a> - Anomaly detectors and event log</li>"
+        "<li><a href='/spectrum'>/spectrum</a> - Temperature oscillation analysis</li>"
+        "<li><a href='/forecast'>/forecast</a> - 5-30 minute forecasts</li>"
+        "<li><a href='/query?series=temperature,humidity&agg=mean,min,max,count&bucket=60s'>/query</a> - Bucketed aggregation</li>"
+        "<li><a href='/histogram?series=temperature&period=day'>/histogram</a> - Value distributions</li>"
+        "<li><a href='/config'>/config</a> - Runtime configuration (POST JSON to change)</li>"
+        "<li><a href='/export.csv'>/export.csv</a>, <a href='/export.ndjson'>/export.ndjson</a> - Full history export</li>"
+        "<li><a href='/nodes'>/nodes</a> - Readings collected from sensor nodes (gateway mode)</li>"
+        "<li><a href='/stalls'>/stalls</a> - Loop stage latencies and stall history</li>"
+        "<li><a href='/events'>/events</a> - Live readings as server-sent events</li>"
+        "<li><a href='/ota/status'>/ota/status</a> - Firmware update progress (POST a delta to /ota/delta)</li>"
+        "<li>https://&lt;device&gt;/data - /data over TLS when credentials are configured</li>"
+        "</ul>");
+}
+
+/*
+ * Check a document drawn from the JSON pool; answers 503 if it was refused
+ */
+bool jsonReady(const PooledJsonDocument& doc) {
+    if (doc.capacity() > 0) return true;
+    memoryBudget.noteDegraded(MEMORY_JSON);
+    server.sendHeader("Retry-After", "1");
+    server.send(503, "text/plain", "Low memory");
+    return false;
+}
+
+/*
+ * Send a document as the response body
+ * The body is serialized into the HTTP pool and written at once; when the
+ * pool cannot hold it, it is serialized straight to the connection instead
+ * (more, smaller writes, but nothing to allocate).
+ */
+void sendJson(int code, const JsonDocument& doc) {
+    size_t length = measureJson(doc);
+    char* body = (char*)memoryBudget.allocate(MEMORY_HTTP, length + 1);
+    if (body != nullptr) {
+        serializeJson(doc, body, length + 1);
+        server.send(code, "application/json", body, length);
+        memoryBudget.release(body);
+        return;
+    }
     
-    // Handle 404 errors
-    server.onNotFound([]() {
-        server.send(404, "text/plain", "Endpoint not found");
-    });
+    memoryBudget.noteDegraded(MEMORY_HTTP);
+    server.setContentLength(length);
+    server.send(code, "application/json", "", 0);
+    serializeJson(doc, server.client());
 }
 
 /*
  * Handle GET request for sensor data
  * Returns JSON with current reading and historical data
  */
-void handleGetData() {
-    // Create JSON document for response
-    StaticJsonDocument<2048> doc;
+void handleGetData(const RequestArgs& args) {
+    HistoryView view = historySnapshot();
+    int page = dataHistoryPage(view);
+    PooledJsonDocument doc(dataDocumentCapacity(page), jsonPool);
+    if (!jsonReady(doc)) return;
+    
+    buildDataResponse(doc, view, page, getCurrentTemperature(), getCurrentHumidity());
+    sendJson(200, doc);
+}
+
+/*
+ * Body of /data over HTTPS
+ * Runs on the HTTPS task, so the current values come from the newest
+ * published reading instead of a second reader of the DHT bus.
+ */
+void provideSecureData(String& response) {
+    stallMonitor.enter(STALL_TASK_TLS, STALL_STAGE_TLS, esp_timer_get_time());
+    stallMonitor.beginRequest(STALL_TASK_TLS, "/data (https)", 0);
     
-    // Add current reading
-    float currentTemp = getCurrentTemperature();
-    float currentHumidity = getCurrentHumidity();
+    float currentTemp = NAN;
+    float currentHumidity = NAN;
+    HistoryView view = historySnapshot();
+    SensorReading newest;
+    if (view.count > 0 && readHistory(view.firstSequence + view.count - 1, newest)) {
+        currentTemp = newest.temperature;
+        currentHumidity = newest.humidity;
+    }
+    
+    int page = dataHistoryPage(view);
+    PooledJsonDocument doc(dataDocumentCapacity(page), jsonPool);
+    if (doc.capacity() > 0) {
+        buildDataResponse(doc, view, page, currentTemp, currentHumidity);
+        serializeJson(doc, response);
+    } else {
+        memoryBudget.noteDegraded(MEMORY_JSON);
+        response = "{\"error\":\"low memory\"}";
+    }
     
+    stallMonitor.endRequest(STALL_TASK_TLS);
+    stallMonitor.leave(STALL_TASK_TLS, esp_timer_get_time());
+}
+
+/*
+ * JSON pool bytes for a /data document with a history page of the given size
+ */
+size_t dataDocumentCapacity(int page) {
+    return DATA_DOCUMENT_BASE_BYTES + (size_t)page * DATA_READING_BYTES;
+}
+
+/*
+ * Readings in the /data history page: the newest dataHistoryLimit, or
+ * fewer (halved until the document fits) when the JSON pool is short
+ */
+int dataHistoryPage(const HistoryView& view) {
+    int wanted = std::min(view.count, (int)deviceConfig.dataHistoryLimit);
+    uint32_t room = memoryBudget.available(MEMORY_JSON);
+    int page = wanted;
+    while (page > 0 && dataDocumentCapacity(page) > room) page /= 2;
+    if (page < wanted) memoryBudget.noteDegraded(MEMORY_JSON);
+    return page;
+}
+
+/*
+ * Fill the /data document (current values, the newest page of history, metadata)
+ */
+void buildDataResponse(JsonDocument& doc, const HistoryView& view, int page, float currentTemp, float currentHumidity) {
     doc["current"]["temperature"] = currentTemp;
     doc["current"]["humidity"] = currentHumidity;
-    doc["current"]["timestamp"] = millis();
+    doc["current"]["timestamp"] = historyMillis();
     doc["current"]["timestamp_iso"] = getCurrentTimestampISO();
     
+    // Derived values for the current reading
+    if (!isnan(currentTemp) && !isnan(currentHumidity)) {
+        PsychrometricValues derived = computePsychrometrics(currentTemp, currentHumidity);
+        doc["current"]["dew_point"] = derived.dewPoint;
+        doc["current"]["heat_index"] = derived.heatIndex;
+        doc["current"]["absolute_humidity"] = derived.absoluteHumidity;
+        doc["current"]["vpd"] = derived.vaporPressureDeficit;
+    }
+    
     // Add historical readings
     JsonArray history = doc.createNestedArray("history");
     
-    int count = (readingCount < 100) ? readingCount : 100; // Send last 100 readings
-    int startIndex = (currentIndex - count + MAX_READINGS) % MAX_READINGS;
+    int count = page;   // Send the most recent readings
+    uint32_t firstSequence = view.firstSequence + (view.count - count);
     
-    for (int i = 0; i < count; i++) {
-        int idx = (startIndex + i) % MAX_READINGS;
-        if (readings[idx].isValid) {
+    SensorReading chunk[HISTORY_COPY_CHUNK];
+    for (int i = 0; i < count; ) {
+        int copied = copyHistory(firstSequence + i, chunk, std::min(count - i, HISTORY_COPY_CHUNK));
+        if (copied == 0) break;
+        i += copied;
+        
+        for (int j = 0; j < copied; j++) {
+            const SensorReading& stored = chunk[j];
+            if (!stored.isValid) continue;
+            
             JsonObject reading = history.createNestedObject();
-            reading["temperature"] = readings[idx].temperature;
-            reading["humidity"] = readings[idx].humidity;
-            reading["timestamp"] = readings[idx].timestamp;
-            reading["timestamp_iso"] = timestampToISO(readings[idx].timestamp);
+            reading["temperature"] = stored.temperature;
+            reading["humidity"] = stored.humidity;
+            reading["timestamp"] = stored.timestamp;
+            uint64_t epochMs = historyToEpochMillis(stored.timestamp);
+            if (epochMs != 0) reading["epoch_ms"] = epochMs;
+            reading["timestamp_iso"] = timestampToISO(stored.timestamp);
+            reading["dew_point"] = stored.dewPoint;
+            reading["heat_index"] = stored.heatIndex;
+            reading["absolute_humidity"] = stored.absoluteHumidity;
+            reading["vpd"] = stored.vaporPressureDeficit;
+            
+            // Anomaly flags: temperature in the low nibble, humidity in the high nibble
+            uint8_t flags = stored.temperatureFlags | (stored.humidityFlags << 4);
+            if (flags != ANOMALY_NONE) {
+                reading["anomaly"] = flags;
+            }
         }
     }
     
     // Add metadata
-    doc["metadata"]["total_readings"] = readingCount;
-    doc["metadata"]["buffer_size"] = MAX_READINGS;
+    doc["metadata"]["total_readings"] = view.count;
+    doc["metadata"]["buffer_size"] = deviceConfig.historySize;
     doc["metadata"]["uptime_seconds"] = millis() / 1000;
     doc["metadata"]["wifi_connected"] = (WiFi.status() == WL_CONNECTED);
     
-    // Send JSON response
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
+    // A short page means memory was tight; clients can ask again or use /export
+    doc["metadata"]["history_returned"] = history.size();
+    doc["metadata"]["history_limited"] = page < std::min(view.count, (int)deviceConfig.dataHistoryLimit);
 }
 
 /*
  * Handle health check endpoint
  */
-void handleHealthCheck() {
+void handleHealthCheck(const RequestArgs& args) {
+    // Small and on the stack, so health still answers when the JSON pool is exhausted
     StaticJsonDocument<200> doc;
     doc["status"] = "healthy";
     doc["uptime_seconds"] = millis() / 1000;
@@ -237,110 +955,1475 @@ void handleHealthCheck() {
     doc["wifi_connected"] = (WiFi.status() == WL_CONNECTED);
     doc["dht_status"] = (isDHTWorking() ? "ok" : "error");
     
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
+    sendJson(200, doc);
 }
 
 /*
  * Handle status endpoint
  */
-void handleStatus() {
-    StaticJsonDocument<300> doc;
+void handleStatus(const RequestArgs& args) {
+    PooledJsonDocument doc(4096, jsonPool);
+    if (!jsonReady(doc)) return;
     doc["device"] = "ESP32-S3 Environmental Monitor";
     doc["firmware_version"] = "1.0.0";
     doc["wifi_ssid"] = ssid;
     doc["ip_address"] = WiFi.localIP().toString();
     doc["uptime_seconds"] = millis() / 1000;
-    doc["total_readings"] = readingCount;
+    doc["total_readings"] = readings.size();
     doc["last_reading"] = getCurrentTimestampISO();
+    doc["reset_reason"] = (int)esp_reset_reason();
+    doc["history_recovered"] = historyRecovered;
+    doc["recovered_readings"] = recoveredReadings;
+    doc["recovery_validation_us"] = recoveryValidationMicros;
+    doc["flash_history"]["readings"] = flashHistory.storedReadings();
+    doc["flash_history"]["capacity"] = flashHistory.capacityReadings();
+    doc["flash_history"]["first_sequence"] = flashHistory.firstSequence();
+    doc["flash_history"]["last_sequence"] = flashHistory.lastSequence();
+    
+    JsonObject tls = doc.createNestedObject("tls");
+    tls["enabled"] = secureServer.running();
+    if (secureServer.running()) {
+        const TlsServerStats& tlsStats = secureServer.stats();
+        tls["port"] = TLS_SERVER_PORT;
+        tls["max_sessions"] = TLS_MAX_SESSIONS;
+        tls["session_tickets"] = secureServer.sessionTickets();
+        if (secureServer.handshakeStatsAvailable()) {
+            tls["handshakes"] = tlsStats.handshakes;
+        }
+        tls["resumption"] = "unavailable";      // esp_https_server does not report it
+        tls["requests"] = tlsStats.requests;
+        tls["bytes_sent"] = tlsStats.bytesSent;
+        tls["avg_send_us"] = secureServer.averageSendMicros();
+    }
+    
+    static const char* const PRIORITY_NAMES[PRIORITY_COUNT] = { "health", "current", "history" };
+    const AdmissionStats& admissionStats = admission.stats();
+    JsonObject budget = doc.createNestedObject("admission");
+    budget["level"] = admission.level();
+    budget["shed_total"] = admission.shedTotal();
+    budget["overruns"] = admissionStats.overruns;
+    for (uint8_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        JsonObject counts = budget.createNestedObject(PRIORITY_NAMES[priority]);
+        counts["admitted"] = admissionStats.admitted[priority];
+        counts["deferred"] = admissionStats.deferred[priority];
+        counts["shed_budget"] = admissionStats.shed[priority][SHED_GLOBAL_BUDGET];
+        counts["shed_client"] = admissionStats.shed[priority][SHED_CLIENT_BUDGET];
+    }
+    
+    JsonObject link = doc.createNestedObject("node_link");
+    link["role"] = linkRoleName(deviceConfig.linkRole);
+    if (nodeTransport.running()) {
+        link["node_id"] = linkNodeId;
+        link["send_failures"] = nodeTransport.sendFailures();
+        link["queue_drops"] = nodeTransport.queueDrops();
+        link["nodes"] = nodeAggregator.nodeCount();
+        link["frames"] = nodeAggregator.stats().frames;
+        link["bad_frames"] = nodeAggregator.stats().badFrames;
+    }
+    
+    JsonObject stalls = doc.createNestedObject("stalls");
+    stalls["boot"] = stallMonitor.boot();
+    stalls["since_boot"] = stallMonitor.stallTotal();
+    stalls["journal"] = stallMonitor.recordCount();
+    
+    // Measured per mode since boot; currents are datasheet figures weighted by the measured duty
+    static const char* const POWER_SAVE_NAMES[] = { "none", "min_modem", "max_modem" };
+    int64_t now = esp_timer_get_time();
+    JsonObject power = doc.createNestedObject("power");
+    power["mode"] = powerModeName(powerManager.mode());
+    power["effective_mode"] = powerModeName(powerManager.effectiveMode());
+    power["event_streams"] = eventStream.clientCount();
+    power["frequency_scaling"] = powerManager.scalingActive();
+    power["cpu_mhz"] = getCpuFrequencyMhz();
+    JsonObject modes = power.createNestedObject("modes");
+    for (uint8_t mode = 0; mode < POWER_MODE_COUNT; mode++) {
+        PowerModeProfile profile = powerManager.profile(mode);
+        PowerModeStats measured = powerManager.stats(mode, now);
+        JsonObject entry = modes.createNestedObject(powerModeName(mode));
+        entry["cpu_mhz_max"] = profile.maxMhz;
+        entry["cpu_mhz_idle"] = profile.minMhz;
+        entry["wifi_power_save"] = (profile.wifiPowerSave < 3) ? POWER_SAVE_NAMES[profile.wifiPowerSave] : "unknown";
+        entry["light_sleep"] = profile.lightSleep;
+        entry["wake_latency_ms"] = profile.wakeLatencyMs;
+        entry["time_s"] = (uint32_t)(measured.residencyMicros / 1000000ULL);
+        entry["busy_ratio"] = measured.residencyMicros ? (float)measured.busyMicros / measured.residencyMicros : 0.0f;
+        entry["requests"] = measured.requests;
+        entry["avg_request_us"] = measured.requests ? (uint32_t)(measured.requestMicros / measured.requests) : 0;
+        entry["max_request_us"] = measured.maxRequestMicros;
+        entry["estimated_ma"] = powerManager.estimatedCurrentMa(mode, now);
+    }
+    
+    // Static buffers and pool use per subsystem, and how close the heap is to its floor
+    JsonObject memory = doc.createNestedObject("memory");
+    memory["free_heap"] = ESP.getFreeHeap();
+    memory["min_free_heap"] = ESP.getMinFreeHeap();
+    memory["largest_block"] = largestHeapBlock();
+    memory["heap_floor"] = HEAP_FLOOR_BYTES;
+    memory["reserved"] = memoryBudget.totalReserved();
+    memory["pooled"] = memoryBudget.totalInUse();
+    for (uint8_t subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; subsystem++) {
+        const MemoryAccount& account = memoryBudget.account((MemorySubsystem)subsystem);
+        JsonObject entry = memory.createNestedObject(MemoryBudget::subsystemName(subsystem));
+        entry["reserved"] = account.reserved;
+        entry["budget"] = account.budget;
+        entry["in_use"] = account.inUse;
+        entry["high_water"] = account.highWater;
+        entry["allocations"] = account.allocations;
+        entry["refused"] = account.refused;
+        entry["degraded"] = account.degraded;
+    }
+    
+    OtaProgress ota = otaSession.progress();
+    doc["ota"]["state"] = DeltaOtaSession::stateName(ota.state);
+    if (ota.state != OTA_IDLE) {
+        doc["ota"]["received"] = ota.received;
+        doc["ota"]["patch_size"] = ota.patchSize;
+    }
     
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
+    sendJson(200, doc);
 }
 
 /*
- * Read sensor data and store in circular buffer
+ * Handle anomaly endpoint
+ * Returns the detector state per series and the recent event log
  */
-void readAndStoreSensorData() {
-    float temperature = dht.readTemperature();  // Temperature in Celsius
-    float humidity = dht.readHumidity();        // Humidity percentage
+void handleGetAnomalies(const RequestArgs& args) {
+    PooledJsonDocument doc(3072, jsonPool);
+    if (!jsonReady(doc)) return;
     
-    // Check if readings are valid (DHT sensors can occasionally return NaN)
-    if (isnan(temperature) || isnan(humidity)) {
-        Serial.println("Failed to read from DHT sensor!");
-        return;
-    }
+    JsonObject temperature = doc["detectors"].createNestedObject("temperature");
+    temperature["mean"] = temperatureDetector.mean();
+    temperature["std_dev"] = temperatureDetector.stdDev();
+    temperature["z_score"] = temperatureDetector.lastZScore();
+    temperature["cusum_high"] = temperatureDetector.cusumHigh();
+    temperature["cusum_low"] = temperatureDetector.cusumLow();
+    temperature["samples"] = temperatureDetector.samples();
+    
+    JsonObject humidity = doc["detectors"].createNestedObject("humidity");
+    humidity["mean"] = humidityDetector.mean();
+    humidity["std_dev"] = humidityDetector.stdDev();
+    humidity["z_score"] = humidityDetector.lastZScore();
+    humidity["cusum_high"] = humidityDetector.cusumHigh();
+    humidity["cusum_low"] = humidityDetector.cusumLow();
+    humidity["samples"] = humidityDetector.samples();
     
-    // Store reading in circular buffer
-    readings[currentIndex].temperature = temperature;
-    readings[currentIndex].humidity = humidity;
-    readings[currentIndex].timestamp = millis();
-    readings[currentIndex].isValid = true;
+    // Flag bit meanings so clients do not hardcode them
+    doc["flag_bits"]["outlier"] = ANOMALY_OUTLIER;
+    doc["flag_bits"]["level_shift"] = ANOMALY_LEVEL_SHIFT;
+    doc["flag_bits"]["stuck"] = ANOMALY_STUCK;
+    doc["flag_bits"]["rate"] = ANOMALY_RATE;
     
-    // Update circular buffer index
-    currentIndex = (currentIndex + 1) % MAX_READINGS;
-    if (readingCount < MAX_READINGS) {
-        readingCount++;
+    doc["total_events"] = anomalyLog.totalEvents();
+    JsonArray events = doc.createNestedArray("events");
+    for (size_t i = 0; i < anomalyLog.size(); i++) {
+        const AnomalyEvent& event = anomalyLog.at(i);
+        JsonObject entry = events.createNestedObject();
+        entry["series"] = (event.series == ANOMALY_SERIES_TEMPERATURE) ? "temperature" : "humidity";
+        entry["flags"] = event.flags;
+        entry["value"] = event.value;
+        entry["z_score"] = event.zScore;
+        entry["timestamp"] = event.timestamp;
     }
     
-    // Print readings to serial for debugging
-    Serial.printf("Reading %d: %.1f°C, %.1f%%\n", readingCount, temperature, humidity);
+    sendJson(200, doc);
 }
 
 /*
- * Initialize the readings buffer with invalid data
+ * Handle spectrum endpoint
+ * Serves the last scheduled analysis (status says why there is none);
+ * add ?bins=1 for the amplitude spectrum
  */
-void initializeReadingsBuffer() {
-    for (int i = 0; i < MAX_READINGS; i++) {
-        readings[i].isValid = false;
+void handleGetSpectrum(const RequestArgs& args) {
+    PooledJsonDocument doc(4096, jsonPool);
+    if (!jsonReady(doc)) return;
+    
+    doc["valid"] = spectralResult.valid;
+    doc["status"] = spectrumStatus;
+    doc["backend"] = spectralAnalyzer.backend();
+    doc["window_samples"] = SPECTRUM_SIZE;
+    doc["readings_per_sample"] = spectrumDecimation();
+    doc["max_period_seconds"] = SPECTRUM_MAX_PERIOD_SECONDS;
+    float samplePeriod = (deviceConfig.readingIntervalMs * spectrumDecimation()) / 1000.0f;
+    doc["sample_period_seconds"] = samplePeriod;
+    doc["window_seconds"] = SPECTRUM_SIZE * samplePeriod;
+    
+    if (spectralResult.valid) {
+        doc["dominant_period_seconds"] = spectralResult.dominantPeriodSeconds;
+        doc["dominant_frequency_hz"] = spectralResult.dominantFrequencyHz;
+        doc["dominant_amplitude"] = spectralResult.dominantAmplitude;
+        doc["peak_to_mean_ratio"] = spectralResult.peakToMeanRatio;
+    }
+    
+    doc["cost"]["runs"] = spectrumRuns;
+    doc["cost"]["cycles"] = lastSpectrumCycles;
+    doc["cost"]["microseconds"] = lastSpectrumMicros;
+    doc["cost"]["age_seconds"] = (millis() - lastSpectrumUpdate) / 1000;
+    
+    if (args.has(SPECTRUM_ARG_BINS) && spectralResult.valid) {
+        JsonArray bins = doc.createNestedArray("amplitudes");
+        const float* amplitudes = spectralAnalyzer.amplitudes();
+        for (int i = 0; i < SPECTRUM_BINS; i++) {
+            bins.add(amplitudes[i]);
+        }
     }
-    currentIndex = 0;
-    readingCount = 0;
-    Serial.println("Readings buffer initialized");
+    
+    sendJson(200, doc);
 }
 
 /*
- * Get current temperature reading
+ * Add one series' forecasts, accuracy and predictive alerts to a JSON object
  */
-float getCurrentTemperature() {
-    return dht.readTemperature();
+void addSeriesForecast(JsonObject series, const HoltForecaster& forecaster,
+                       const ForecastPoint* forecast, const ForecastAccuracy& accuracy,
+                       float alertLow, float alertHigh) {
+    series["level"] = forecaster.level();
+    series["trend_per_minute"] = forecaster.trendPerMinute();
+    series["residual_std_dev"] = forecaster.residualStdDev();
+    
+    JsonArray points = series.createNestedArray("horizons");
+    for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+        JsonObject point = points.createNestedObject();
+        point["minutes"] = FORECAST_HORIZON_MINUTES[i];
+        point["value"] = forecast[i].value;
+        point["lower"] = forecast[i].lower;
+        point["upper"] = forecast[i].upper;
+        point["source"] = (accuracy.source(i) == FORECAST_SOURCE_HOLT) ? "holt" : "persistence";
+        point["mae"] = accuracy.meanAbsoluteError(i);
+        point["holt_mae"] = accuracy.holtError(i);
+        point["persistence_mae"] = accuracy.persistenceError(i);
+        point["band_coverage"] = accuracy.bandCoverage(i);
+        point["alerts"] = accuracy.trusted(i);
+        point["evaluations"] = accuracy.evaluations(i);
+        point["missed"] = accuracy.missed(i);
+    }
+    
+    // Earliest horizon at which the forecast crosses a threshold, among those
+    // that beat persistence with calibrated bands
+    for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+        if (!accuracy.trusted(i)) continue;
+        
+        const char* direction = nullptr;
+        if (forecast[i].value >= alertHigh) direction = "high";
+        else if (forecast[i].value <= alertLow) direction = "low";
+        
+        if (direction) {
+            series["alert"]["direction"] = direction;
+            series["alert"]["minutes"] = FORECAST_HORIZON_MINUTES[i];
+            series["alert"]["forecast"] = forecast[i].value;
+            series["alert"]["threshold"] = (direction[0] == 'h') ? alertHigh : alertLow;
+            break;
+        }
+    }
 }
 
 /*
- * Get current humidity reading
+ * Handle forecast endpoint
+ * Forecasts are refreshed at sample time, so this is constant time
  */
-float getCurrentHumidity() {
-    return dht.readHumidity();
+void handleGetForecast(const RequestArgs& args) {
+    PooledJsonDocument doc(3072, jsonPool);
+    if (!jsonReady(doc)) return;
+    
+    doc["ready"] = temperatureForecaster.ready() && humidityForecaster.ready();
+    doc["samples"] = temperatureForecaster.samples();
+    
+    if (temperatureForecaster.ready()) {
+        addSeriesForecast(doc.createNestedObject("temperature"), temperatureForecaster,
+                          temperatureForecast, temperatureAccuracy,
+                          TEMPERATURE_ALERT_LOW, TEMPERATURE_ALERT_HIGH);
+    }
+    if (humidityForecaster.ready()) {
+        addSeriesForecast(doc.createNestedObject("humidity"), humidityForecaster,
+                          humidityForecast, humidityAccuracy,
+                          HUMIDITY_ALERT_LOW, HUMIDITY_ALERT_HIGH);
+    }
+    
+    sendJson(200, doc);
 }
 
 /*
- * Check if DHT sensor is working
+ * Update forecasters with a new sample and refresh the cached horizons
+ * (Holt or persistence per horizon, as the accuracy tracking decides)
  */
-bool isDHTWorking() {
-    float temp = dht.readTemperature();
-    return !isnan(temp);
+void updateForecasts(float temperature, float humidity, unsigned long timestamp) {
+    temperatureForecaster.update(temperature, timestamp);
+    humidityForecaster.update(humidity, timestamp);
+    
+    ForecastPoint temperatureHolt[FORECAST_HORIZON_COUNT];
+    ForecastPoint humidityHolt[FORECAST_HORIZON_COUNT];
+    for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+        float horizonSeconds = FORECAST_HORIZON_MINUTES[i] * 60.0f;
+        temperatureHolt[i] = temperatureForecaster.forecast(horizonSeconds);
+        humidityHolt[i] = humidityForecaster.forecast(horizonSeconds);
+        temperatureForecast[i] = temperatureAccuracy.serve(i, temperatureHolt[i], temperature);
+        humidityForecast[i] = humidityAccuracy.serve(i, humidityHolt[i], humidity);
+    }
+    
+    if (!temperatureForecaster.ready()) return;
+    
+    // Every sample scores the snapshots whose horizon has elapsed
+    temperatureAccuracy.score(temperature, timestamp);
+    humidityAccuracy.score(humidity, timestamp);
+    
+    // Snapshots are timestamped, so scoring does not depend on the reading interval
+    if (timestamp - lastForecastSnapshot >= FORECAST_SNAPSHOT_INTERVAL) {
+        temperatureAccuracy.addSnapshot(timestamp, temperatureForecast, temperatureHolt, temperature);
+        humidityAccuracy.addSnapshot(timestamp, humidityForecast, humidityHolt, humidity);
+        lastForecastSnapshot = timestamp;
+    }
 }
 
-/*
+// Output buffer for streamed (chunked) responses - queries and exports
+struct ResponseStream {
+    char buffer[2048];
+    size_t length;
+    bool firstBucket;
+};
+ResponseStream responseStream;
+
+/*
+ * Send buffered output as one chunk
+ */
+void flushResponseStream(ResponseStream& stream) {
+    if (stream.length > 0) {
+        server.sendContent(stream.buffer, stream.length);
+        stream.length = 0;
+    }
+}
+
+/*
+ * Append text to the response stream, flushing when the buffer is full
+ */
+void appendResponseStream(ResponseStream& stream, const char* text, size_t length) {
+    if (stream.length + length > sizeof(stream.buffer)) {
+        flushResponseStream(stream);
+    }
+    memcpy(stream.buffer + stream.length, text, length);
+    stream.length += length;
+}
+
+/*
+ * Format into a fixed row buffer; length stays at the buffer end after a truncation
+ */
+void appendQueryRow(char* row, size_t size, size_t* length, const char* format, ...) {
+    if (*length >= size - 1) return;
+    
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(row + *length, size - *length, format, args);
+    va_end(args);
+    
+    if (written < 0) return;
+    *length = std::min(*length + (size_t)written, size - 1);
+}
+
+/*
+ * Serialize one finished bucket as a JSON object
+ */
+void emitQueryBucket(uint64_t bucketStart, const BucketAccumulator* accumulators,
+                     const QuerySpec& spec, void* context) {
+    ResponseStream& stream = *static_cast<ResponseStream*>(context);
+    char row[1280];                            // Fits all series x all aggregations
+    size_t length = 0;
+    appendQueryRow(row, sizeof(row), &length, "%s{\"t\":%llu", stream.firstBucket ? "" : ",",
+                   (unsigned long long)bucketStart);
+    
+    for (uint8_t series = 0; series < QUERY_SERIES_COUNT; series++) {
+        if (!(spec.seriesMask & (1u << series))) continue;
+        
+        appendQueryRow(row, sizeof(row), &length, ",\"%s\":{", querySeriesName(series));
+        bool firstValue = true;
+        for (uint8_t agg = 0; agg < QUERY_AGG_TOTAL; agg++) {
+            if (!(spec.aggregationMask & (1u << agg))) continue;
+            
+            const char* separator = firstValue ? "" : ",";
+            if (agg == QUERY_AGG_COUNT) {
+                appendQueryRow(row, sizeof(row), &length, "%s\"%s\":%lu", separator,
+                               queryAggregationName(agg), (unsigned long)accumulators[series].count);
+            } else {
+                appendQueryRow(row, sizeof(row), &length, "%s\"%s\":%.2f", separator,
+                               queryAggregationName(agg), bucketAggregationValue(accumulators[series], agg));
+            }
+            firstValue = false;
+        }
+        appendQueryRow(row, sizeof(row), &length, "}");
+    }
+    appendQueryRow(row, sizeof(row), &length, "}");
+    
+    appendResponseStream(stream, row, length);
+    stream.firstBucket = false;
+}
+
+#define QUERY_RECORDS_PER_CHUNK 256            // Flash records aggregated between sampler checks
+
+/*
+ * Handle query endpoint
+ * /query?series=temperature,humidity&agg=mean,min,max,count&bucket=60s&from=&to=
+ * Evaluated in one pass over flash then the RAM ring, each entered by a binary
+ * search on from and left once past to; buckets are streamed as they close.
+ * The flash pass can cover every segment, so the sampler runs between chunks.
+ */
+void handleQuery(const RequestArgs& args) {
+    QuerySpec spec;
+    spec.fromMs = args.u64(QUERY_ARG_FROM, 0);
+    spec.toMs = args.u64(QUERY_ARG_TO, UINT64_MAX);
+    
+    const char* error = nullptr;
+    if (!parseSeriesList(args.text(QUERY_ARG_SERIES, "temperature,humidity"), &spec.seriesMask)) {
+        error = "unknown series";
+    } else if (!parseAggregationList(args.text(QUERY_ARG_AGG, "mean"), &spec.aggregationMask)) {
+        error = "unknown aggregation";
+    } else if (!parseBucketDuration(args.text(QUERY_ARG_BUCKET, "60s"), &spec.bucketMs)) {
+        error = "invalid bucket";
+    } else if (spec.fromMs > spec.toMs) {
+        error = "from is after to";
+    }
+    
+    // A bucket longer than everything that can be retained is one bucket anyway
+    uint64_t historySpan = (uint64_t)(flashHistory.capacityReadings() + deviceConfig.historySize) * deviceConfig.readingIntervalMs;
+    if (spec.bucketMs > historySpan) spec.bucketMs = (unsigned long)historySpan;
+    
+    if (error) {
+        StaticJsonDocument<128> doc;
+        doc["error"] = error;
+        sendJson(400, doc);
+        return;
+    }
+    
+    // Stream the response with chunked encoding
+    server.setContentLength(HTTP_CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    ResponseStream& stream = responseStream;
+    stream.length = 0;
+    stream.firstBucket = true;
+    
+    char header[96];
+    size_t headerLength = snprintf(header, sizeof(header), "{\"bucket_ms\":%lu,\"buckets\":[", spec.bucketMs);
+    appendResponseStream(stream, header, headerLength);
+    
+    BucketAggregator aggregator(spec, emitQueryBucket, &stream);
+    HistoryView view = historySnapshot();
+    
+    // Persisted readings older than the RAM ring, read in place from mapped flash
+    // from the first one inside the range (binary search on time) until past it;
+    // a gateway's node readings in the log are not part of these series
+    uint32_t ramFirstSequence = view.firstSequence;
+    FlashCursor cursor = { flashHistory.sequenceAtTime(spec.fromMs), 0 };
+    bool pastRange = false;
+    while (!pastRange && cursor.sequence != 0 && cursor.sequence < ramFirstSequence) {
+        // Sampling may reclaim a segment, so the cursor is located again after it
+        serviceSampler();
+        ramFirstSequence = historySnapshot().firstSequence;
+        
+        size_t remaining = 0;
+        const StoredReading* records = flashHistory.locate(cursor, &remaining);
+        if (records == nullptr) break;
+        
+        if (remaining > QUERY_RECORDS_PER_CHUNK) remaining = QUERY_RECORDS_PER_CHUNK;
+        for (size_t i = 0; i < remaining && !pastRange; i++) {
+            const StoredReading& record = records[i];
+            bool valid = FlashHistory::recordValid(record);
+            if (valid && record.sequence >= ramFirstSequence) {
+                cursor.sequence = ramFirstSequence;
+                break;
+            }
+            cursor.advance(record, valid);
+            if (!valid || record.nodeId != 0) continue;
+            pastRange = storedTimestamp(record) > spec.toMs;
+            if (!pastRange) aggregator.add(record);
+        }
+    }
+    
+    // RAM ring from the first reading inside the range (binary search on time)
+    uint32_t lastSequence = view.firstSequence + view.count - 1;
+    uint32_t sequence = historySequenceAt(spec.fromMs);
+    SensorReading chunk[HISTORY_COPY_CHUNK];
+    while (!pastRange && view.count > 0 && sequence <= lastSequence) {
+        int copied = copyHistory(sequence, chunk, std::min(lastSequence - sequence + 1, (uint32_t)HISTORY_COPY_CHUNK));
+        if (copied == 0) break;
+        sequence += copied;
+        for (int i = 0; i < copied && !pastRange; i++) {
+            if (!chunk[i].isValid) continue;
+            pastRange = chunk[i].timestamp > spec.toMs;
+            if (!pastRange) aggregator.add(chunk[i]);
+        }
+    }
+    aggregator.finish();
+    
+    char footer[96];
+    size_t footerLength = snprintf(footer, sizeof(footer), "],\"buckets_returned\":%lu,\"readings_scanned\":%lu}",
+                                   (unsigned long)aggregator.bucketsEmitted(),
+                                   (unsigned long)aggregator.readingsScanned());
+    appendResponseStream(stream, footer, footerLength);
+    flushResponseStream(stream);
+    server.sendContent("");
+}
+
+/*
+ * Handle histogram endpoint
+ * /histogram?series=temperature&period=day - bins are sample counts,
+ * multiply by seconds_per_sample for time spent in each bin.
+ */
+void handleGetHistogram(const RequestArgs& args) {
+    uint8_t seriesMask = 0;
+    uint8_t period = HISTOGRAM_PERIOD_TOTAL;
+    
+    // Exactly one series per request
+    if (!parseSeriesList(args.text(HISTOGRAM_ARG_SERIES, "temperature"), &seriesMask) ||
+        (seriesMask & (seriesMask - 1)) != 0) {
+        server.send(400, "application/json", "{\"error\":\"unknown series\"}");
+        return;
+    }
+    if (args.has(HISTOGRAM_ARG_PERIOD) && !parseHistogramPeriod(args.text(HISTOGRAM_ARG_PERIOD, ""), &period)) {
+        server.send(400, "application/json", "{\"error\":\"unknown period\"}");
+        return;
+    }
+    
+    uint8_t series = 0;
+    while (!(seriesMask & (1u << series))) series++;
+    
+    const ValueHistogram& histogram = seriesHistograms[series].period(period);
+    const HistogramConfig& layout = histogram.config();
+    
+    PooledJsonDocument doc(2048, jsonPool);
+    if (!jsonReady(doc)) return;
+    doc["series"] = querySeriesName(series);
+    doc["period"] = histogramPeriodName(period);
+    doc["min"] = layout.minValue;
+    doc["bin_width"] = layout.binWidth;
+    doc["seconds_per_sample"] = deviceConfig.readingIntervalMs / 1000.0f;
+    doc["samples"] = histogram.samples();
+    doc["underflow"] = histogram.underflow();
+    doc["overflow"] = histogram.overflow();
+    
+    JsonArray bins = doc.createNestedArray("bins");
+    for (int i = 0; i < layout.binCount; i++) {
+        bins.add(histogram.bin(i));
+    }
+    
+    sendJson(200, doc);
+}
+
+/*
+ * Handle histogram configuration
+ * POST /histogram/config?series=temperature&min=-10&width=0.5&bins=64
+ * Changing the layout resets that series' histograms.
+ */
+void handleConfigureHistogram(const RequestArgs& args) {
+    uint8_t seriesMask = 0;
+    if (!args.has(LAYOUT_ARG_SERIES) || !parseSeriesList(args.text(LAYOUT_ARG_SERIES, ""), &seriesMask)) {
+        server.send(400, "application/json", "{\"error\":\"unknown series\"}");
+        return;
+    }
+    
+    for (uint8_t series = 0; series < QUERY_SERIES_COUNT; series++) {
+        if (!(seriesMask & (1u << series))) continue;
+        
+        HistogramConfig layout = seriesHistograms[series].period(HISTOGRAM_PERIOD_TOTAL).config();
+        layout.minValue = args.f32(LAYOUT_ARG_MIN, layout.minValue);
+        layout.binWidth = args.f32(LAYOUT_ARG_WIDTH, layout.binWidth);
+        if (args.has(LAYOUT_ARG_BINS)) layout.binCount = (uint8_t)std::min(args.u32(LAYOUT_ARG_BINS, 0), (uint32_t)255);
+        
+        if (!histogramConfigValid(layout)) {
+            server.send(400, "application/json", "{\"error\":\"invalid histogram layout\"}");
+            return;
+        }
+        seriesHistograms[series].configure(layout);
+    }
+    
+    server.send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+/*
+ * Handle a firmware delta upload
+ * POST /ota/delta with the patch from tools/delta_tool as the body. The
+ * connection is handed to the OTA session, which reads and applies the
+ * patch from loop() and answers once the new image has been verified.
+ */
+void handleDeltaUpdate(const RequestArgs& args) {
+    WiFiClient client = server.detach();
+    const char* refusal = otaSession.start(client, args.contentLength(), args.body(), args.bodyLength());
+    if (refusal != nullptr) {
+        Serial.printf("OTA refused: %s\n", refusal);
+    } else {
+        Serial.printf("OTA started: %u byte delta\n", (unsigned)args.contentLength());
+    }
+}
+
+/*
+ * Handle OTA progress endpoint
+ */
+void handleOtaStatus(const RequestArgs& args) {
+    OtaProgress ota = otaSession.progress();
+    PooledJsonDocument doc(384, jsonPool);
+    if (!jsonReady(doc)) return;
+    doc["state"] = DeltaOtaSession::stateName(ota.state);
+    doc["patch_size"] = ota.patchSize;
+    doc["received"] = ota.received;
+    doc["image_size"] = ota.imageSize;
+    doc["written"] = ota.written;
+    doc["elapsed_ms"] = ota.elapsedMs;
+    doc["max_step_us"] = ota.maxStepMicros;
+    if (ota.error != nullptr) doc["error"] = ota.error;
+    
+    sendJson(200, doc);
+}
+
+/*
+ * Handle node readings endpoint (gateway mode)
+ * GET /nodes lists every node with its newest reading and link counters;
+ * GET /nodes?node=<id>&limit=<n> adds that node's readings, oldest first.
+ */
+void handleGetNodes(const RequestArgs& args) {
+    bool selected = args.has(NODES_ARG_NODE);
+    uint32_t wanted = args.u32(NODES_ARG_NODE, 0);
+    uint32_t limit = std::min(args.u32(NODES_ARG_LIMIT, NODE_HISTORY_SIZE), (uint32_t)NODE_HISTORY_SIZE);
+    if (selected && nodeHistory.find((uint16_t)wanted) < 0) {
+        server.send(404, "application/json", "{\"error\":\"unknown node\"}");
+        return;
+    }
+    
+    server.setContentLength(HTTP_CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    ResponseStream& stream = responseStream;
+    stream.length = 0;
+    
+    char text[256];
+    const NodeAggregatorStats& linkStats = nodeAggregator.stats();
+    size_t length = snprintf(text, sizeof(text),
+                             "{\"role\":\"%s\",\"frames\":%lu,\"bad_frames\":%lu,\"batches\":%lu,\"nodes\":[",
+                             linkRoleName(deviceConfig.linkRole), (unsigned long)linkStats.frames,
+                             (unsigned long)linkStats.badFrames, (unsigned long)linkStats.batches);
+    appendResponseStream(stream, text, length);
+    
+    uint64_t now = historyMillis();
+    bool first = true;
+    for (uint8_t index = 0; index < nodeHistory.nodeCount(); index++) {
+        uint16_t nodeId = nodeHistory.nodeId(index);
+        uint16_t count = nodeHistory.readingCount(index);
+        if ((selected && nodeId != wanted) || count == 0) continue;
+        
+        const NodeReading& newest = nodeHistory.reading(index, 0);
+        length = snprintf(text, sizeof(text),
+                          "%s{\"node_id\":%u,\"readings\":%u,\"temperature\":%.2f,\"humidity\":%.2f,"
+                          "\"timestamp\":%llu,\"age_ms\":%llu",
+                          first ? "" : ",", nodeId, count, newest.temperature, newest.humidity,
+                          (unsigned long long)newest.timestamp, (unsigned long long)(now - newest.timestamp));
+        appendResponseStream(stream, text, length);
+        first = false;
+        
+        for (uint8_t i = 0; i < nodeAggregator.nodeCount(); i++) {
+            const NodeLinkStats* link = nodeAggregator.node(i);
+            if (link->nodeId != nodeId) continue;
+            length = snprintf(text, sizeof(text),
+                              ",\"link\":{\"accepted\":%lu,\"duplicates\":%lu,\"lost\":%lu,\"stale\":%lu,\"restarts\":%lu}",
+                              (unsigned long)link->accepted, (unsigned long)link->duplicates,
+                              (unsigned long)link->lost, (unsigned long)link->stale, (unsigned long)link->restarts);
+            appendResponseStream(stream, text, length);
+        }
+        
+        if (selected) {
+            appendResponseStream(stream, ",\"history\":[", 12);
+            uint16_t returned = std::min((uint32_t)count, limit);
+            for (int age = returned - 1; age >= 0; age--) {
+                const NodeReading& reading = nodeHistory.reading(index, age);
+                length = snprintf(text, sizeof(text),
+                                  "{\"sequence\":%lu,\"timestamp\":%llu,\"temperature\":%.2f,\"humidity\":%.2f}%s",
+                                  (unsigned long)reading.sequence, (unsigned long long)reading.timestamp,
+                                  reading.temperature, reading.humidity, age > 0 ? "," : "");
+                appendResponseStream(stream, text, length);
+            }
+            appendResponseStream(stream, "]", 1);
+        }
+        appendResponseStream(stream, "}", 1);
+    }
+    
+    appendResponseStream(stream, "]}", 2);
+    flushResponseStream(stream);
+    server.sendContent("");
+}
+
+/*
+ * Handle event stream endpoint
+ * The connection is kept by the event stream; each new reading is pushed
+ * to it as a "reading" event.
+ */
+void handleEvents(const RequestArgs& args) {
+    WiFiClient client = server.detach();
+    if (eventStream.attach(client)) {
+        Serial.printf("Event stream attached (%u open)\n", eventStream.clientCount());
+    }
+    powerManager.setStreaming(eventStream.clientCount() > 0, esp_timer_get_time());
+}
+
+/*
+ * Push a stored reading to the event stream clients
+ */
+void publishReadingEvent(const SensorReading& reading) {
+    if (eventStream.clientCount() == 0) return;
+    char data[224];
+    snprintf(data, sizeof(data),
+             "{\"sequence\":%lu,\"timestamp\":%llu,\"temperature\":%.1f,\"humidity\":%.1f,\"dew_point\":%.2f,"
+             "\"heat_index\":%.2f,\"temperature_flags\":%u,\"humidity_flags\":%u}",
+             (unsigned long)reading.sequence, (unsigned long long)reading.timestamp, reading.temperature,
+             reading.humidity, reading.dewPoint, reading.heatIndex, reading.temperatureFlags, reading.humidityFlags);
+    eventStream.publish("reading", data);
+}
+
+/*
+ * Handle stall endpoint
+ * Per-stage maximum gap between progress points, what each task is doing
+ * now, and the stall journal (newest first, including earlier boots)
+ */
+void handleGetStalls(const RequestArgs& args) {
+    server.setContentLength(HTTP_CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    
+    ResponseStream& stream = responseStream;
+    stream.length = 0;
+    
+    char text[256];
+    int64_t now = esp_timer_get_time();
+    size_t length = snprintf(text, sizeof(text), "{\"boot\":%lu,\"hang_threshold_ms\":%d,\"stages\":[",
+                             (unsigned long)stallMonitor.boot(), STALL_HANG_MS);
+    appendResponseStream(stream, text, length);
+    
+    for (uint8_t stage = 0; stage < STALL_STAGE_COUNT; stage++) {
+        const StallStageStats& stats = stallMonitor.stageStats((StallStage)stage);
+        length = snprintf(text, sizeof(text),
+                          "%s{\"stage\":\"%s\",\"threshold_ms\":%lu,\"entries\":%lu,\"stalls\":%lu,\"max_gap_ms\":%.1f}",
+                          stage ? "," : "", StallMonitor::stageName(stage),
+                          (unsigned long)StallMonitor::thresholdMs(STALL_TASK_LOOP, (StallStage)stage),
+                          (unsigned long)stats.entries, (unsigned long)stats.stalls, stats.maxGapMicros / 1000.0f);
+        appendResponseStream(stream, text, length);
+    }
+    
+    appendResponseStream(stream, "],\"tasks\":[", 11);
+    for (uint8_t task = 0; task < STALL_TASK_COUNT; task++) {
+        const StallTaskState* state = stallMonitor.taskState((StallTask)task);
+        if (state == nullptr) break;
+        length = snprintf(text, sizeof(text),
+                          "%s{\"task\":\"%s\",\"stage\":\"%s\",\"endpoint\":\"%s\",\"since_progress_ms\":%lu}",
+                          task ? "," : "", StallMonitor::taskName(task), StallMonitor::stageName(state->stage),
+                          state->endpoint, (unsigned long)(((uint32_t)now - state->lastProgress) / 1000));
+        appendResponseStream(stream, text, length);
+    }
+    
+    appendResponseStream(stream, "],\"stalls\":[", 12);
+    bool first = true;
+    for (uint8_t age = 0; age < stallMonitor.recordCount(); age++) {
+        const StallRecord* record = stallMonitor.record(age);
+        if (record == nullptr) continue;   // Damaged by the reset
+        uint32_t client = record->client;
+        length = snprintf(text, sizeof(text),
+                          "%s{\"boot\":%lu,\"uptime_ms\":%lu,\"duration_ms\":%lu,\"task\":\"%s\",\"stage\":\"%s\","
+                          "\"endpoint\":\"%s\",\"client\":\"%u.%u.%u.%u\",\"hung\":%s,\"fatal\":%s",
+                          first ? "" : ",", (unsigned long)record->boot, (unsigned long)record->uptimeMs,
+                          (unsigned long)record->durationMs, StallMonitor::taskName(record->task),
+                          StallMonitor::stageName(record->stage), record->endpoint,
+                          client & 0xFF, (client >> 8) & 0xFF, (client >> 16) & 0xFF, client >> 24,
+                          (record->flags & STALL_FLAG_HUNG) ? "true" : "false",
+                          (record->flags & STALL_FLAG_FATAL) ? "true" : "false");
+        appendResponseStream(stream, text, length);
+        if (record->flags & STALL_FLAG_FATAL) {
+            length = snprintf(text, sizeof(text), ",\"reset_reason\":%u", record->resetReason);
+            appendResponseStream(stream, text, length);
+        }
+        appendResponseStream(stream, "}", 1);
+        first = false;
+    }
+    
+    appendResponseStream(stream, "]}", 2);
+    flushResponseStream(stream);
+    server.sendContent("");
+}
+
+// Export formats
+enum ExportFormat {
+    EXPORT_CSV,
+    EXPORT_NDJSON
+};
+
+#define EXPORT_RECORDS_PER_CHUNK 32            // Records formatted between sampler checks
+
+/*
+ * Format one record as a CSV row or NDJSON line
+ */
+size_t formatExportRecord(char* out, size_t size, ExportFormat format, const StoredReading& record) {
+    if (format == EXPORT_CSV) {
+        return snprintf(out, size, "%lu,%u,%llu,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%u,%u\n",
+                        (unsigned long)record.sequence, record.nodeId, (unsigned long long)storedTimestamp(record),
+                        record.temperature, record.humidity, record.dewPoint, record.heatIndex,
+                        record.absoluteHumidity, record.vaporPressureDeficit,
+                        record.temperatureFlags, record.humidityFlags);
+    }
+    return snprintf(out, size,
+                    "{\"sequence\":%lu,\"node_id\":%u,\"timestamp\":%llu,\"temperature\":%.2f,\"humidity\":%.2f,"
+                    "\"dew_point\":%.2f,\"heat_index\":%.2f,\"absolute_humidity\":%.2f,\"vpd\":%.3f,"
+                    "\"temperature_flags\":%u,\"humidity_flags\":%u}\n",
+                    (unsigned long)record.sequence, record.nodeId, (unsigned long long)storedTimestamp(record),
+                    record.temperature, record.humidity, record.dewPoint, record.heatIndex,
+                    record.absoluteHumidity, record.vaporPressureDeficit,
+                    record.temperatureFlags, record.humidityFlags);
+}
+
+/*
+ * Stream the whole history with chunked encoding: the flash log, which also
+ * holds a gateway's node readings (node_id > 0), then readings only in the
+ * RAM ring (no flash partition, or appends failing)
+ * ?from_seq=&to_seq= selects a sequence range, so an interrupted download
+ * resumes with from_seq = last received sequence + 1; node readings sit
+ * under the next local sequence, so a received sequence is complete.
+ * Memory use is one fixed chunk buffer, and the sampler runs between chunks.
+ */
+void streamExport(ExportFormat format, const RequestArgs& args) {
+    uint32_t ramFirst = historySnapshot().firstSequence;
+    uint32_t oldest = (flashHistory.storedReadings() > 0 && flashHistory.firstSequence() < ramFirst)
+                      ? flashHistory.firstSequence() : ramFirst;
+    
+    uint32_t first = args.u32(EXPORT_ARG_FROM_SEQ, oldest);
+    uint32_t last = args.u32(EXPORT_ARG_TO_SEQ, nextSequence - 1);
+    if (first < oldest) first = oldest;
+    if (last > nextSequence - 1) last = nextSequence - 1;  // Readings taken during the export are not included
+    
+    server.sendHeader("X-First-Sequence", String(first));
+    server.sendHeader("X-Last-Sequence", String(last));
+    server.setContentLength(HTTP_CONTENT_LENGTH_UNKNOWN);
+    server.send(200, (format == EXPORT_CSV) ? "text/csv" : "application/x-ndjson", "");
+    
+    ResponseStream& stream = responseStream;
+    stream.length = 0;
+    if (format == EXPORT_CSV) {
+        const char* header = "sequence,node_id,timestamp,temperature,humidity,dew_point,heat_index,"
+                             "absolute_humidity,vpd,temperature_flags,humidity_flags\n";
+        appendResponseStream(stream, header, strlen(header));
+    }
+    
+    char row[320];
+    FlashCursor cursor = { first, 0 };
+    bool fromFlash = flashHistory.storedReadings() > 0;
+    while (cursor.sequence <= last && server.client().connected()) {
+        // Keep sampling on schedule while the export runs
+        serviceSampler();
+        
+        int produced = 0;
+        if (fromFlash) {
+            // Read in place from mapped flash; located again each chunk as
+            // sampling may reclaim the oldest segment
+            size_t remaining = 0;
+            const StoredReading* records = flashHistory.locate(cursor, &remaining);
+            if (records == nullptr) {
+                fromFlash = false;      // Past the end of the log
+                continue;
+            }
+            for (size_t i = 0; i < remaining && produced < EXPORT_RECORDS_PER_CHUNK; i++) {
+                const StoredReading& record = records[i];
+                bool valid = FlashHistory::recordValid(record);
+                if (valid && record.sequence > last) {
+                    cursor.sequence = last + 1;
+                    break;
+                }
+                cursor.advance(record, valid);
+                if (!valid) continue;
+                appendResponseStream(stream, row, formatExportRecord(row, sizeof(row), format, record));
+                produced++;
+            }
+        } else {
+            // RAM ring, copied a block at a time through the seqlock
+            StoredReading record;
+            SensorReading chunk[HISTORY_COPY_CHUNK];
+            uint32_t chunkStart = cursor.sequence;
+            while (cursor.sequence <= last && produced < EXPORT_RECORDS_PER_CHUNK) {
+                int copied = copyHistory(cursor.sequence, chunk,
+                                         std::min(last - cursor.sequence + 1, (uint32_t)HISTORY_COPY_CHUNK));
+                if (copied == 0) break;
+                for (int i = 0; i < copied; i++) {
+                    cursor.sequence++;
+                    if (!chunk[i].isValid) continue;
+                    toStoredReading(chunk[i], record);
+                    appendResponseStream(stream, row, formatExportRecord(row, sizeof(row), format, record));
+                    produced++;
+                }
+            }
+            if (cursor.sequence == chunkStart) break;
+        }
+        
+        flushResponseStream(stream);
+        yield();
+    }
+    
+    flushResponseStream(stream);
+    server.sendContent("");
+}
+
+void handleExportCSV(const RequestArgs& args) {
+    streamExport(EXPORT_CSV, args);
+}
+
+void handleExportNDJSON(const RequestArgs& args) {
+    streamExport(EXPORT_NDJSON, args);
+}
+
+/*
+ * Serialize the active configuration
+ */
+void addDeviceConfig(JsonObject target, const DeviceConfig& config) {
+    target["reading_interval_ms"] = config.readingIntervalMs;
+    target["history_size"] = config.historySize;
+    target["history_capacity"] = MAX_READINGS;
+    target["data_history_limit"] = config.dataHistoryLimit;
+    target["dht_pin"] = config.dhtPin;
+    target["dht_type"] = config.dhtType;
+    target["link_role"] = linkRoleName(config.linkRole);
+    target["link_channel"] = config.linkChannel;
+    target["node_id"] = config.nodeId;
+    target["power_mode"] = powerModeName(config.powerMode);
+}
+
+/*
+ * Handle GET /config
+ */
+void handleGetConfig(const RequestArgs& args) {
+    PooledJsonDocument doc(384, jsonPool);
+    if (!jsonReady(doc)) return;
+    addDeviceConfig(doc.to<JsonObject>(), deviceConfig);
+    
+    sendJson(200, doc);
+}
+
+/*
+ * Handle POST /config with a JSON body of the fields to change
+ * The merged configuration is validated as a whole before anything is applied.
+ */
+void handleSetConfig(const RequestArgs& args) {
+    // Both documents up front, so nothing is applied if there is no memory to answer
+    PooledJsonDocument body(384, jsonPool);
+    if (!jsonReady(body)) return;
+    PooledJsonDocument doc(448, jsonPool);
+    if (!jsonReady(doc)) return;
+    if (deserializeJson(body, args.body(), args.bodyLength()) != DeserializationError::Ok) {
+        server.send(400, "application/json", "{\"error\":\"invalid JSON body\"}");
+        return;
+    }
+    
+    DeviceConfig next = deviceConfig;
+    next.readingIntervalMs = body["reading_interval_ms"] | next.readingIntervalMs;
+    next.historySize = body["history_size"] | next.historySize;
+    next.dataHistoryLimit = body["data_history_limit"] | next.dataHistoryLimit;
+    next.dhtPin = body["dht_pin"] | next.dhtPin;
+    next.dhtType = body["dht_type"] | next.dhtType;
+    next.linkChannel = body["link_channel"] | next.linkChannel;
+    next.nodeId = body["node_id"] | next.nodeId;
+    
+    const char* error = nullptr;
+    const char* role = body["link_role"];
+    const char* power = body["power_mode"];
+    if (role != nullptr && !parseLinkRole(role, &next.linkRole)) {
+        error = "link_role must be standalone, gateway or node";
+    } else if (power != nullptr && !parsePowerMode(power, &next.powerMode)) {
+        error = "power_mode must be performance, balanced or low_power";
+    } else {
+        error = validateDeviceConfig(next, MAX_READINGS);
+    }
+    if (error) {
+        doc["error"] = error;
+        sendJson(400, doc);
+        return;
+    }
+    
+    // The node link is set up once at boot
+    bool restartRequired = next.linkRole != deviceConfig.linkRole ||
+                           next.linkChannel != deviceConfig.linkChannel ||
+                           next.nodeId != deviceConfig.nodeId;
+    
+    applyDeviceConfig(next);
+    bool saved = saveDeviceConfig(deviceConfig);
+    
+    addDeviceConfig(doc.createNestedObject("config"), deviceConfig);
+    doc["saved"] = saved;
+    doc["restart_required"] = restartRequired;
+    doc["total_readings"] = readings.size();
+    
+    sendJson(200, doc);
+}
+
+/*
+ * Apply a validated configuration without rebooting
+ */
+void applyDeviceConfig(const DeviceConfig& next) {
+    if (next.historySize != deviceConfig.historySize) {
+        resizeHistory(next.historySize);
+    }
+    
+    if (next.dhtPin != deviceConfig.dhtPin || next.dhtType != deviceConfig.dhtType) {
+        dht = DHT(next.dhtPin, next.dhtType);
+        dht.begin();
+        temperatureDetector.reset();
+        humidityDetector.reset();
+        Serial.printf("DHT sensor reconfigured: pin %d, type %d\n", next.dhtPin, next.dhtType);
+    }
+    
+    if (next.powerMode != deviceConfig.powerMode) {
+        powerManager.setMode(next.powerMode, esp_timer_get_time());
+        Serial.printf("Power mode: %s\n", powerModeName(next.powerMode));
+    }
+    
+    // The sampler picks the new interval up on its next check
+    deviceConfig = next;
+    Serial.printf("Configuration applied: interval %lu ms, history %d\n",
+                  (unsigned long)deviceConfig.readingIntervalMs, deviceConfig.historySize);
+}
+
+/*
+ * Resize the history ring, keeping the newest readings
+ * Only the ring's window changes; no reading moves.
+ */
+void resizeHistory(int newSize) {
+    historyLock.writeBegin();
+    readings.setLimit(newSize);
+    deviceConfig.historySize = newSize;
+    historyLock.writeEnd();
+    
+    uint64_t newest = readings.empty() ? historyMillis() : readings.newest().timestamp;
+    saveHistoryCheckpoint(newest);
+}
+
+/*
+ * Readings averaged per FFT sample, so that the window holds two of the
+ * longest cycles looked for (the peak search starts at bin 2): 8 at the
+ * default 1 s interval, a 34 min window
+ */
+uint32_t spectrumDecimation() {
+    uint64_t windowMs = 2ULL * SPECTRUM_MAX_PERIOD_SECONDS * 1000;
+    uint64_t sampleMs = (uint64_t)SPECTRUM_SIZE * deviceConfig.readingIntervalMs;
+    return (uint32_t)((windowMs + sampleMs - 1) / sampleMs);
+}
+
+// Averages groups of readings into FFT samples for updateSpectrum()
+struct SpectrumDecimator {
+    uint32_t decimation;
+    int samples;
+    uint32_t grouped;
+    float sum;
+    float previous;                            // Stands in for slots without a reading
+    
+    void add(bool valid, float temperature) {
+        if (valid) previous = temperature;
+        sum += previous;
+        if (++grouped == decimation) {
+            spectrumInput[samples++] = sum / decimation;
+            grouped = 0;
+            sum = 0.0f;
+        }
+    }
+    
+    bool full() const { return samples == SPECTRUM_SIZE; }
+};
+
+/*
+ * Run the spectral analysis over the most recent temperature history
+ * Groups of spectrumDecimation() readings are averaged into one FFT sample.
+ * At short intervals the window outgrows the RAM ring, so the readings come
+ * from the flash log (this monitor's records only) when there is one.
+ */
+void updateSpectrum() {
+    const uint32_t decimation = spectrumDecimation();
+    const uint32_t needed = SPECTRUM_SIZE * decimation;
+    SpectrumDecimator decimator = { decimation, 0, 0, 0.0f, 0.0f };
+    
+    if (!flashHistory.ready() && deviceConfig.historySize < needed) {
+        spectrumStatus = "disabled: history too short";
+        spectralResult.valid = false;
+        return;
+    }
+    
+    uint32_t startCycles = ESP.getCycleCount();
+    unsigned long startMicros = micros();
+    
+    uint32_t firstSequence = (nextSequence > needed) ? nextSequence - needed : 0;
+    if (flashHistory.ready()) {
+        FlashCursor cursor = { firstSequence, 0 };
+        bool covered = firstSequence != 0 && flashHistory.storedReadings() > 0 &&
+                       flashHistory.firstSequence() <= firstSequence;
+        while (covered && !decimator.full()) {
+            size_t remaining = 0;
+            const StoredReading* records = flashHistory.locate(cursor, &remaining);
+            if (records == nullptr) break;
+            for (size_t i = 0; i < remaining && !decimator.full(); i++) {
+                const StoredReading& record = records[i];
+                bool valid = FlashHistory::recordValid(record);
+                cursor.advance(record, valid);
+                if (valid && record.nodeId == 0) decimator.add(true, record.temperature);
+            }
+        }
+    } else {
+        HistoryView view = historySnapshot();
+        uint32_t sequence = view.firstSequence + (view.count - needed);
+        SensorReading chunk[HISTORY_COPY_CHUNK];
+        while (view.count >= (int)needed && !decimator.full()) {
+            int copied = copyHistory(sequence, chunk, HISTORY_COPY_CHUNK);
+            if (copied == 0) break;
+            sequence += copied;
+            for (int i = 0; i < copied && !decimator.full(); i++) {
+                decimator.add(chunk[i].isValid, chunk[i].temperature);
+            }
+        }
+    }
+    if (!decimator.full()) {
+        spectrumStatus = "collecting";         // Not a full window of history yet
+        spectralResult.valid = false;
+        return;
+    }
+    
+    float samplePeriod = (deviceConfig.readingIntervalMs * decimation) / 1000.0f;
+    spectralResult = spectralAnalyzer.analyze(spectrumInput, samplePeriod);
+    spectrumStatus = "ok";
+    
+    lastSpectrumCycles = ESP.getCycleCount() - startCycles;
+    lastSpectrumMicros = micros() - startMicros;
+    spectrumRuns++;
+}
+
+/*
+ * Read sensor data and store in circular buffer
+ */
+void readAndStoreSensorData() {
+    float temperature = dht.readTemperature();  // Temperature in Celsius
+    float humidity = dht.readHumidity();        // Humidity percentage
+    
+    // Check if readings are valid (DHT sensors can occasionally return NaN)
+    if (isnan(temperature) || isnan(humidity)) {
+        Serial.println("Failed to read from DHT sensor!");
+        return;
+    }
+    
+    uint64_t timestamp = historyMillis();
+    
+    // Run streaming anomaly detectors (flagged readings are still stored). The
+    // detectors and forecasters only use time differences, so they take the
+    // low 32 bits of the clock, which stay correct across the wrap.
+    uint8_t temperatureFlags = temperatureDetector.update(temperature, timestamp);
+    uint8_t humidityFlags = humidityDetector.update(humidity, timestamp);
+    anomalyLog.record(ANOMALY_SERIES_TEMPERATURE, temperatureFlags, temperature,
+                      temperatureDetector.lastZScore(), timestamp);
+    anomalyLog.record(ANOMALY_SERIES_HUMIDITY, humidityFlags, humidity,
+                      humidityDetector.lastZScore(), timestamp);
+    
+    // Derived psychrometric series, computed once here for every consumer
+    PsychrometricValues derived = computePsychrometrics(temperature, humidity);
+    
+    // Store reading in circular buffer (published to readers through the seqlock)
+    historyLock.writeBegin();
+    SensorReading& stored = readings.push();
+    stored.sequence = nextSequence++;
+    stored.temperature = temperature;
+    stored.humidity = humidity;
+    stored.timestamp = timestamp;
+    stored.isValid = true;
+    stored.temperatureFlags = temperatureFlags;
+    stored.humidityFlags = humidityFlags;
+    stored.dewPoint = derived.dewPoint;
+    stored.heatIndex = derived.heatIndex;
+    stored.absoluteHumidity = derived.absoluteHumidity;
+    stored.vaporPressureDeficit = derived.vaporPressureDeficit;
+    sealReading(stored);
+    historyLock.writeEnd();
+    
+    // Persist to the flash segment log
+    if (flashHistory.ready() && !flashHistory.append(stored)) {
+        Serial.println("Flash history append failed");
+    }
+    
+    // O(1) histogram updates for every series
+    uint32_t epochSeconds = (uint32_t)time(nullptr);
+    for (uint8_t series = 0; series < QUERY_SERIES_COUNT; series++) {
+        seriesHistograms[series].add(querySeriesValue(stored, series), epochSeconds);
+    }
+    
+    // Header is rewritten after the record, so a reset in between only loses this reading
+    saveHistoryCheckpoint(timestamp);
+    
+    // Nodes forward every reading to their gateway
+    if (deviceConfig.linkRole == LINK_ROLE_NODE) {
+        sendNodeReading(stored);
+    }
+    
+    // Refresh forecasts so /forecast never computes on request
+    updateForecasts(temperature, humidity, timestamp);
+    
+    // Push to attached event stream clients
+    publishReadingEvent(stored);
+    
+    // Print readings to serial for debugging
+    Serial.printf("Reading %lu: %.1f°C, %.1f%%\n", (unsigned long)readings.size(), temperature, humidity);
+    if (temperatureFlags != ANOMALY_NONE || humidityFlags != ANOMALY_NONE) {
+        Serial.printf("Anomaly flags: temperature=0x%02X humidity=0x%02X\n", temperatureFlags, humidityFlags);
+    }
+}
+
+/*
+ * Heap probes for the memory budget's floor check
+ */
+size_t freeHeapBytes() {
+    return ESP.getFreeHeap();
+}
+
+size_t largestHeapBlock() {
+    return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+}
+
+/*
+ * Set the pool budgets and declare each subsystem's static buffers
+ */
+void beginMemoryBudget() {
+    memoryBudget.setBudget(MEMORY_JSON, JSON_POOL_BYTES);
+    memoryBudget.setBudget(MEMORY_HTTP, HTTP_POOL_BYTES);
+    memoryBudget.setHeapFloor(HEAP_FLOOR_BYTES, freeHeapBytes, largestHeapBlock);
+    
+    memoryBudget.reserve(MEMORY_HISTORY, sizeof(readings) + sizeof(historyCheckpoint) + sizeof(nodeHistory) +
+                                         sizeof(seriesHistograms));
+    memoryBudget.reserve(MEMORY_HTTP, sizeof(server) + sizeof(responseStream) + sizeof(otaSession));
+    memoryBudget.reserve(MEMORY_LOGGING, sizeof(anomalyLog) + sizeof(stallJournal));
+    memoryBudget.reserve(MEMORY_NETWORK, sizeof(eventStream) + sizeof(nodeAggregator) + sizeof(nodeTransport));
+    if (nodeTransport.running()) {
+        memoryBudget.reserve(MEMORY_NETWORK, ESPNOW_RX_QUEUE_LENGTH * (NODE_FRAME_SIZE + 1));
+    }
+    Serial.printf("Memory: %lu bytes static, pools json %d / http %d, heap floor %d, %lu free\n",
+                  (unsigned long)memoryBudget.totalReserved(), JSON_POOL_BYTES, HTTP_POOL_BYTES, HEAP_FLOOR_BYTES,
+                  (unsigned long)ESP.getFreeHeap());
+}
+
+/*
+ * Initialize the readings buffer
+ * After a warm reboot the no-init ring is validated and resumed;
+ * after power-on or a failed validation it is cleared.
+ */
+void initializeReadingsBuffer() {
+    unsigned long startMicros = micros();
+    
+    HistoryRecovery recovery = {};
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason != ESP_RST_POWERON) {
+        recovery = recoverHistory(historyCheckpoint, readings.storage(), MAX_READINGS);
+    }
+    recoveryValidationMicros = micros() - startMicros;
+    
+    if (recovery.recovered && readings.restore(recovery.head, recovery.readingCount, recovery.historySize)) {
+        // Continue the history clock past the last stored reading, adding the
+        // downtime when the wall clock knows it
+        unsigned long gap = deviceConfig.readingIntervalMs;
+        time_t now = time(nullptr);
+        if (recovery.lastEpochSeconds != 0 && now > (time_t)recovery.lastEpochSeconds) {
+            gap = (unsigned long)(now - recovery.lastEpochSeconds) * 1000UL;
+        }
+        historyTimeOffset = recovery.lastTimestamp + gap - uptimeMillis();
+        
+        // Adopt the recovered layout, then migrate to the configured size
+        uint16_t configuredSize = deviceConfig.historySize;
+        deviceConfig.historySize = recovery.historySize;
+        if (configuredSize != recovery.historySize) {
+            resizeHistory(configuredSize);
+        }
+        
+        historyRecovered = true;
+        recoveredReadings = readings.size();
+        Serial.printf("History recovered: %d readings (reset reason %d, validated in %lu us)\n",
+                      recoveredReadings, (int)reason, recoveryValidationMicros);
+    } else {
+        SensorReading* slots = readings.storage();
+        for (int i = 0; i < MAX_READINGS; i++) {
+            slots[i].isValid = false;
+        }
+        readings.clear(deviceConfig.historySize);
+        historyTimeOffset = 0;
+        Serial.printf("Readings buffer initialized (reset reason %d, no usable history)\n", (int)reason);
+    }
+    
+    saveHistoryCheckpoint(historyMillis());
+}
+
+/*
+ * Snapshot of the ring's head and count, consistent with each other
+ */
+HistoryView historySnapshot() {
+    HistoryView view;
+    uint32_t start;
+    do {
+        start = historyLock.readBegin();
+        view.size = readings.limit();
+        view.count = readings.size();
+        view.firstSequence = (view.count > 0) ? readings.oldest().sequence : nextSequence;
+    } while (historyLock.readRetry(start));
+    return view;
+}
+
+/*
+ * Copy the reading with the given sequence number
+ * Returns false if it has been overwritten or not taken yet. The copy is
+ * retried only when the sampler published a write while it was being made.
+ */
+bool readHistory(uint32_t sequence, SensorReading& out) {
+    while (true) {
+        uint32_t start = historyLock.readBegin();
+        uint32_t count = readings.size();
+        uint32_t newestSequence = (count > 0) ? readings.newest().sequence : 0;
+        
+        bool present = count > 0 && sequence <= newestSequence && newestSequence - sequence < count;
+        if (present) {
+            out = readings.newest(newestSequence - sequence);
+        }
+        if (!historyLock.readRetry(start)) {
+            return present && out.isValid;
+        }
+    }
+}
+
+/*
+ * Copy up to maxCount consecutive readings starting at a sequence number
+ * One seqlock read covering at most two block copies; returns the number
+ * copied (0 if the first is not in the ring). Callers skip !isValid slots.
+ */
+int copyHistory(uint32_t firstSequence, SensorReading* out, int maxCount) {
+    while (true) {
+        uint32_t start = historyLock.readBegin();
+        uint32_t count = readings.size();
+        uint32_t oldestSequence = (count > 0) ? readings.oldest().sequence : 0;
+        
+        uint32_t copied = 0;
+        if (count > 0 && firstSequence >= oldestSequence && firstSequence - oldestSequence < count) {
+            copied = readings.copy(firstSequence - oldestSequence, out, (uint32_t)maxCount);
+        }
+        if (!historyLock.readRetry(start)) {
+            return (int)copied;
+        }
+    }
+}
+
+/*
+ * Sequence of the first RAM reading taken at or after timestamp (history
+ * clock); the sequence after the newest if there is none
+ */
+uint32_t historySequenceAt(uint64_t timestamp) {
+    while (true) {
+        uint32_t start = historyLock.readBegin();
+        uint32_t count = readings.size();
+        uint32_t index = readings.lowerBound(timestamp);
+        uint32_t sequence = (count > 0) ? readings.oldest().sequence + index : nextSequence;
+        if (!historyLock.readRetry(start)) {
+            return sequence;
+        }
+    }
+}
+
+/*
+ * Map the flash history partition and continue its sequence and clock
+ */
+void initializeFlashHistory() {
+    if (!flashHistory.begin(FLASH_HISTORY_PARTITION)) {
+        Serial.println("Flash history partition not available - RAM history only");
+        return;
+    }
+    
+    if (!readings.empty()) {
+        nextSequence = readings.newest().sequence + 1;
+    }
+    // Node readings last in the log hold the sequence the next local reading takes
+    uint32_t flashNext = flashHistory.lastSequence() + ((flashHistory.lastNodeId() == 0) ? 1 : 0);
+    if (flashNext > nextSequence) {
+        nextSequence = flashNext;
+    }
+    
+    // After a cold boot, keep the history clock ahead of what flash already holds
+    if (!historyRecovered && flashHistory.lastTimestamp() >= historyMillis()) {
+        historyTimeOffset = flashHistory.lastTimestamp() + deviceConfig.readingIntervalMs - uptimeMillis();
+    }
+    
+    Serial.printf("Flash history: %lu readings in %u segments (capacity %lu)\n",
+                  (unsigned long)flashHistory.storedReadings(), (unsigned)flashHistory.segments(),
+                  (unsigned long)flashHistory.capacityReadings());
+}
+
+/*
+ * Rewrite the checkpoint header for the current ring state
+ */
+void saveHistoryCheckpoint(uint64_t lastTimestamp) {
+    time_t now = time(nullptr);
+    uint32_t epochSeconds = (now > 8 * 3600 * 2) ? (uint32_t)now : 0;
+    updateCheckpoint(historyCheckpoint, MAX_READINGS, deviceConfig.historySize,
+                     readings.headPosition(), readings.size(), lastTimestamp, epochSeconds);
+}
+
+/*
+ * Milliseconds since boot from the 64-bit esp_timer (millis() wraps at 2^32)
+ */
+uint64_t uptimeMillis() {
+    return (uint64_t)esp_timer_get_time() / 1000;
+}
+
+/*
+ * History clock in milliseconds - continues across recovered warm reboots
+ */
+uint64_t historyMillis() {
+    return uptimeMillis() + historyTimeOffset;
+}
+
+/*
+ * Get current temperature reading
+ */
+float getCurrentTemperature() {
+    return dht.readTemperature();
+}
+
+/*
+ * Get current humidity reading
+ */
+float getCurrentHumidity() {
+    return dht.readHumidity();
+}
+
+/*
+ * Check if DHT sensor is working
+ */
+bool isDHTWorking() {
+    float temp = dht.readTemperature();
+    return !isnan(temp);
+}
+
+/*
  * Get current timestamp in ISO format
  */
 String getCurrentTimestampISO() {
     time_t now = time(nullptr);
-    struct tm* timeinfo = localtime(&now);
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);  // Reentrant - also called from the HTTPS task
     char buffer[30];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", timeinfo);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &timeinfo);
     return String(buffer);
 }
 
 /*
- * Convert timestamp to ISO format
+ * Wall-clock time (Unix ms) of a history-clock timestamp, 0 while NTP has
+ * not set the clock
+ */
+uint64_t historyToEpochMillis(uint64_t timestamp) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec < 8 * 3600 * 2) return 0;
+    uint64_t nowMs = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+    return nowMs - (historyMillis() - timestamp);
+}
+
+/*
+ * Convert a history-clock timestamp to ISO format (wall time once NTP has set the clock)
  */
-String timestampToISO(unsigned long timestamp) {
-    time_t now = timestamp / 1000;  // Convert milliseconds to seconds
-    struct tm* timeinfo = localtime(&now);
+String timestampToISO(uint64_t timestamp) {
+    uint64_t epochMs = historyToEpochMillis(timestamp);
+    time_t now = (epochMs != 0 ? epochMs : timestamp) / 1000;  // Convert milliseconds to seconds
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
     char buffer[30];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", timeinfo);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &timeinfo);
     return String(buffer);
 }
\ No newline at end of file
@@ -0,0 +1,204 @@
+/*
+ * Admission control overload simulation (host)
+ *
+ * Replays the firmware's loop() on a virtual clock - sampler first, then
+ * at most one request, then delay(10) - under a synthetic overload, once
+ * without admission control and once with AdmissionController, and
+ * compares sampler lateness and per-class service.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/admission_sim.cpp src/AdmissionControl.cpp -o admission_sim
+ *
+ * Usage: admission_sim [seconds] [dashboards]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "AdmissionControl.h"
+
+#define SAMPLE_INTERVAL_US   1000000ULL        // deviceConfig.readingIntervalMs
+#define SAMPLE_COST_US       25000ULL          // DHT22 read and bookkeeping
+#define LOOP_DELAY_US        10000ULL          // delay(10) at the end of loop()
+#define SHED_COST_US         300ULL            // Writing a 503
+#define YIELD_CHUNK_US       50000ULL          // Streaming handlers call serviceSampler() this often
+#define MAX_BACKLOG          64                // Pending connections before clients time out
+
+struct EndpointModel {
+    const char* name;
+    RoutePriority priority;
+    uint16_t cost;                             // As declared in the route table (ms)
+    uint32_t minMicros;                        // Actual handler time range
+    uint32_t maxMicros;
+    bool yields;                               // Calls serviceSampler() while streaming
+};
+
+static const EndpointModel ENDPOINTS[] = {
+    { "/health", PRIORITY_HEALTH, 1, 300, 800, false },
+    { "/data", PRIORITY_CURRENT, 15, 12000, 22000, false },
+    { "/query", PRIORITY_HISTORY, 40, 30000, 70000, false },
+    { "/export.csv", PRIORITY_HISTORY, 100, 600000, 900000, true }
+};
+
+struct ClientModel {
+    uint32_t address;
+    uint8_t endpoint;
+    uint64_t periodMicros;                     // Open loop: polls regardless of replies
+    uint64_t nextSend;
+};
+
+struct Request {
+    uint8_t client;
+    uint64_t arrival;
+};
+
+struct ClassResult {
+    uint64_t offered;
+    uint64_t served;
+    uint64_t shed;
+    uint64_t timedOut;
+    std::vector<uint64_t> latencies;
+};
+
+struct RunResult {
+    uint64_t samples;
+    uint64_t maxLateness;
+    double meanLateness;
+    ClassResult classes[PRIORITY_COUNT];
+};
+
+static uint64_t percentile(std::vector<uint64_t>& values, double fraction) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(fraction * values.size()))];
+}
+
+static RunResult simulate(bool enabled, std::vector<ClientModel> clients, uint64_t duration) {
+    RunResult result = {};
+    AdmissionController controller;
+    std::mt19937 random(7);
+    std::deque<Request> backlog;
+
+    uint64_t now = 0;
+    uint64_t lastReading = 0;
+    double latenessSum = 0.0;
+
+    auto arrivals = [&]() {
+        for (size_t i = 0; i < clients.size(); i++) {
+            while (clients[i].nextSend <= now) {
+                RoutePriority priority = ENDPOINTS[clients[i].endpoint].priority;
+                result.classes[priority].offered++;
+                if (backlog.size() >= MAX_BACKLOG) {
+                    result.classes[priority].timedOut++;
+                } else {
+                    backlog.push_back({ (uint8_t)i, clients[i].nextSend });
+                }
+                clients[i].nextSend += clients[i].periodMicros;
+            }
+        }
+    };
+    auto serviceSampler = [&]() {
+        if (now - lastReading < SAMPLE_INTERVAL_US) return;
+        uint64_t lateness = now - (lastReading + SAMPLE_INTERVAL_US);
+        if (result.samples == 0) lateness = 0;
+        result.maxLateness = std::max(result.maxLateness, lateness);
+        latenessSum += lateness;
+        result.samples++;
+        lastReading = now;
+        now += SAMPLE_COST_US;
+    };
+
+    lastReading = 0;
+    now = SAMPLE_INTERVAL_US;
+    while (now < duration) {
+        serviceSampler();
+        arrivals();
+
+        if (!backlog.empty()) {
+            const Request request = backlog.front();
+            const ClientModel& client = clients[request.client];
+            const EndpointModel& endpoint = ENDPOINTS[client.endpoint];
+            ClassResult& stats = result.classes[endpoint.priority];
+
+            AdmissionVerdict verdict = ADMISSION_ADMIT;
+            if (enabled) {
+                uint64_t sinceLast = now - lastReading;
+                uint32_t slack = (sinceLast >= SAMPLE_INTERVAL_US) ? 0 : (uint32_t)((SAMPLE_INTERVAL_US - sinceLast) / 1000);
+                verdict = controller.admit(endpoint.priority, endpoint.cost, client.address,
+                                           (uint32_t)(now / 1000), slack).verdict;
+            }
+
+            if (verdict == ADMISSION_SHED) {
+                backlog.pop_front();
+                stats.shed++;
+                now += SHED_COST_US;
+            } else if (verdict == ADMISSION_ADMIT) {
+                backlog.pop_front();
+                uint32_t actual = endpoint.minMicros + random() % (endpoint.maxMicros - endpoint.minMicros + 1);
+                uint64_t remaining = actual;
+                while (remaining > 0) {
+                    uint64_t step = endpoint.yields ? std::min(remaining, (uint64_t)YIELD_CHUNK_US) : remaining;
+                    now += step;
+                    remaining -= step;
+                    if (endpoint.yields) serviceSampler();
+                }
+                if (enabled) controller.complete(endpoint.cost, actual);
+                stats.served++;
+                stats.latencies.push_back(now - request.arrival);
+            }
+            // ADMISSION_DEFER: the request stays at the head until after the sample
+        }
+
+        now += LOOP_DELAY_US;
+    }
+
+    result.meanLateness = result.samples ? latenessSum / result.samples : 0.0;
+    return result;
+}
+
+static void report(const char* title, RunResult& result, uint64_t duration) {
+    static const char* const NAMES[PRIORITY_COUNT] = { "health", "current", "history" };
+    printf("%s\n", title);
+    printf("  sampler: %llu of %llu samples, lateness mean %.1f ms, max %.1f ms\n",
+           (unsigned long long)result.samples, (unsigned long long)(duration / SAMPLE_INTERVAL_US),
+           result.meanLateness / 1000.0, result.maxLateness / 1000.0);
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++) {
+        ClassResult& stats = result.classes[priority];
+        printf("  %-8s offered %6llu  served %6llu  shed(503) %6llu  timed out %6llu  latency p50 %7.1f ms  p99 %7.1f ms\n",
+               NAMES[priority], (unsigned long long)stats.offered, (unsigned long long)stats.served,
+               (unsigned long long)stats.shed, (unsigned long long)stats.timedOut,
+               percentile(stats.latencies, 0.50) / 1000.0, percentile(stats.latencies, 0.99) / 1000.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 300;
+    int dashboards = (argc > 2) ? atoi(argv[2]) : 4;
+    uint64_t duration = (uint64_t)seconds * 1000000ULL;
+
+    // Overload: dashboards poll /data at 5 Hz, scripts query, an exporter loops, one monitor checks /health
+    std::vector<ClientModel> clients;
+    uint32_t address = 0xC0A80110;
+    for (int i = 0; i < dashboards; i++) clients.push_back({ address++, 1, 200000, (uint64_t)i * 37000 });
+    clients.push_back({ address++, 2, 500000, 3000 });
+    clients.push_back({ address++, 2, 400000, 11000 });
+    clients.push_back({ address++, 3, 3000000, 5000 });
+    clients.push_back({ address++, 0, 1000000, 500 });
+
+    RunResult baseline = simulate(false, clients, duration);
+    RunResult controlled = simulate(true, clients, duration);
+    report("without admission control:", baseline, duration);
+    report("with admission control:", controlled, duration);
+
+    // Health is always served and the sampler is never held up longer than one streaming chunk
+    bool ok = controlled.classes[PRIORITY_HEALTH].shed == 0 &&
+              controlled.classes[PRIORITY_HEALTH].timedOut == 0 &&
+              controlled.maxLateness <= YIELD_CHUNK_US + LOOP_DELAY_US;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
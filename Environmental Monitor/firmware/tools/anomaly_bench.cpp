@@ -0,0 +1,129 @@
+/*
+ * Anomaly detector per-sample benchmark (host)
+ *
+ * Feeds a synthetic temperature/humidity trace through the two series
+ * detectors and the event log exactly as readAndStoreSensorData() does,
+ * and reports the cost per sample. The trace carries injected faults
+ * (spikes, a level shift, a stuck run and a step) and a still-room
+ * stretch that is not a fault, and the flags raised for each are counted
+ * so a regression in detection shows up here too.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/anomaly_bench.cpp src/AnomalyDetector.cpp -o anomaly_bench
+ *
+ * Usage: anomaly_bench [samples] [passes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "AnomalyDetector.h"
+
+// Same tuning as main.cpp
+static const AnomalyConfig TEMPERATURE_CONFIG = {
+    0.05f, 4.0f, 0.5f, 8.0f, 0.1f, 0.1f, 3600, 1.0f, 30
+};
+static const AnomalyConfig HUMIDITY_CONFIG = {
+    0.05f, 4.0f, 0.5f, 8.0f, 0.3f, 0.1f, 1800, 5.0f, 30
+};
+
+struct Sample {
+    float temperature;
+    float humidity;
+    unsigned long timestamp;
+};
+
+#define STUCK_RUN 2400                         // Stuck humidity, seconds (flagged after stuckSeconds)
+#define STILL_RUN 1800                         // Still room: temperature within a fraction of a step
+
+static bool isSpike(size_t i) { return i % 5000 == 2500; }
+static bool isStill(size_t i, size_t count) { return i >= count / 8 && i < count / 8 + STILL_RUN; }
+
+/*
+ * 1 Hz trace: a slow daily-ish swing plus DHT22-like noise (0.1 resolution),
+ * with faults injected at fixed points
+ */
+static std::vector<Sample> buildTrace(size_t count) {
+    std::mt19937 random(12345);
+    std::normal_distribution<float> noise(0.0f, 0.08f);
+    std::vector<Sample> trace(count);
+
+    for (size_t i = 0; i < count; i++) {
+        float t = 23.0f + 2.0f * sinf((float)i / 3000.0f) + noise(random);
+        float h = 45.0f + 8.0f * sinf((float)i / 4000.0f) + 4.0f * noise(random);
+        if (isStill(i, count)) t = 22.02f + 0.25f * noise(random);                  // Not a fault
+        if (isSpike(i)) t += 3.0f;                                                   // Spikes
+        if (i >= count / 2) t += 1.5f;                                               // Level shift
+        if (i >= count / 4 && i < count / 4 + STUCK_RUN) h = 50.0f;                  // Stuck humidity
+        if (i == count * 3 / 4) h += 20.0f;                    // Step beyond the rate limit
+        trace[i].temperature = roundf(t * 10.0f) / 10.0f;
+        trace[i].humidity = roundf(h * 10.0f) / 10.0f;
+        trace[i].timestamp = (unsigned long)(i * 1000);
+    }
+    return trace;
+}
+
+int main(int argc, char** argv) {
+    size_t samples = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+    if (samples < 1000) samples = 1000;
+    if (passes < 1) passes = 1;
+
+    std::vector<Sample> trace = buildTrace(samples);
+
+    double best = 1e30;
+    unsigned flagCounts[8] = {};
+    unsigned spikes = 0;
+    unsigned spikeShifts = 0;                  // Spikes that also raised a level shift
+    unsigned stillStuck = 0;                   // Still-room samples flagged stuck
+    uint32_t events = 0;
+
+    for (int pass = 0; pass < passes; pass++) {
+        SeriesAnomalyDetector temperatureDetector(TEMPERATURE_CONFIG);
+        SeriesAnomalyDetector humidityDetector(HUMIDITY_CONFIG);
+        AnomalyEventLog log;
+        unsigned counts[8] = {};
+        spikes = spikeShifts = stillStuck = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < trace.size(); i++) {
+            const Sample& sample = trace[i];
+            uint8_t temperatureFlags = temperatureDetector.update(sample.temperature, sample.timestamp);
+            uint8_t humidityFlags = humidityDetector.update(sample.humidity, sample.timestamp);
+            log.record(ANOMALY_SERIES_TEMPERATURE, temperatureFlags, sample.temperature,
+                       temperatureDetector.lastZScore(), sample.timestamp);
+            log.record(ANOMALY_SERIES_HUMIDITY, humidityFlags, sample.humidity,
+                       humidityDetector.lastZScore(), sample.timestamp);
+            for (int bit = 0; bit < 4; bit++) {
+                if (temperatureFlags & (1 << bit)) counts[bit]++;
+                if (humidityFlags & (1 << bit)) counts[4 + bit]++;
+            }
+            if (isSpike(i) && i >= trace.size() / 8 + STILL_RUN) {
+                spikes++;
+                if (temperatureFlags & ANOMALY_LEVEL_SHIFT) spikeShifts++;
+            }
+            if (isStill(i, trace.size()) && (temperatureFlags & ANOMALY_STUCK)) stillStuck++;
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if (elapsed < best) best = elapsed;
+        for (int i = 0; i < 8; i++) flagCounts[i] = counts[i];
+        events = log.totalEvents();
+    }
+
+    printf("samples %zu, passes %d\n", samples, passes);
+    printf("per sample (both series + event log): %.1f ns (best pass)\n", best / (double)samples);
+    printf("temperature flags: outlier %u, level shift %u, stuck %u, rate %u\n",
+           flagCounts[0], flagCounts[1], flagCounts[2], flagCounts[3]);
+    printf("humidity flags:    outlier %u, level shift %u, stuck %u, rate %u\n",
+           flagCounts[4], flagCounts[5], flagCounts[6], flagCounts[7]);
+    printf("spikes also flagged as level shifts: %u of %u\n", spikeShifts, spikes);
+    printf("still-room samples flagged stuck: %u of %u\n", stillStuck, STILL_RUN);
+    printf("logged events: %u\n", events);
+    return 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * Firmware Delta Tool (host)
+ *
+ * Creates compressed deltas for POST /ota/delta and replays them through
+ * the same DeltaApplier the firmware runs.
+ *
+ *   delta_tool diff  <old.bin> <new.bin> <patch.bin>
+ *   delta_tool apply <old.bin> <patch.bin> <out.bin> [new.bin]
+ *
+ * apply feeds the patch in random-sized pieces, like network reads on the
+ * device, and compares the result with new.bin when given.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/delta_tool.cpp src/DeltaPatch.cpp \
+ *       src/HistoryCheckpoint.cpp -o delta_tool
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "DeltaPatch.h"
+#include "HistoryCheckpoint.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    out.resize(size);
+    bool ok = size == 0 || fread(out.data(), 1, size, file) == (size_t)size;
+    fclose(file);
+    return ok;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) return false;
+    bool ok = data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+static void putLE32(Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+// ---------------------------------------------------------------------------
+// Operation stream: exact matches become COPY, approximate ones ADD
+// ---------------------------------------------------------------------------
+
+#define SEED_LENGTH 8                          // Bytes hashed to find candidate matches
+#define MIN_COPY 12                            // Shorter exact matches stay literal
+#define MAX_CANDIDATES 64
+#define HASH_BITS 20
+
+static uint32_t seedHash(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return (uint32_t)((value * 0x9E3779B97F4A7C15ULL) >> (64 - HASH_BITS));
+}
+
+/*
+ * bsdiff-style extension: the length maximizing 2 * matches - length
+ */
+static size_t approximateLength(const Bytes& oldImage, size_t oldPos, const Bytes& newImage, size_t newPos,
+                                int* scoreOut) {
+    int matches = 0;
+    int best = 0;
+    size_t bestLength = 0;
+    for (size_t k = 0; newPos + k < newImage.size() && oldPos + k < oldImage.size(); k++) {
+        if (newImage[newPos + k] == oldImage[oldPos + k]) matches++;
+        int score = 2 * matches - (int)(k + 1);
+        if (score > best) {
+            best = score;
+            bestLength = k + 1;
+        }
+        if (k + 1 - bestLength > 64) break;
+    }
+    *scoreOut = best;
+    return bestLength;
+}
+
+static void emitRange(Bytes& ops, const Bytes& oldImage, size_t oldPos, const Bytes& newImage,
+                      size_t newPos, size_t length) {
+    bool exact = memcmp(&oldImage[oldPos], &newImage[newPos], length) == 0;
+    ops.push_back(exact ? DELTA_OP_COPY : DELTA_OP_ADD);
+    putLE32(ops, (uint32_t)oldPos);
+    putLE32(ops, (uint32_t)length);
+    if (!exact) {
+        for (size_t k = 0; k < length; k++) {
+            ops.push_back((uint8_t)(newImage[newPos + k] - oldImage[oldPos + k]));
+        }
+    }
+}
+
+static void emitInsert(Bytes& ops, const Bytes& newImage, size_t start, size_t end) {
+    if (end <= start) return;
+    ops.push_back(DELTA_OP_INSERT);
+    putLE32(ops, (uint32_t)(end - start));
+    ops.insert(ops.end(), newImage.begin() + start, newImage.begin() + end);
+}
+
+static Bytes buildOperations(const Bytes& oldImage, const Bytes& newImage) {
+    std::vector<int32_t> head(1u << HASH_BITS, -1);
+    std::vector<int32_t> chain(oldImage.size(), -1);
+    for (size_t p = 0; p + SEED_LENGTH <= oldImage.size(); p++) {
+        uint32_t h = seedHash(&oldImage[p]);
+        chain[p] = head[h];
+        head[h] = (int32_t)p;
+    }
+
+    Bytes ops;
+    size_t literalStart = 0;
+    size_t continuation = 0;                   // Old offset following the previous match
+    bool haveContinuation = false;
+    size_t i = 0;
+    while (i < newImage.size()) {
+        size_t bestLength = 0;
+        size_t bestOld = 0;
+        if (i + SEED_LENGTH <= newImage.size()) {
+            int32_t candidate = head[seedHash(&newImage[i])];
+            for (int walked = 0; candidate >= 0 && walked < MAX_CANDIDATES; walked++) {
+                size_t length = 0;
+                while (i + length < newImage.size() && candidate + length < oldImage.size() &&
+                       newImage[i + length] == oldImage[candidate + length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOld = candidate;
+                }
+                candidate = chain[candidate];
+            }
+        }
+
+        size_t oldPos = 0;
+        size_t length = 0;
+        int score = 0;
+        if (bestLength >= MIN_COPY) {
+            oldPos = bestOld;
+            length = approximateLength(oldImage, oldPos, newImage, i, &score);
+            if (length < bestLength) length = bestLength;
+        } else if (haveContinuation && continuation < oldImage.size()) {
+            // Moved code: same shape as the old bytes after the previous match
+            length = approximateLength(oldImage, continuation, newImage, i, &score);
+            if (score >= 16) {
+                oldPos = continuation;
+            } else {
+                length = 0;
+            }
+        }
+
+        if (length == 0) {
+            i++;
+            if (haveContinuation) continuation++;
+            continue;
+        }
+
+        emitInsert(ops, newImage, literalStart, i);
+        emitRange(ops, oldImage, oldPos, newImage, i, length);
+        i += length;
+        literalStart = i;
+        continuation = oldPos + length;
+        haveContinuation = true;
+    }
+    emitInsert(ops, newImage, literalStart, newImage.size());
+    ops.push_back(DELTA_OP_END);
+    return ops;
+}
+
+// ---------------------------------------------------------------------------
+// LZSS compression matching DeltaApplier::nextStreamByte()
+// ---------------------------------------------------------------------------
+
+static Bytes compress(const Bytes& input) {
+    const size_t window = DELTA_WINDOW_SIZE;
+    std::vector<int32_t> head(1u << 16, -1);
+    std::vector<int32_t> chain(input.size(), -1);
+    auto hash3 = [&](size_t p) {
+        return (uint32_t)((input[p] << 8) ^ (input[p + 1] << 4) ^ input[p + 2]) & 0xFFFF;
+    };
+    auto insert = [&](size_t p) {
+        if (p + DELTA_MIN_MATCH > input.size()) return;
+        uint32_t h = hash3(p);
+        chain[p] = head[h];
+        head[h] = (int32_t)p;
+    };
+
+    Bytes out;
+    uint8_t group[8 * 3];
+    size_t groupLength = 0;
+    uint8_t flags = 0;
+    int tokens = 0;
+    auto flushGroup = [&]() {
+        if (tokens == 0) return;
+        out.push_back(flags);
+        out.insert(out.end(), group, group + groupLength);
+        groupLength = 0;
+        flags = 0;
+        tokens = 0;
+    };
+
+    size_t p = 0;
+    while (p < input.size()) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (p + DELTA_MIN_MATCH <= input.size()) {
+            int32_t candidate = head[hash3(p)];
+            for (int walked = 0; candidate >= 0 && p - candidate <= window && walked < 256; walked++) {
+                size_t length = 0;
+                while (length < DELTA_MAX_MATCH && p + length < input.size() &&
+                       input[candidate + length] == input[p + length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = p - candidate;
+                }
+                candidate = chain[candidate];
+            }
+        }
+
+        if (bestLength >= DELTA_MIN_MATCH) {
+            size_t nibble = bestLength - DELTA_MIN_MATCH;
+            if (nibble > 15) nibble = 15;
+            group[groupLength++] = (uint8_t)((bestDistance - 1) & 0xFF);
+            group[groupLength++] = (uint8_t)((((bestDistance - 1) >> 8) << 4) | nibble);
+            if (nibble == 15) group[groupLength++] = (uint8_t)(bestLength - DELTA_MIN_MATCH - 15);
+            for (size_t k = 0; k < bestLength; k++) insert(p + k);
+            p += bestLength;
+        } else {
+            flags |= (uint8_t)(1u << tokens);
+            group[groupLength++] = input[p];
+            insert(p);
+            p++;
+        }
+        if (++tokens == 8) flushGroup();
+    }
+    flushGroup();
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Commands
+// ---------------------------------------------------------------------------
+
+static int runDiff(const char* oldPath, const char* newPath, const char* patchPath) {
+    Bytes oldImage, newImage;
+    if (!readFile(oldPath, oldImage) || !readFile(newPath, newImage)) {
+        fprintf(stderr, "cannot read input images\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Bytes ops = buildOperations(oldImage, newImage);
+    Bytes body = compress(ops);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    DeltaHeader header = {};
+    header.magic = DELTA_MAGIC;
+    header.version = DELTA_VERSION;
+    header.oldSize = (uint32_t)oldImage.size();
+    header.oldCrc = checkpointCrc32(oldImage.data(), oldImage.size());
+    header.newSize = (uint32_t)newImage.size();
+    header.newCrc = checkpointCrc32(newImage.data(), newImage.size());
+    sealDeltaHeader(header);
+
+    Bytes patch((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+    patch.insert(patch.end(), body.begin(), body.end());
+    if (!writeFile(patchPath, patch)) {
+        fprintf(stderr, "cannot write %s\n", patchPath);
+        return 1;
+    }
+
+    printf("old %zu bytes, new %zu bytes\n", oldImage.size(), newImage.size());
+    printf("operations %zu bytes, patch %zu bytes (%.1f%% of new image), %.2f s\n",
+           ops.size(), patch.size(), 100.0 * patch.size() / newImage.size(), seconds);
+    return 0;
+}
+
+struct HostIo {
+    const Bytes* oldImage;
+    Bytes* output;
+};
+
+static bool hostReadOld(void* context, uint32_t offset, uint8_t* buffer, size_t length) {
+    const HostIo* io = static_cast<const HostIo*>(context);
+    if (offset + length > io->oldImage->size()) return false;
+    memcpy(buffer, io->oldImage->data() + offset, length);
+    return true;
+}
+
+static bool hostWriteNew(void* context, const uint8_t* data, size_t length) {
+    HostIo* io = static_cast<HostIo*>(context);
+    io->output->insert(io->output->end(), data, data + length);
+    return true;
+}
+
+static int runApply(const char* oldPath, const char* patchPath, const char* outPath, const char* expectPath) {
+    Bytes oldImage, patch, output, expected;
+    if (!readFile(oldPath, oldImage) || !readFile(patchPath, patch)) {
+        fprintf(stderr, "cannot read inputs\n");
+        return 1;
+    }
+
+    static DeltaApplier applier;               // Same fixed footprint as on the device
+    HostIo io = { &oldImage, &output };
+    applier.begin(hostReadOld, hostWriteNew, &io);
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<size_t> pieceSize(1, 1460);
+    size_t offset = 0;
+    size_t calls = 0;
+    DeltaStatus status = DELTA_CONTINUE;
+    auto start = std::chrono::steady_clock::now();
+    while (status == DELTA_CONTINUE) {
+        size_t piece = std::min(pieceSize(random), patch.size() - offset);
+        size_t consumed = 0;
+        status = applier.push(patch.data() + offset, piece, &consumed);
+        offset += consumed;
+        calls++;
+        if (status == DELTA_CONTINUE && offset == patch.size() && applier.needsInput()) {
+            fprintf(stderr, "patch is truncated\n");
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("status %s after %zu push calls, %.3f s (%.1f MB/s of output)\n", deltaStatusName(status),
+           calls, seconds, output.size() / seconds / 1e6);
+    printf("applier state %zu bytes\n", sizeof(DeltaApplier));
+    if (status != DELTA_DONE) return 1;
+
+    if (!writeFile(outPath, output)) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    if (expectPath != nullptr) {
+        if (!readFile(expectPath, expected) || expected != output) {
+            printf("output differs from %s\n", expectPath);
+            return 1;
+        }
+        printf("output matches %s\n", expectPath);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 5 && strcmp(argv[1], "diff") == 0) {
+        return runDiff(argv[2], argv[3], argv[4]);
+    }
+    if (argc >= 5 && strcmp(argv[1], "apply") == 0) {
+        return runApply(argv[2], argv[3], argv[4], (argc >= 6) ? argv[5] : nullptr);
+    }
+    fprintf(stderr, "usage: %s diff <old.bin> <new.bin> <patch.bin>\n"
+                    "       %s apply <old.bin> <patch.bin> <out.bin> [new.bin]\n", argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,147 @@
+/*
+ * Forecast accuracy replay (host)
+ *
+ * Runs the firmware's forecasters and online accuracy tracking over a
+ * recorded trace, the same way updateForecasts() does (forecasts after
+ * every sample, a snapshot per minute, scoring against elapsed time), and
+ * prints per horizon the MAE and 95% band coverage of what was served,
+ * the MAE of the damped Holt forecast and of persistence (the last value
+ * held flat), the method served at the end and whether alerts were
+ * enabled for it.
+ *
+ * The trace is a CSV in the /export.csv layout (sequence, timestamp,
+ * temperature, humidity, ...; the header line is skipped). Without a file
+ * a synthetic 10 h trace at 1 Hz is replayed instead.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/forecast_replay.cpp src/Forecaster.cpp -o forecast_replay
+ *
+ * Usage: forecast_replay [export.csv]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+#include <vector>
+
+#include "Forecaster.h"
+
+#define SNAPSHOT_INTERVAL_MS 60000UL           // FORECAST_SNAPSHOT_INTERVAL in main.cpp
+
+struct TraceSample {
+    unsigned long timestamp;
+    float temperature;
+    float humidity;
+};
+
+static bool loadTrace(const char* path, std::vector<TraceSample>& trace) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        unsigned long sequence, timestamp;
+        float temperature, humidity;
+        if (sscanf(line, "%lu,%lu,%f,%f", &sequence, &timestamp, &temperature, &humidity) != 4) continue;
+        if (isnan(temperature) || isnan(humidity)) continue;
+        trace.push_back({ timestamp, temperature, humidity });
+    }
+    fclose(file);
+    return true;
+}
+
+/*
+ * 10 h at 1 Hz: HVAC-like cycling on a slow drift, DHT22 noise and
+ * resolution, and a few missed reads
+ */
+static void syntheticTrace(std::vector<TraceSample>& trace) {
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0.0f, 0.08f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    for (unsigned long i = 0; i < 36000; i++) {
+        if (uniform(random) < 0.01f) continue;
+        float minutes = i / 60.0f;
+        float t = 22.0f + 1.5f * sinf(minutes / 120.0f) + 0.6f * sinf(minutes / 7.0f) + noise(random);
+        float h = 45.0f + 6.0f * sinf(minutes / 150.0f) - 1.5f * sinf(minutes / 7.0f) + 4.0f * noise(random);
+        trace.push_back({ i * 1000UL, roundf(t * 10.0f) / 10.0f, roundf(h * 10.0f) / 10.0f });
+    }
+}
+
+struct Replay {
+    HoltForecaster forecaster;
+    ForecastAccuracy accuracy;
+    unsigned long lastSnapshot;
+    uint32_t trustedSamples[FORECAST_HORIZON_COUNT];
+    uint32_t samples;
+
+    // Parameters of temperatureForecaster and humidityForecaster in main.cpp
+    Replay() : forecaster(0.05f, 0.005f, 0.02f, 300.0f), lastSnapshot(0), trustedSamples(), samples(0) {}
+
+    void step(float value, unsigned long timestamp) {
+        forecaster.update(value, timestamp);
+
+        ForecastPoint holt[FORECAST_HORIZON_COUNT];
+        ForecastPoint served[FORECAST_HORIZON_COUNT];
+        for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+            holt[i] = forecaster.forecast(FORECAST_HORIZON_MINUTES[i] * 60.0f);
+            served[i] = accuracy.serve(i, holt[i], value);
+        }
+        if (!forecaster.ready()) return;
+
+        accuracy.score(value, timestamp);
+        if (timestamp - lastSnapshot >= SNAPSHOT_INTERVAL_MS) {
+            accuracy.addSnapshot(timestamp, served, holt, value);
+            lastSnapshot = timestamp;
+        }
+        samples++;
+        for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+            if (accuracy.trusted(i)) trustedSamples[i]++;
+        }
+    }
+
+    void print(const char* name, const char* unit) const {
+        printf("%s\n", name);
+        printf("  horizon   served MAE (%s)  coverage  Holt MAE  persistence  source       alerts  scored  missed\n", unit);
+        for (int i = 0; i < FORECAST_HORIZON_COUNT; i++) {
+            printf("  %3u min   %15.3f  %7.1f%%  %8.3f  %11.3f  %-11s  %5.1f%%  %6u  %6u\n",
+                   FORECAST_HORIZON_MINUTES[i], accuracy.meanAbsoluteError(i),
+                   accuracy.bandCoverage(i) * 100.0f, accuracy.holtError(i), accuracy.persistenceError(i),
+                   accuracy.source(i) == FORECAST_SOURCE_HOLT ? "holt" : "persistence",
+                   samples ? trustedSamples[i] * 100.0f / samples : 0.0f,
+                   accuracy.evaluations(i), accuracy.missed(i));
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    std::vector<TraceSample> trace;
+    if (argc > 1) {
+        if (!loadTrace(argv[1], trace)) return 1;
+    } else {
+        syntheticTrace(trace);
+    }
+    if (trace.size() < 2) {
+        fprintf(stderr, "trace has fewer than two readings\n");
+        return 1;
+    }
+
+    Replay temperature;
+    Replay humidity;
+    for (const TraceSample& sample : trace) {
+        temperature.step(sample.temperature, sample.timestamp);
+        humidity.step(sample.humidity, sample.timestamp);
+    }
+
+    printf("%s: %zu readings over %.1f h\n", argc > 1 ? argv[1] : "synthetic trace", trace.size(),
+           (trace.back().timestamp - trace.front().timestamp) / 3600000.0);
+    temperature.print("temperature", "degC");
+    humidity.print("humidity", "%RH");
+    return 0;
+}
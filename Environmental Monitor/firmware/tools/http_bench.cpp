@@ -0,0 +1,177 @@
+/*
+ * HTTP request path benchmark (host)
+ *
+ * Times what the server does for every request before the handler runs:
+ * parseHttpRequest() over the receive buffer, the compile-time route
+ * table lookup and bindRequestArgs(), using the firmware's routes and
+ * parameter schemas. Each request is copied into the receive buffer
+ * first, as a socket read would, because binding decodes in place.
+ *
+ * The route table below mirrors ROUTES in main.cpp (paths, verbs and
+ * parameter schemas; the handlers only count calls).
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/http_bench.cpp src/HttpRequest.cpp -o http_bench
+ *
+ * Usage: http_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "HttpRequest.h"
+#include "HttpRouter.h"
+
+static volatile uint32_t handled;
+
+static void countRequest(const RequestArgs& args) {
+    handled = handled + 1 + (args.has(0) ? 1 : 0);
+}
+
+constexpr ParamSpec SPECTRUM_PARAMS[] = {
+    { "bins", PARAM_TEXT }
+};
+constexpr ParamSpec QUERY_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "agg", PARAM_TEXT },
+    { "bucket", PARAM_TEXT },
+    { "from", PARAM_UINT64 },
+    { "to", PARAM_UINT64 }
+};
+constexpr ParamSpec EXPORT_PARAMS[] = {
+    { "from_seq", PARAM_UINT },
+    { "to_seq", PARAM_UINT }
+};
+constexpr ParamSpec HISTOGRAM_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "period", PARAM_TEXT }
+};
+constexpr ParamSpec NODES_PARAMS[] = {
+    { "node", PARAM_UINT },
+    { "limit", PARAM_UINT }
+};
+constexpr ParamSpec HISTOGRAM_CONFIG_PARAMS[] = {
+    { "series", PARAM_TEXT },
+    { "min", PARAM_FLOAT },
+    { "width", PARAM_FLOAT },
+    { "bins", PARAM_UINT }
+};
+
+#define ROUTE_PARAMS(schema) schema, (uint8_t)(sizeof(schema) / sizeof(schema[0]))
+
+constexpr RouteSpec ROUTES[] = {
+    { "/data", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_CURRENT, 15, false },
+    { "/health", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_HEALTH, 1, false },
+    { "/status", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_HEALTH, 3, false },
+    { "/anomalies", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_CURRENT, 5, false },
+    { "/spectrum", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(SPECTRUM_PARAMS), PRIORITY_CURRENT, 3, false },
+    { "/forecast", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_CURRENT, 3, false },
+    { "/query", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(QUERY_PARAMS), PRIORITY_HISTORY, 40, false },
+    { "/export.csv", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(EXPORT_PARAMS), PRIORITY_HISTORY, 100, false },
+    { "/export.ndjson", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(EXPORT_PARAMS), PRIORITY_HISTORY, 100, false },
+    { "/config", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_CURRENT, 2, false },
+    { "/config", HTTP_VERB_POST, countRequest, nullptr, 0, PRIORITY_CURRENT, 2, false },
+    { "/histogram", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(HISTOGRAM_PARAMS), PRIORITY_HISTORY, 5, false },
+    { "/histogram/config", HTTP_VERB_POST, countRequest, ROUTE_PARAMS(HISTOGRAM_CONFIG_PARAMS), PRIORITY_CURRENT, 2, false },
+    { "/ota/delta", HTTP_VERB_POST, countRequest, nullptr, 0, PRIORITY_CURRENT, 1, true },
+    { "/ota/status", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_HEALTH, 1, false },
+    { "/nodes", HTTP_VERB_GET, countRequest, ROUTE_PARAMS(NODES_PARAMS), PRIORITY_HISTORY, 10, false },
+    { "/stalls", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_HEALTH, 3, false },
+    { "/events", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_CURRENT, 1, false },
+    { "/", HTTP_VERB_GET, countRequest, nullptr, 0, PRIORITY_HEALTH, 1, false }
+};
+
+constexpr auto ROUTE_TABLE = makeRouteTable(ROUTES);
+static_assert(ROUTE_TABLE.valid(), "no collision-free seed for the route table");
+
+struct Scenario {
+    const char* name;
+    const char* request;
+    HttpParseStatus expected;
+};
+
+static const Scenario SCENARIOS[] = {
+    { "GET /data (browser headers)",
+      "GET /data HTTP/1.1\r\n"
+      "Host: 192.168.1.50\r\n"
+      "Connection: keep-alive\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+      "Accept: application/json, text/plain, */*\r\n"
+      "Referer: http://192.168.1.50/\r\n"
+      "Accept-Encoding: gzip, deflate\r\n"
+      "Accept-Language: en-US,en;q=0.9\r\n"
+      "\r\n",
+      HTTP_PARSE_OK },
+    { "GET /query (5 parameters)",
+      "GET /query?series=temperature%2Chumidity&agg=mean,min,max&bucket=5m&from=3600000&to=86400000 HTTP/1.1\r\n"
+      "Host: 192.168.1.50\r\n"
+      "Connection: keep-alive\r\n"
+      "Accept: application/json\r\n"
+      "\r\n",
+      HTTP_PARSE_OK },
+    { "POST /config (JSON body)",
+      "POST /config HTTP/1.1\r\n"
+      "Host: 192.168.1.50\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: 47\r\n"
+      "\r\n"
+      "{\"reading_interval_ms\":2000,\"history_size\":512}",
+      HTTP_PARSE_OK },
+    { "bad Content-Length (rejected)",
+      "POST /config HTTP/1.1\r\n"
+      "Host: 192.168.1.50\r\n"
+      "Content-Length: +47\r\n"
+      "\r\n",
+      HTTP_PARSE_BAD_REQUEST }
+};
+
+int main(int argc, char** argv) {
+    long iterations = (argc > 1) ? atol(argv[1]) : 2000000;
+    if (iterations < 1000) iterations = 1000;
+
+    static char buffer[2048];                  // HTTP_RX_BUFFER_SIZE
+    bool ok = true;
+
+    printf("%-32s %12s %12s\n", "request", "ns/request", "requests/s");
+    for (const Scenario& scenario : SCENARIOS) {
+        size_t length = strlen(scenario.request);
+        uint32_t dispatched = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++) {
+            memcpy(buffer, scenario.request, length);
+
+            HttpRequest request;
+            HttpParseStatus status = parseHttpRequest(buffer, length, request);
+            if (status != scenario.expected) {
+                ok = false;
+                break;
+            }
+            if (status != HTTP_PARSE_OK) continue;
+
+            const RouteSpec* route = ROUTE_TABLE.find(request.verb, request.path.data, request.path.length);
+            if (route == nullptr) {
+                ok = false;
+                break;
+            }
+            RequestArgs args;
+            if (bindRequestArgs(request, route->params, route->paramCount, args) != nullptr) {
+                ok = false;
+                break;
+            }
+            route->handler(args);
+            dispatched++;
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        double perRequest = elapsed / (double)iterations;
+        printf("%-32s %12.1f %12.0f\n", scenario.name, perRequest, 1e9 / perRequest);
+        if (scenario.expected == HTTP_PARSE_OK && dispatched != (uint32_t)iterations) ok = false;
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*
+ * Node link benchmark (host)
+ *
+ * Runs the gateway's frame decoding, deduplication and batching against
+ * a simulated connectionless link that drops, duplicates, reorders and
+ * corrupts frames, then checks that every reading that got through was
+ * stored exactly once.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/node_link_bench.cpp src/NodeLink.cpp \
+ *       src/HistoryCheckpoint.cpp -o node_link_bench
+ *
+ * Usage: node_link_bench [nodes] [readings_per_node] [loss%] [dup%] [reorder%] [corrupt%]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "NodeLink.h"
+
+/*
+ * Lossy broadcast medium: frames sit in flight for a random number of
+ * ticks, so some overtake others
+ */
+class SimulatedLink : public NodeTransport {
+public:
+    SimulatedLink(double loss, double duplicate, double reorder, double corrupt, uint32_t seed)
+        : sent(0), delivered(0), lossRate(loss), duplicateRate(duplicate), reorderRate(reorder),
+          corruptRate(corrupt), random(seed), tick(0) {}
+
+    bool send(const uint8_t* frame, size_t length) override {
+        sent++;
+        if (chance(lossRate)) return true;     // Broadcast: the sender never knows
+        enqueue(frame, length);
+        if (chance(duplicateRate)) enqueue(frame, length);
+        return true;
+    }
+
+    bool receive(uint8_t* frame, size_t& length) override {
+        for (size_t i = 0; i < inFlight.size(); i++) {
+            if (inFlight[i].due > tick) continue;
+            memcpy(frame, inFlight[i].data, inFlight[i].length);
+            length = inFlight[i].length;
+            inFlight[i] = inFlight.back();
+            inFlight.pop_back();
+            delivered++;
+            return true;
+        }
+        return false;
+    }
+
+    void advance() { tick++; }
+    bool idle() const { return inFlight.empty(); }
+
+    uint64_t sent;
+    uint64_t delivered;
+
+private:
+    struct Frame {
+        uint64_t due;
+        size_t length;
+        uint8_t data[NODE_FRAME_SIZE];
+    };
+
+    bool chance(double rate) { return std::uniform_real_distribution<double>(0.0, 1.0)(random) < rate; }
+
+    void enqueue(const uint8_t* data, size_t length) {
+        Frame frame;
+        frame.due = tick + (chance(reorderRate) ? 1 + random() % 20 : 0);
+        frame.length = length;
+        memcpy(frame.data, data, length);
+        if (chance(corruptRate)) frame.data[random() % length] ^= (uint8_t)(1 + random() % 255);
+        inFlight.push_back(frame);
+    }
+
+    double lossRate;
+    double duplicateRate;
+    double reorderRate;
+    double corruptRate;
+    std::mt19937 random;
+    uint64_t tick;
+    std::vector<Frame> inFlight;
+};
+
+struct SinkState {
+    NodeHistory history;
+    std::set<std::pair<uint32_t, uint32_t>> stored;   // (session << 16 | node, sequence)
+    uint64_t readings;
+    uint64_t repeats;
+};
+
+static void storeBatch(void* context, const NodeReading* readings, size_t count) {
+    SinkState* sink = static_cast<SinkState*>(context);
+    sink->history.add(readings, count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t key = ((uint32_t)readings[i].session << 16) | readings[i].nodeId;
+        if (!sink->stored.insert(std::make_pair(key, readings[i].sequence)).second) sink->repeats++;
+        sink->readings++;
+    }
+}
+
+int main(int argc, char** argv) {
+    int nodes = (argc > 1) ? atoi(argv[1]) : 12;
+    int perNode = (argc > 2) ? atoi(argv[2]) : 20000;
+    double loss = (argc > 3) ? atof(argv[3]) / 100.0 : 0.05;
+    double duplicate = (argc > 4) ? atof(argv[4]) / 100.0 : 0.10;
+    double reorder = (argc > 5) ? atof(argv[5]) / 100.0 : 0.10;
+    double corrupt = (argc > 6) ? atof(argv[6]) / 100.0 : 0.01;
+    if (nodes < 1 || nodes > NODE_MAX_NODES || perNode < 1) {
+        fprintf(stderr, "nodes must be 1..%d\n", NODE_MAX_NODES);
+        return 1;
+    }
+
+    SimulatedLink link(loss, duplicate, reorder, corrupt, 42);
+    static SinkState sink;
+    static NodeAggregator aggregator;
+    aggregator.begin(storeBatch, &sink);
+
+    // Node 0 restarts half way through (new session, sequence from 0)
+    std::vector<uint8_t> sessions(nodes);
+    for (int n = 0; n < nodes; n++) sessions[n] = (uint8_t)(17 * n + 1);
+
+    uint8_t frame[NODE_FRAME_SIZE];
+    size_t length = 0;
+    uint64_t now = 0;
+    double acceptSeconds = 0.0;
+    uint64_t accepted = 0;
+    std::vector<uint8_t> arrived;
+
+    for (int step = 0; step < perNode || !link.idle(); step++) {
+        if (step < perNode) {
+            for (int n = 0; n < nodes; n++) {
+                if (n == 0 && step == perNode / 2) sessions[0]++;
+                uint32_t sequence = (n == 0 && step >= perNode / 2) ? step - perNode / 2 : step;
+                NodeReading reading = { (uint16_t)(100 + n), sessions[n], sequence, 0,
+                                        20.0f + n * 0.1f, 45.0f + (step % 100) * 0.1f, 0, 0 };
+                link.send(frame, encodeNodeFrame(reading, (uint16_t)(step % 50), frame));
+            }
+        }
+
+        // Gateway drains what has arrived this tick (only its own work is timed)
+        arrived.clear();
+        while (link.receive(frame, length)) arrived.insert(arrived.end(), frame, frame + length);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < arrived.size(); offset += NODE_FRAME_SIZE) {
+            if (aggregator.accept(&arrived[offset], NODE_FRAME_SIZE, now)) accepted++;
+        }
+        aggregator.service(now);
+        acceptSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        link.advance();
+        now += 100;
+    }
+    aggregator.flush();
+
+    const NodeAggregatorStats& stats = aggregator.stats();
+    uint64_t duplicates = 0, stale = 0, lost = 0, restarts = 0;
+    for (uint8_t i = 0; i < aggregator.nodeCount(); i++) {
+        const NodeLinkStats* node = aggregator.node(i);
+        duplicates += node->duplicates;
+        stale += node->stale;
+        lost += node->lost;
+        restarts += node->restarts;
+    }
+
+    printf("link: %llu sent, %llu delivered (loss %.0f%%, dup %.0f%%, reorder %.0f%%, corrupt %.0f%%)\n",
+           (unsigned long long)link.sent, (unsigned long long)link.delivered,
+           loss * 100, duplicate * 100, reorder * 100, corrupt * 100);
+    printf("gateway: %lu frames, %lu bad, %llu accepted, %llu duplicates, %llu stale, %llu lost, %llu restarts\n",
+           (unsigned long)stats.frames, (unsigned long)stats.badFrames, (unsigned long long)accepted,
+           (unsigned long long)duplicates, (unsigned long long)stale, (unsigned long long)lost,
+           (unsigned long long)restarts);
+    printf("batches: %lu (%.1f readings each)\n", (unsigned long)stats.batches,
+           stats.batches ? (double)stats.batchedReadings / stats.batches : 0.0);
+    printf("throughput: %.1f M frames/s (%.0f ns per frame incl. batching and storage)\n",
+           stats.frames / acceptSeconds / 1e6, acceptSeconds * 1e9 / stats.frames);
+    printf("state: aggregator %zu bytes, history %zu bytes\n", sizeof(NodeAggregator), sizeof(NodeHistory));
+
+    bool ok = sink.repeats == 0 && sink.readings == accepted && sink.history.nodeCount() == nodes;
+    for (uint8_t i = 0; ok && i < sink.history.nodeCount(); i++) {
+        ok = sink.history.readingCount(i) == NODE_HISTORY_SIZE;
+    }
+    printf("%s: %llu readings stored, %llu stored twice\n", ok ? "PASS" : "FAIL",
+           (unsigned long long)sink.readings, (unsigned long long)sink.repeats);
+    return ok ? 0 : 1;
+}
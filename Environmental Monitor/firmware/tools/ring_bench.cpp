@@ -0,0 +1,155 @@
+/*
+ * TimeSeriesRing microbenchmarks (host)
+ *
+ * Times append, full scans (per-record and two-span block copy) and
+ * time-range lookup on the history ring, against the modulo-indexed
+ * ring it replaced (1000 slots, (index + size) % size addressing and a
+ * linear scan for the first reading of a time range). Also checks that
+ * both rings agree.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -Iinclude tools/ring_bench.cpp -o ring_bench
+ *
+ * Usage: ring_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "SensorReading.h"
+#include "TimeSeriesRing.h"
+
+#define LEGACY_SIZE 1000                       // Old MAX_READINGS
+#define RING_SIZE 1024                         // New MAX_READINGS
+
+// The previous layout: index + count, modulo on every access
+struct LegacyRing {
+    SensorReading readings[LEGACY_SIZE];
+    int currentIndex;
+    int readingCount;
+
+    void push(const SensorReading& reading) {
+        readings[currentIndex] = reading;
+        currentIndex = (currentIndex + 1) % LEGACY_SIZE;
+        if (readingCount < LEGACY_SIZE) readingCount++;
+    }
+    const SensorReading& at(int i) const {
+        return readings[(currentIndex - readingCount + i + LEGACY_SIZE) % LEGACY_SIZE];
+    }
+    int firstAtOrAfter(unsigned long timestamp) const {
+        for (int i = 0; i < readingCount; i++) {
+            if (at(i).timestamp >= timestamp) return i;
+        }
+        return readingCount;
+    }
+};
+
+static LegacyRing legacy;
+static TimeSeriesRing<SensorReading, RING_SIZE> ring;
+static SensorReading scratch[RING_SIZE];
+static volatile float sink;
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanosPer(Clock::time_point start, uint64_t operations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+}
+
+static SensorReading makeReading(uint32_t sequence) {
+    SensorReading reading;
+    memset(&reading, 0, sizeof(reading));
+    reading.sequence = sequence;
+    reading.timestamp = sequence * 1000UL;
+    reading.temperature = 20.0f + (sequence % 50) * 0.1f;
+    reading.humidity = 45.0f;
+    reading.isValid = true;
+    return reading;
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    const int window = LEGACY_SIZE;            // Same active length for both rings
+    ring.clear(window);
+
+    // Append (steady state: both rings full and wrapping)
+    const uint64_t appends = (uint64_t)iterations * window;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < appends; i++) legacy.push(makeReading((uint32_t)i));
+    double legacyAppend = nanosPer(start, appends);
+
+    start = Clock::now();
+    for (uint64_t i = 0; i < appends; i++) {
+        SensorReading& slot = ring.push();
+        slot = makeReading((uint32_t)i);
+    }
+    double ringAppend = nanosPer(start, appends);
+
+    // Full scan, record by record
+    float sum = 0.0f;
+    start = Clock::now();
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < legacy.readingCount; i++) sum += legacy.at(i).temperature;
+    }
+    double legacyScan = nanosPer(start, (uint64_t)iterations * window);
+    sink = sum;
+
+    sum = 0.0f;
+    start = Clock::now();
+    for (int n = 0; n < iterations; n++) {
+        for (const SensorReading& reading : ring) sum += reading.temperature;
+    }
+    double ringScan = nanosPer(start, (uint64_t)iterations * window);
+    sink = sum;
+
+    // Bulk copy out (what a seqlock reader does): two spans versus per-record modulo
+    start = Clock::now();
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < legacy.readingCount; i++) scratch[i] = legacy.at(i);
+        sink = scratch[n % window].temperature;
+    }
+    double legacyCopy = nanosPer(start, (uint64_t)iterations * window);
+
+    start = Clock::now();
+    for (int n = 0; n < iterations; n++) {
+        TimeSeriesRing<SensorReading, RING_SIZE>::Spans runs = ring.spans();
+        memcpy(scratch, runs.first.data, runs.first.length * sizeof(SensorReading));
+        memcpy(scratch + runs.first.length, runs.second.data, runs.second.length * sizeof(SensorReading));
+        sink = scratch[n % window].temperature;
+    }
+    double ringCopy = nanosPer(start, (uint64_t)iterations * window);
+
+    // Range lookup: first reading at or after a time, spread over the window
+    const uint64_t oldest = ring.oldest().timestamp;
+    const uint64_t lookups = (uint64_t)iterations * 100;
+    uint64_t found = 0;
+    start = Clock::now();
+    for (uint64_t i = 0; i < lookups; i++) found += legacy.firstAtOrAfter(oldest + (i * 7919 % window) * 1000UL);
+    double legacyLookup = nanosPer(start, lookups);
+
+    uint64_t foundRing = 0;
+    start = Clock::now();
+    for (uint64_t i = 0; i < lookups; i++) foundRing += ring.lowerBound(oldest + (i * 7919 % window) * 1000UL);
+    double ringLookup = nanosPer(start, lookups);
+
+    // Both rings must hold the same readings in the same order
+    bool ok = found == foundRing && (int)ring.size() == legacy.readingCount;
+    for (int i = 0; ok && i < window; i++) ok = ring[i].sequence == legacy.at(i).sequence;
+    uint32_t expected = ring.newest().sequence;
+    for (const SensorReading& reading : ring.newestFirst()) {
+        if (!ok) break;
+        ok = reading.sequence == expected--;
+    }
+    ok = ok && ring.lowerBound(0UL) == 0 && ring.lowerBound(ring.newest().timestamp + 1) == ring.size();
+
+    printf("window %d readings, %zu bytes each, %d iterations\n", window, sizeof(SensorReading), iterations);
+    printf("%-22s %12s %12s %8s\n", "", "modulo ring", "TimeSeries", "speedup");
+    printf("%-22s %9.2f ns %9.2f ns %7.1fx\n", "append", legacyAppend, ringAppend, legacyAppend / ringAppend);
+    printf("%-22s %9.2f ns %9.2f ns %7.1fx\n", "scan (per record)", legacyScan, ringScan, legacyScan / ringScan);
+    printf("%-22s %9.2f ns %9.2f ns %7.1fx\n", "copy out (per record)", legacyCopy, ringCopy, legacyCopy / ringCopy);
+    printf("%-22s %9.0f ns %9.0f ns %7.1fx\n", "time lookup", legacyLookup, ringLookup, legacyLookup / ringLookup);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
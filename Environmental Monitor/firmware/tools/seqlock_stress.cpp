@@ -0,0 +1,228 @@
+/*
+ * History publication stress test (host)
+ *
+ * One writer thread appends to a TimeSeriesRing through the SeqLock the
+ * way readAndStoreSensorData() does (with an occasional resize, like
+ * resizeHistory()), flat out instead of once a second. Reader threads
+ * run the copyHistory() and historySequenceAt() retry loops against it
+ * and check every snapshot they accept: consecutive sequences, intact
+ * checksums and fields that match their sequence. Any torn snapshot that
+ * got past readRetry() is a failure.
+ *
+ * --no-lock skips the writer's lock calls, to show the checks do catch
+ * torn copies. Run it on a machine with more cores than threads: on a
+ * single core a reader that lands mid-write spins out its time slice, so
+ * few snapshots get checked.
+ *
+ * Build from the firmware directory:
+ *   g++ -std=c++17 -O2 -pthread -Iinclude tools/seqlock_stress.cpp src/HistoryCheckpoint.cpp -o seqlock_stress
+ *
+ * Usage: seqlock_stress [seconds] [readers] [--no-lock]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "SensorReading.h"
+#include "TimeSeriesRing.h"
+#include "HistoryCheckpoint.h"
+#include "SeqLock.h"
+
+#define RING_SIZE 1024                         // MAX_READINGS in main.cpp
+#define COPY_CHUNK 16                          // HISTORY_COPY_CHUNK in main.cpp
+#define RESIZE_INTERVAL 4096                   // Writes between history resizes
+
+static TimeSeriesRing<SensorReading, RING_SIZE> readings;
+static SeqLock historyLock;
+static std::atomic<bool> writerDone(false);
+static std::atomic<uint32_t> writesDone(0);
+static bool useLock = true;
+
+static const uint32_t RESIZE_LIMITS[] = { RING_SIZE, RING_SIZE / 2, RING_SIZE / 4, RING_SIZE };
+
+struct ReaderStats {
+    uint64_t copies;
+    uint64_t recordsChecked;
+    uint64_t lookups;
+    uint64_t retries;
+    uint64_t missed;                           // Requested range already overwritten
+    uint64_t torn;
+};
+
+static void fillReading(SensorReading& reading, uint32_t sequence) {
+    reading.sequence = sequence;
+    reading.timestamp = (uint64_t)sequence * 1000;
+    reading.temperature = 20.0f + (float)(sequence % 97) * 0.1f;
+    reading.humidity = 40.0f + (float)(sequence % 53) * 0.2f;
+    reading.isValid = true;
+    reading.temperatureFlags = (uint8_t)(sequence & 0x0F);
+    reading.humidityFlags = (uint8_t)((sequence >> 4) & 0x0F);
+    reading.dewPoint = reading.temperature - 10.0f;
+    reading.heatIndex = reading.temperature + 1.0f;
+    reading.absoluteHumidity = reading.humidity * 0.2f;
+    reading.vaporPressureDeficit = (float)(sequence % 31) * 0.05f;
+    sealReading(reading);
+}
+
+static bool readingIntact(const SensorReading& reading, uint32_t sequence) {
+    SensorReading expected;
+    memset(&expected, 0, sizeof(expected));
+    fillReading(expected, sequence);
+    return reading.isValid && reading.checksum == readingChecksum(reading) &&
+           reading.sequence == expected.sequence && reading.timestamp == expected.timestamp &&
+           reading.temperature == expected.temperature && reading.humidity == expected.humidity &&
+           reading.temperatureFlags == expected.temperatureFlags &&
+           reading.humidityFlags == expected.humidityFlags &&
+           reading.vaporPressureDeficit == expected.vaporPressureDeficit;
+}
+
+static void writer(double seconds) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    for (uint32_t sequence = 1; ; sequence++) {
+        if ((sequence & 4095) == 0 && std::chrono::steady_clock::now() >= end) break;
+        if (useLock) historyLock.writeBegin();
+        if (sequence % RESIZE_INTERVAL == 0) {
+            readings.setLimit(RESIZE_LIMITS[(sequence / RESIZE_INTERVAL) % 4]);
+        }
+        fillReading(readings.push(), sequence);
+        if (useLock) historyLock.writeEnd();
+        writesDone.store(sequence, std::memory_order_relaxed);
+    }
+    writerDone.store(true, std::memory_order_release);
+}
+
+/*
+ * copyHistory() from main.cpp, counting retries
+ */
+static int copyHistory(uint32_t firstSequence, SensorReading* out, int maxCount, ReaderStats& stats) {
+    while (true) {
+        uint32_t start = historyLock.readBegin();
+        uint32_t count = readings.size();
+        uint32_t oldestSequence = (count > 0) ? readings.oldest().sequence : 0;
+
+        uint32_t copied = 0;
+        if (count > 0 && firstSequence >= oldestSequence && firstSequence - oldestSequence < count) {
+            copied = readings.copy(firstSequence - oldestSequence, out, (uint32_t)maxCount);
+        }
+        if (!historyLock.readRetry(start)) {
+            return (int)copied;
+        }
+        stats.retries++;
+    }
+}
+
+/*
+ * historySequenceAt() from main.cpp; also returns the ring's sequence range
+ * from the same snapshot
+ */
+static uint32_t historySequenceAt(uint64_t timestamp, uint32_t* oldest, uint32_t* next, ReaderStats& stats) {
+    while (true) {
+        uint32_t start = historyLock.readBegin();
+        uint32_t count = readings.size();
+        uint32_t first = (count > 0) ? readings.oldest().sequence : 0;
+        uint32_t newest = (count > 0) ? readings.newest().sequence : 0;
+        uint32_t index = readings.lowerBound(timestamp);
+        if (!historyLock.readRetry(start)) {
+            *oldest = first;
+            *next = newest + 1;
+            return first + index;
+        }
+        stats.retries++;
+    }
+}
+
+static void reader(uint32_t seed, ReaderStats* result) {
+    ReaderStats stats = {};
+    std::mt19937 random(seed);
+    SensorReading chunk[COPY_CHUNK];
+
+    while (!writerDone.load(std::memory_order_acquire)) {
+        // Time lookup anywhere in what has been written, often evicted already
+        uint32_t target = 1 + random() % (writesDone.load(std::memory_order_relaxed) + 1);
+        uint32_t oldest = 0;
+        uint32_t next = 0;
+        uint32_t sequence = historySequenceAt((uint64_t)target * 1000, &oldest, &next, stats);
+        if (next == 1) continue;                // Nothing written yet
+        stats.lookups++;
+
+        uint32_t expected = (target < oldest) ? oldest : (target >= next ? next : target);
+        if (sequence != expected) stats.torn++;
+
+        // Copy a chunk from near the newest end, where the writer is
+        uint32_t first = next - 1 - random() % (RING_SIZE / 4);
+        int copied = copyHistory(first, chunk, COPY_CHUNK, stats);
+        stats.copies++;
+        if (copied == 0) {
+            stats.missed++;
+            continue;
+        }
+        for (int i = 0; i < copied; i++) {
+            if (!readingIntact(chunk[i], first + i)) stats.torn++;
+        }
+        stats.recordsChecked += copied;
+        std::this_thread::yield();
+    }
+    *result = stats;
+}
+
+int main(int argc, char** argv) {
+    double seconds = 5.0;
+    int readerCount = 3;
+    int position = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-lock") == 0) {
+            useLock = false;
+        } else if (position++ == 0) {
+            seconds = atof(argv[i]);
+        } else {
+            readerCount = atoi(argv[i]);
+        }
+    }
+    if (seconds <= 0.0) seconds = 5.0;
+    if (readerCount < 1) readerCount = 1;
+
+    SensorReading* slots = readings.storage();
+    memset(slots, 0, sizeof(SensorReading) * RING_SIZE);
+    readings.clear(RING_SIZE);
+
+    std::vector<ReaderStats> stats(readerCount);
+    std::vector<std::thread> readers;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < readerCount; i++) {
+        readers.emplace_back(reader, 1000 + i, &stats[i]);
+    }
+    std::thread writerThread(writer, seconds);
+    writerThread.join();
+    for (std::thread& thread : readers) thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t writes = writesDone.load();
+
+    ReaderStats total = {};
+    for (const ReaderStats& s : stats) {
+        total.copies += s.copies;
+        total.recordsChecked += s.recordsChecked;
+        total.lookups += s.lookups;
+        total.retries += s.retries;
+        total.missed += s.missed;
+        total.torn += s.torn;
+    }
+
+    printf("writes %lu in %.2f s (%.1f M/s), %d readers%s\n", (unsigned long)writes, elapsed,
+           writes / elapsed / 1e6, readerCount, useLock ? "" : ", writer not locking");
+    printf("copies %llu (%llu records checked), lookups %llu\n", (unsigned long long)total.copies,
+           (unsigned long long)total.recordsChecked, (unsigned long long)total.lookups);
+    printf("retries %llu (%.2f per read), missed %llu\n", (unsigned long long)total.retries,
+           (double)total.retries / (double)(total.copies + total.lookups), (unsigned long long)total.missed);
+    printf("torn snapshots accepted: %llu\n", (unsigned long long)total.torn);
+
+    bool ok = total.torn == 0 && total.recordsChecked > 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}